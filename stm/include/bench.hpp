@@ -0,0 +1,25 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "stm32f10x.h"
+
+namespace bench {
+
+    /*
+     * On-device benchmarks, run through the USART console with "bench <name>".
+     *
+     * Times are measured with the DWT cycle counter, so they are in CPU cycles (72 per microsecond).
+     */
+
+    // Starts the cycle counter
+    void initCycleCounter();
+    // Returns the current value of the cycle counter
+    uint32_t cycles();
+
+    // Runs the benchmark with the specified name, returning false if there isn't one
+    bool run(const char *name);
+    // Prints the names of all benchmarks
+    void list();
+} // namespace bench
+
+#endif
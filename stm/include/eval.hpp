@@ -4,8 +4,11 @@
 #include "deque.hpp"
 #include "dynamarr.hpp"
 #include "lcd12864_charset.hpp"
+#include "lookup.hpp"
+#include "matkern.hpp"
 #include "neda.hpp"
 #include "numerical.hpp"
+#include "poly.hpp"
 #include "util.hpp"
 #include <math.h>
 
@@ -22,6 +25,7 @@ namespace eval {
         OPERATOR,
         FUNCTION,
         MATRIX,
+        POLYNOMIAL,
     };
 
     class Token {
@@ -48,87 +52,440 @@ namespace eval {
         static Numerical *constFromString(const char *);
     };
 
+    /*
+     * Reference-counted memory for the entries of matrices, so that copies and views of a matrix can share it.
+     * The entries follow right after this header.
+     */
+    struct MatrixBuffer {
+        uint32_t refs;
+        // The number of entries
+        uint32_t count;
+
+        inline void *entries() {
+            return this + 1;
+        }
+    };
+
     class Matrix : public Token {
     public:
-        Matrix(uint8_t m, uint8_t n) : m(m), n(n) {
-            contents = new util::Numerical[m * n];
+        /*
+         * Special forms a matrix can have, which allow for much faster operations.
+         * When a form is a special case of another (e.g. identity and diagonal), the most specific one is used.
+         */
+        enum class Structure : uint8_t {
+            // Not known; found by getStructure() when it's needed
+            UNKNOWN,
+            GENERAL,
+            ZERO,
+            IDENTITY,
+            DIAGONAL,
+            UPPER_TRIANGULAR,
+            LOWER_TRIANGULAR,
+            // Exactly one 1 in every row and column, and 0 everywhere else
+            PERMUTATION,
+        };
+        /*
+         * How the entries are stored in memory.
+         */
+        enum class Storage : uint8_t {
+            // Packed doubles, half the size of util::Numerical
+            // Only used while every entry is a floating-point number; writing a fraction switches to NUMERICAL
+            DOUBLE,
+            // util::Numerical entries which are all fractions
+            // Writing a floating-point number only changes the storage to NUMERICAL, since the layout is the same
+            FRACTION,
+            // util::Numerical entries of both kinds
+            NUMERICAL,
+        };
+        // Matrices with entries that fit in this many doubles are stored inside the token, without another allocation
+        // This covers 3x3 and smaller in DOUBLE storage, and 2x2 and 3x1 otherwise
+        // Every token pays for this space, including views and large matrices, so it's kept to the common sizes
+        static constexpr uint8_t INLINE_CAPACITY = 9;
+
+        // New matrices are filled with 0, as a floating-point number unless the storage is FRACTION
+        Matrix(uint16_t m, uint16_t n, Structure structure = Structure::UNKNOWN)
+                : Matrix(m, n, Storage::DOUBLE, structure) {
         }
-
+        Matrix(uint16_t m, uint16_t n, Storage storage, Structure structure = Structure::UNKNOWN);
         // Copy constructor
-        Matrix(const Matrix &mat) : m(mat.m), n(mat.n) {
-            contents = new util::Numerical[m * n];
-            memcpy(contents, mat.contents, sizeof(util::Numerical) * m * n);
-        }
+        // This doesn't copy the entries; they are shared until either matrix is written to (copy-on-write)
+        Matrix(const Matrix &mat);
+        // Move constructor
+        Matrix(Matrix &&mat);
 
         ~Matrix() {
-            delete[] contents;
+            release();
         }
 
-        const uint8_t m;
-        const uint8_t n;
-
-        util::Numerical *contents;
+        /*
+         * Creates a read-only matrix backed by doubles in row-major order in memory that is never freed (e.g. a table
+         * in flash), so that large data sets don't have to be copied into RAM.
+         * Writing to the matrix (or to a copy of it) first copies the entries into RAM.
+         */
+        static Matrix *fromStatic(uint16_t m, uint16_t n, const double *entries);
+
+        // Not const so that the matrix can be transposed in place
+        uint16_t m;
+        uint16_t n;
+
+        // Set by the transpose operator during evaluation instead of moving the entries around
+        // This allows products such as A^TA to be computed without materializing A^T
+        // Everything outside of the operators only ever sees matrices with this flag cleared (see resolveTranspose())
+        bool pendingTranspose = false;
+
+        // The number of entries
+        inline uint32_t size() const {
+            return static_cast<uint32_t>(m) * n;
+        }
+        inline Storage getStorage() const {
+            return storage;
+        }
 
-        // Maps zero-based indexing to index in contents array
-        inline uint16_t index_0(uint8_t x, uint8_t y) const {
-            return x + y * n;
+        // Entries are returned by value, since they may not exist as util::Numericals in memory
+        // They are const so that assigning to them by accident doesn't compile
+        inline const util::Numerical getEntry(uint16_t row, uint16_t col) const {
+            return entryAt(row * rowStride + col * colStride);
+        }
+        // Entries in row-major order
+        inline const util::Numerical operator[](uint32_t i) const {
+            return entryAt(isContiguous() ? i : (i / n) * rowStride + (i % n) * colStride);
         }
-        // Sets an entry
-        inline void setEntry(uint8_t row, uint8_t col, util::Numerical entry) {
-            contents[index_0(col, row)] = entry;
+        // Sets an entry, which forgets the structure of the matrix
+        inline void setEntry(uint16_t row, uint16_t col, const util::Numerical &entry) {
+            structure = Structure::UNKNOWN;
+            const bool number = entry.isNumber();
+            const Storage s = storage == Storage::DOUBLE && number      ? Storage::DOUBLE
+                              : storage == Storage::FRACTION && !number ? Storage::FRACTION
+                                                                        : Storage::NUMERICAL;
+            // Shared entries have to be copied first, and fractions can't be stored as packed doubles
+            // Either way the entries end up contiguous, so the index has to be found afterwards
+            if (!isWritable() || (storage == Storage::DOUBLE) != (s == Storage::DOUBLE)) {
+                convert(s);
+            }
+            storage = s;
+            writeAt(row * rowStride + col * colStride, entry);
+        }
+        // Sets an entry by its row-major index
+        inline void set(uint32_t i, const util::Numerical &entry) {
+            setEntry(i / n, i % n, entry);
         }
-        inline util::Numerical &getEntry(uint8_t row, uint8_t col) {
-            return contents[index_0(col, row)];
+
+        // Returns the structure of the matrix, finding it first if it's not known
+        // Anything that writes to the entries through view() must call setStructure() afterwards
+        Structure getStructure() const;
+        inline void setStructure(Structure s) {
+            structure = s;
         }
-        inline const util::Numerical &getEntry(uint8_t row, uint8_t col) const {
-            return contents[index_0(col, row)];
+
+        // Whether every entry is a floating-point number (as opposed to a fraction)
+        bool hasOnlyNumbers() const;
+        // Whether every entry is a floating-point number, and at least one of them isn't an integer
+        // Integer entries turn into exact fractions as soon as they're operated on, so only matrices like these can be
+        // handed off to the floating-point kernels in matkern without changing the results
+        bool isFloatingPoint() const;
+        // Accesses the entries as doubles for the kernels in matkern
+        // Only valid when hasOnlyNumbers() is true: a util::Numerical representing a number keeps the double in its
+        // first 8 bytes, so with NUMERICAL storage each entry is ENTRY_STRIDE doubles apart
+        // The entries may only be written to if isWritable() is true (see makeWritable())
+        static constexpr uint8_t ENTRY_STRIDE = sizeof(util::Numerical) / sizeof(double);
+        inline matkern::View view() const {
+            const uint32_t stride = storage == Storage::DOUBLE ? 1 : ENTRY_STRIDE;
+            return {static_cast<double *>(data), rowStride * stride, colStride * stride};
         }
-        inline util::Numerical &operator[](const int index) {
-            return contents[index];
+        /*
+         * Changes how the entries are stored.
+         * Converting to DOUBLE turns fractions into floating-point numbers, so it should only be done when they don't
+         * matter (e.g. when every entry is going to be overwritten by a floating-point number). Converting to FRACTION
+         * is only valid if every entry is a fraction.
+         * Afterwards the matrix owns its entries, which are contiguous in row-major order.
+         */
+        void convert(Storage s);
+        // Switches to the most specific storage for the current entries (see Storage)
+        void compact();
+        // Whether the entries can be written to directly, i.e. they're not shared with any other matrix
+        inline bool isWritable() const {
+            return ownership == Ownership::INLINE || (ownership == Ownership::SHARED && buffer->refs == 1);
         }
-        inline const util::Numerical &operator[](const int index) const {
-            return contents[index];
+        // Copies the entries if they're shared, so that they can be written to
+        inline void makeWritable() {
+            if (!isWritable()) {
+                convert(storage);
+            }
+        }
+        // Like makeWritable(), but also makes sure the entries are contiguous in row-major order
+        inline void makeContiguous() {
+            if (!isWritable() || !isContiguous()) {
+                convert(storage);
+            }
         }
 
         static Matrix *add(const Matrix &, const Matrix &);
         static Matrix *subtract(const Matrix &, const Matrix &);
         static Matrix *multiply(const Matrix &, util::Numerical);
         static Matrix *multiply(const Matrix &, const Matrix &);
+        /*
+         * Fused multiply: result = alpha * op(a) * op(b) + beta * result, where op(x) is either x or its transpose.
+         *
+         * result must already have the correct dimensions and must not be the same matrix as a or b.
+         * If beta is 0 the original contents of result are ignored.
+         * Returns false if the dimensions don't match.
+         */
+        static bool multiply(Matrix &result, const Matrix &a, const Matrix &b, util::Numerical alpha = 1,
+                util::Numerical beta = 0, bool transA = false, bool transB = false);
         static util::Numerical dot(const Matrix &, const Matrix &);
         static bool equality(const Matrix &, const Matrix &);
-        static Matrix *leastSquares(const Matrix &, const Matrix &);
-        // Note: This will modify the matrix
-        util::Numerical det();
+        /*
+         * Finds the least squares solution x of ax = b.
+         *
+         * Exact matrices are solved with the normal equations, which keeps the result exact. Otherwise this uses
+         * leastSquaresQR.
+         * Returns nullptr if a does not have full column rank.
+         */
+        static Matrix *leastSquares(const Matrix &a, const Matrix &b);
+        /*
+         * Finds the least squares solution x of ax = b in floating-point, using a Householder QR decomposition of a.
+         * Unlike the normal equations, this does not square the condition number of a.
+         *
+         * If rss is not null, the residual sum of squares for each column of b is written to it.
+         * Returns nullptr if a has fewer rows than columns or does not have full column rank.
+         */
+        static Matrix *leastSquaresQR(const Matrix &a, const Matrix &b, double *rss = nullptr);
+        util::Numerical det() const;
         util::Numerical len() const;
         static Matrix *cross(const Matrix &, const Matrix &);
         Matrix *transpose() const;
         Matrix *inv() const;
-
-        Matrix *getRowVector(uint8_t row) const;
-        Matrix *getColVector(uint8_t col) const;
+        // Integer power by repeated squaring; negative powers use the inverse
+        // Returns nullptr if the matrix is not square, or if it is singular and the power is negative
+        Matrix *pow(int32_t e) const;
+        // Matrix exponential e^A, using a Pade approximant with scaling and squaring
+        // Returns nullptr if the matrix is not square
+        Matrix *exp() const;
+
+        // In-place operations; these do not allocate unless a fraction has to be stored in DOUBLE storage
+        // this += scalar * other; returns false if the dimensions don't match
+        bool addInPlace(const Matrix &other, util::Numerical scalar = 1);
+        void multiplyInPlace(util::Numerical scalar);
+        // Only swaps the strides; the entries are not moved
+        void transposeInPlace();
+        // Carries out a pending transpose set by the transpose operator, if there is one
+        void resolveTranspose();
+
+        /*
+         * Return a row or column of this matrix as a vector.
+         *
+         * The vector is a view that shares the entries of this matrix, like a copy does.
+         */
+        Matrix *getRowVector(uint16_t row) const;
+        Matrix *getColVector(uint16_t col) const;
+        // Copies the entries of a view if nothing else refers to the rest of the matrix it came from
+        // This is so that a single row doesn't keep all of a big matrix alive
+        void trim();
 
         bool eliminate(bool allowSingular = true);
+        // Whether every entry is a fraction or an integer, so the matrix can be eliminated with eliminateExact()
+        bool isExact() const;
+        /*
+         * Fraction-free (Bareiss) Gauss-Jordan elimination for exact matrices.
+         *
+         * Each row of src is scaled to a common denominator once, after which everything is done in integers; the
+         * divisions by the previous pivot are always exact, so no GCDs are needed until the very end.
+         * Only the first pivotCols columns are used for pivots.
+         * If rref is not null, the reduced row echelon form is written to it (it can be the same matrix as src).
+         * If det is not null, the determinant of the first pivotCols rows and columns is written to it.
+         * Returns false and leaves the outputs untouched if an integer overflowed.
+         */
+        static bool eliminateExact(const Matrix &src, Matrix *rref, uint16_t pivotCols, util::Numerical *det = nullptr);
+        /*
+         * Solves ax = b exactly, where augmented is [a|b] and a is square and exact.
+         * augmented is reduced in place. Returns false if an integer overflowed; otherwise x is set to the solution,
+         * or nullptr if a is singular.
+         */
+        static bool solveExact(Matrix &augmented, Matrix *&x);
+        /*
+         * Solves ax = b for a with a special structure (see getStructure()), in O(n^2) time or better.
+         * Returns false if a has no useful structure; otherwise x is set to the solution, or nullptr if a is singular.
+         */
+        static bool solveStructured(const Matrix &a, const Matrix &b, Matrix *&x);
 
         virtual TokenType getType() const override {
             return TokenType::MATRIX;
         }
 
+        friend class LUDecomposition;
+
     protected:
-        inline void rowSwap(uint8_t a, uint8_t b) {
-            for (uint8_t i = 0; i < n; i++) {
-                util::swap(getEntry(a, i), getEntry(b, i));
+        // Where the entries are
+        enum class Ownership : uint8_t {
+            // In inlineEntries
+            INLINE,
+            // In buffer, which may be shared with other matrices
+            SHARED,
+            // In memory that is never freed or written to (see fromStatic())
+            STATIC,
+        };
+
+        // Creates an m by n view of the entries of parent, starting from data
+        Matrix(const Matrix &parent, uint16_t m, uint16_t n, void *data, uint32_t rowStride, uint32_t colStride);
+
+        Storage storage;
+        // Cached result of getStructure()
+        mutable Structure structure;
+        Ownership ownership;
+        // The first entry; either double * or util::Numerical * depending on the storage
+        void *data;
+        // The memory data points into if the ownership is SHARED, otherwise null
+        MatrixBuffer *buffer;
+        // The distances between consecutive rows and columns, in entries
+        uint32_t rowStride;
+        uint32_t colStride;
+        // Storage for small matrices; doubles so that it's aligned for util::Numerical
+        double inlineEntries[INLINE_CAPACITY];
+
+        // Allocates room for count entries and returns it
+        // newBuffer is set to the new buffer, or null if the entries fit inside the token
+        void *allocate(Storage s, uint32_t count, MatrixBuffer *&newBuffer);
+        // Allocates a new contiguous array for the entries without keeping the old ones
+        // For when every entry is about to be overwritten
+        void reallocate(Storage s);
+
+        inline bool isContiguous() const {
+            return colStride == 1 && rowStride == n;
+        }
+        inline const util::Numerical entryAt(uint32_t i) const {
+            return storage == Storage::DOUBLE ? util::Numerical(static_cast<const double *>(data)[i])
+                                              : static_cast<const util::Numerical *>(data)[i];
+        }
+        inline void writeAt(uint32_t i, const util::Numerical &entry) {
+            if (storage == Storage::DOUBLE) {
+                static_cast<double *>(data)[i] = entry.asDouble();
+            }
+            else {
+                static_cast<util::Numerical *>(data)[i] = entry;
             }
         }
-        inline void rowMult(uint8_t row, util::Numerical scalar) {
-            for (uint8_t i = 0; i < n; i++) {
-                getEntry(row, i) *= scalar;
+        // Drops this matrix's reference to its entries
+        void release();
+
+        // The structure of the transpose of a matrix with structure s
+        static Structure transposed(Structure s);
+        // The structure of the product of two matrices with structures a and b, or UNKNOWN if it can't be told
+        static Structure productStructure(Structure a, Structure b);
+        // Multiplies using the special structure of a or b, with the same arguments as multiply()
+        // Returns false if neither has a useful structure
+        static bool multiplyStructured(Matrix &result, const Matrix &a, const Matrix &b, util::Numerical alpha,
+                util::Numerical beta, bool transA, bool transB);
+        // For a permutation matrix, returns the column of the 1 in the given row
+        uint16_t permutationCol(uint16_t row) const;
+
+        inline void rowSwap(uint16_t a, uint16_t b) {
+            for (uint16_t i = 0; i < n; i++) {
+                const util::Numerical temp = getEntry(a, i);
+                setEntry(a, i, getEntry(b, i));
+                setEntry(b, i, temp);
             }
         }
-        inline void rowAdd(uint8_t a, uint8_t b, util::Numerical scalar = 1) {
-            for (uint8_t i = 0; i < n; i++) {
-                getEntry(a, i) += getEntry(b, i) * scalar;
+        // The row operations only touch the columns from start onwards
+        // If floatingPoint is true, the row is assumed to contain only numbers and the kernels are used
+        inline void rowMult(uint16_t row, util::Numerical scalar, bool floatingPoint = false, uint16_t start = 0) {
+            if (floatingPoint) {
+                makeWritable();
+                const matkern::View v = view();
+                matkern::scal(n - start, scalar.asDouble(), &v(row, start), v.colStride);
+                return;
             }
+            for (uint16_t i = start; i < n; i++) {
+                setEntry(row, i, getEntry(row, i) * scalar);
+            }
+        }
+        inline void rowAdd(uint16_t a, uint16_t b, util::Numerical scalar = 1, bool floatingPoint = false,
+                uint16_t start = 0) {
+            if (floatingPoint) {
+                makeWritable();
+                const matkern::View v = view();
+                matkern::axpy(n - start, scalar.asDouble(), &v(b, start), v.colStride, &v(a, start), v.colStride);
+                return;
+            }
+            for (uint16_t i = start; i < n; i++) {
+                setEntry(a, i, getEntry(a, i) + getEntry(b, i) * scalar);
+            }
+        }
+    };
+    static_assert(sizeof(util::Numerical) == 2 * sizeof(double), "Matrix::view() relies on the layout of Numerical");
+
+    /*
+     * LU factorization with partial pivoting of a square matrix, such that PA = LU.
+     *
+     * L (unit lower triangular) and U (upper triangular) are packed into a single matrix. Once a matrix is factored,
+     * its determinant can be found in O(n), and every right-hand side can be solved for in O(n^2).
+     */
+    class LUDecomposition {
+    public:
+        // If floatingPoint is true the factorization is done in floating-point even if the entries are exact
+        LUDecomposition(const Matrix &a, bool floatingPoint = false);
+        // Factors the matrix in place, taking over its entries
+        LUDecomposition(Matrix &&a, bool floatingPoint = false);
+        ~LUDecomposition();
+
+        // Returns the factorization of a, reusing the cached factorization if a was the last matrix factored
+        // The returned reference is only valid until the next call
+        static const LUDecomposition &of(const Matrix &a);
+        // Frees the cached factorization
+        // This is done after every top-level evaluation, after graphing and when variables change or are deleted
+        static void clearCache();
+
+        // The combined L and U factors
+        Matrix lu;
+        // perm[i] is the row of the original matrix that ended up in row i
+        uint16_t *perm;
+        // Whether an odd number of row swaps was done
+        bool oddSwaps;
+        bool singular;
+        // Whether the factorization was done with the floating-point kernels
+        bool floatingPoint;
+
+        util::Numerical det() const;
+        // Solves AX = B for X, where B can have any number of columns
+        // Returns nullptr if the matrix is singular or B is of the wrong size
+        Matrix *solve(const Matrix &b) const;
+        Matrix *inv() const;
+
+    protected:
+        void factor();
+    };
+
+    /*
+     * A polynomial in one variable with floating-point coefficients (see poly.hpp).
+     *
+     * Polynomials can be added, subtracted and multiplied with each other and with numbers, and are called like a
+     * function to evaluate them, e.g. p(2). They are made with poly() from coefficients, or fitted to data with polyFit().
+     */
+    class Polynomial : public Token {
+    public:
+        // Creates a polynomial with count coefficients, all 0
+        Polynomial(uint16_t count);
+        Polynomial(const Polynomial &other);
+        Polynomial &operator=(const Polynomial &) = delete;
+
+        ~Polynomial() {
+            delete[] coeffs;
+        }
+
+        // Coefficients in ascending order of power
+        double *coeffs;
+        // The number of coefficients, one more than the degree
+        uint16_t count;
+
+        virtual TokenType getType() const override {
+            return TokenType::POLYNOMIAL;
+        }
+
+        inline double operator()(double x) const {
+            return poly::evaluate(coeffs, count, x);
         }
+        // Drops leading coefficients that are 0, always keeping the constant term
+        void normalize();
+        Polynomial *derivative() const;
     };
 
     class Operator : public Token {
@@ -168,6 +525,8 @@ namespace eval {
 
         uint8_t getPrecedence() const;
         bool isUnary() const;
+        // Whether this unary operator comes after its operand (e.g. factorial)
+        bool isPostfix() const;
 
         virtual TokenType getType() const override {
             return TokenType::OPERATOR;
@@ -184,6 +543,11 @@ namespace eval {
         // The returned numerical is allocated on the heap and needs to be freed
         // The input is deleted
         Token *operator()(Token *) const;
+        // Operates on two numbers in place, storing the result in lhs
+        // Returns false if the operator can't be applied to numbers
+        bool applyScalar(util::Numerical &lhs, const util::Numerical &rhs) const;
+        // Unary version of applyScalar()
+        bool applyScalar(util::Numerical &x) const;
     };
 
     class Function : public Token {
@@ -217,6 +581,34 @@ namespace eval {
             RREF,
             MEAN,
             RAND,
+            FFT,
+            IFFT,
+            CONV,
+            SUM,
+            PROD,
+            CUMSUM,
+            NORM,
+            VAR,
+            SORT,
+            MEDIAN,
+            QUANTILE,
+            MODE,
+            ISPRIME,
+            FACTOR,
+            POWMOD,
+            MODINV,
+            GCD,
+            LCM,
+            NCR,
+            NPR,
+            POLY,
+            COEFFS,
+            ROOTS,
+            DERIV,
+            POLYFIT,
+            RANDINT,
+            RANDN,
+            SEED,
 
             // Cast this into an unit8_t for the total function count
             TOTAL_TYPE_COUNT
@@ -227,7 +619,9 @@ namespace eval {
         // Used for displaying, doesn't have to contain all functions
         static const char *const FUNC_FULLNAMES[];
         // Length of FUNC_FULLNAMES
-        static constexpr uint8_t TYPE_COUNT_DISPLAYABLE = 28;
+        static constexpr uint8_t TYPE_COUNT_DISPLAYABLE = 61;
+        // FUNC_FULLNAMES in alphabetical order, for searching the catalog
+        static const lookup::PrefixIndex<TYPE_COUNT_DISPLAYABLE> FUNC_FULLNAMES_INDEX;
 
         Function(Type type) : type(type) {
         }
@@ -241,6 +635,11 @@ namespace eval {
         static Function *fromString(const char *);
         uint8_t getNumArgs() const;
         bool isVarArgs() const;
+        // Whether the function only takes and returns numbers, so it can be applied to each entry of a matrix
+        bool isScalar() const;
+        // Evaluates a scalar function (see isScalar()) on numbers, storing the result in out
+        // Returns false if the function is not scalar.
+        bool applyScalar(const util::Numerical *args, uint16_t argc, util::Numerical &out) const;
 
         // Evaluates the function. Assumes the input has the correct number of elements, and uses argc if the function
         // is varargs. Note: This function might modify the input.
@@ -310,7 +709,9 @@ namespace eval {
     double extractDouble(const Token *);
     uint16_t findEquals(const util::DynamicArray<neda::NEDAObj *> &, bool forceVarName = true);
     uint16_t findTokenEnd(const util::DynamicArray<neda::NEDAObj *> &arr, uint16_t start, int8_t direction, bool &isNum);
+    uint16_t findUnitEnd(const util::DynamicArray<neda::NEDAObj *> &arr, uint16_t start);
     int8_t isTruthy(const Token *);
+    int8_t isTruthy(const util::Numerical &);
 
     Token *evaluate(const neda::Container *, const util::DynamicArray<Variable> &vars, 
             const util::DynamicArray<UserDefinedFunction> &funcs);
@@ -94,6 +94,9 @@ namespace expr {
 
         // Redraws the graph of all functions marked to graph.
         void redrawGraph();
+        // Draws the curve y = f(x) across the graph, connecting the pixels where the curve is steep.
+        template <typename F>
+        void drawCurve(F f);
 
         // The previous display mode
         DisplayMode prevMode = DisplayMode::NORMAL;
@@ -105,6 +108,12 @@ namespace expr {
         void handleMenuKeyPress(uint16_t key, uint16_t len, uint16_t backKey);
         void drawScrollbar(uint16_t total, uint16_t displayed);
 
+        // The number of functions in the functions menu that start with what has been typed into editorContents.
+        uint16_t getCatalogFuncCount() const;
+        // Gets the full name of the function at an index in the functions menu, counting only the ones that start with
+        // what has been typed into editorContents. Returns nullptr if the index is out of range.
+        const char *getCatalogFunc(uint16_t index) const;
+
         /*
          * These functions handle key presses for a given mode.
          * They're called by handleKeyPress() depending on the current mode.
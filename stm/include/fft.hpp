@@ -0,0 +1,31 @@
+#ifndef __FFT_H__
+#define __FFT_H__
+
+#include <stdint.h>
+
+/*
+ * Discrete Fourier transforms and convolution.
+ *
+ * Complex sequences are stored as interleaved real and imaginary parts, which is the same layout as an n x 2 matrix
+ * of doubles. Power-of-2 lengths use an iterative in-place radix-2 transform with the twiddle factors read from a
+ * sine table in flash; other lengths are reduced to a power-of-2 convolution with Bluestein's algorithm.
+ */
+namespace fft {
+
+    // Largest transform length whose twiddle factors are all in the table; longer transforms compute the rest
+    constexpr uint32_t TABLE_SIZE = 1024;
+    // Convolutions where the shorter sequence has at most this many entries are done directly
+    constexpr uint16_t CONV_DIRECT_THRESHOLD = 32;
+
+    // Transforms n complex values in place. n must be a power of 2.
+    // The inverse transform is scaled by 1/n.
+    void radix2(double *data, uint32_t n, bool inverse);
+    // Transforms n complex values in place, for any n
+    // Returns false if there is not enough memory for Bluestein's algorithm.
+    bool transform(double *data, uint32_t n, bool inverse);
+    // Computes the linear convolution of the real sequences a and b with FFTs
+    // out must have space for na + nb - 1 values. Returns false if there is not enough memory.
+    bool convolve(const double *a, uint16_t na, const double *b, uint16_t nb, double *out);
+} // namespace fft
+
+#endif
@@ -0,0 +1,182 @@
+#ifndef __LOOKUP_H__
+#define __LOOKUP_H__
+
+#include <stdint.h>
+
+/*
+ * Name lookup tables built at compile time from constexpr arrays of names or named entries.
+ *
+ * PerfectHash finds the index of a name with one hash and one string comparison. Its constructor searches for a hash
+ * seed that puts every name in a different slot, so the search runs in the compiler and the table is placed in flash.
+ * PrefixIndex keeps the indices of the names in alphabetical order, so that all the names starting with a prefix can be
+ * found with a binary search.
+ */
+namespace lookup {
+
+    // FNV-1a, followed by a final mix so that the last characters also affect the low bits
+    constexpr uint32_t hash(const char *str, uint32_t seed) {
+        uint32_t h = 2166136261u ^ seed;
+        while (*str != '\0') {
+            h ^= static_cast<uint8_t>(*str++);
+            h *= 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x7FEB352Du;
+        h ^= h >> 15;
+        return h;
+    }
+
+    constexpr bool equal(const char *a, const char *b) {
+        while (*a != '\0' && *a == *b) {
+            ++a;
+            ++b;
+        }
+        return *a == *b;
+    }
+
+    constexpr char toLower(char ch) {
+        return ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch;
+    }
+
+    // Compares two names, ignoring case and anything from the opening bracket of an argument list onwards
+    constexpr int compareNames(const char *a, const char *b) {
+        while (true) {
+            const char ca = *a == '(' ? '\0' : toLower(*a);
+            const char cb = *b == '(' ? '\0' : toLower(*b);
+            if (ca != cb || ca == '\0') {
+                return static_cast<uint8_t>(ca) - static_cast<uint8_t>(cb);
+            }
+            ++a;
+            ++b;
+        }
+    }
+
+    // Compares the first len characters of a name with a prefix, in the same way as compareNames()
+    // Returns 0 if the name starts with the prefix
+    constexpr int comparePrefix(const char *name, const char *prefix, uint16_t len) {
+        for (uint16_t i = 0; i < len; i++) {
+            const char cn = name[i] == '(' ? '\0' : toLower(name[i]);
+            const char cp = toLower(prefix[i]);
+            if (cn != cp) {
+                return static_cast<uint8_t>(cn) - static_cast<uint8_t>(cp);
+            }
+        }
+        return 0;
+    }
+
+    // The name of an entry in a table
+    // Tables of other types can overload this next to the type, where argument-dependent lookup will find it
+    constexpr const char *nameOf(const char *str) {
+        return str;
+    }
+
+    /*
+     * A perfect hash table of N named entries with SIZE slots, which must be a power of 2.
+     *
+     * The more slots there are compared to entries the fewer seeds have to be tried, so SIZE should be at least about
+     * N^2/8. Names that appear more than once map to their first index.
+     */
+    template <uint8_t N, uint16_t SIZE, typename T = const char *>
+    class PerfectHash {
+        static_assert(SIZE != 0 && (SIZE & (SIZE - 1)) == 0, "Table size must be a power of 2");
+        static_assert(N < 0xFF, "Too many names");
+
+    public:
+        // Give up after this many seeds, and leave the table invalid
+        static constexpr uint32_t MAX_SEED = 65536;
+
+        constexpr PerfectHash(const T (&entries)[N]) : entries(entries), seed(0), slots{} {
+            while (seed < MAX_SEED && !tryBuild()) {
+                ++seed;
+            }
+        }
+
+        // Whether a seed was found; check this with a static_assert
+        constexpr bool isValid() const {
+            return seed < MAX_SEED;
+        }
+
+        // Returns the index of the entry named str, or -1 if there is none
+        constexpr int16_t find(const char *str) const {
+            const uint8_t slot = slots[hash(str, seed) & (SIZE - 1)];
+            return slot != 0 && equal(nameOf(entries[slot - 1]), str) ? slot - 1 : -1;
+        }
+
+    private:
+        const T *entries;
+        uint32_t seed;
+        // The index of the name in each slot plus 1, or 0 if the slot is empty
+        uint8_t slots[SIZE];
+
+        constexpr bool tryBuild() {
+            for (uint16_t i = 0; i < SIZE; i++) {
+                slots[i] = 0;
+            }
+            for (uint8_t i = 0; i < N; i++) {
+                bool duplicate = false;
+                for (uint8_t j = 0; j < i && !duplicate; j++) {
+                    duplicate = equal(nameOf(entries[i]), nameOf(entries[j]));
+                }
+                if (duplicate) {
+                    continue;
+                }
+                uint8_t &slot = slots[hash(nameOf(entries[i]), seed) & (SIZE - 1)];
+                if (slot != 0) {
+                    return false;
+                }
+                slot = i + 1;
+            }
+            return true;
+        }
+    };
+
+    // The indices of N names sorted with compareNames()
+    template <uint8_t N>
+    class PrefixIndex {
+    public:
+        constexpr PrefixIndex(const char *const (&names)[N]) : names(names), order{} {
+            // Insertion sort, since N is small and this only runs at compile time
+            for (uint8_t i = 0; i < N; i++) {
+                uint8_t j = i;
+                for (; j > 0 && compareNames(names[order[j - 1]], names[i]) > 0; j--) {
+                    order[j] = order[j - 1];
+                }
+                order[j] = i;
+            }
+        }
+
+        // The index of the ith name in alphabetical order
+        constexpr uint8_t operator[](uint8_t i) const {
+            return order[i];
+        }
+
+        // Finds the names that start with the first len characters of prefix, ignoring case
+        // Returns the number of matches; they are (*this)[first] to (*this)[first + count - 1]
+        constexpr uint8_t search(const char *prefix, uint16_t len, uint8_t &first) const {
+            first = lowerBound(prefix, len, false);
+            return lowerBound(prefix, len, true) - first;
+        }
+
+    private:
+        const char *const *names;
+        uint8_t order[N];
+
+        // The first name that compares greater than or equal to the prefix, or only greater if after is true
+        constexpr uint8_t lowerBound(const char *prefix, uint16_t len, bool after) const {
+            uint8_t lo = 0, hi = N;
+            while (lo < hi) {
+                const uint8_t mid = (lo + hi) / 2;
+                const int cmp = comparePrefix(names[order[mid]], prefix, len);
+                if (cmp < 0 || (after && cmp == 0)) {
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+    };
+} // namespace lookup
+
+#endif
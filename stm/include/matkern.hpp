@@ -0,0 +1,44 @@
+#ifndef __MATKERN_H__
+#define __MATKERN_H__
+
+#include <stdint.h>
+
+/*
+ * Floating-point matrix kernels.
+ *
+ * eval::Matrix dispatches to these when all of its entries are floating-point numbers, bypassing the per-entry
+ * fraction checks in util::Numerical. On the target (Cortex-M3, no cache or FPU) the loops are simply unrolled; on
+ * x86 hosts the matrix multiply is cache-blocked and vectorized with SSE2/AVX2.
+ */
+namespace matkern {
+
+    /*
+     * A strided view of a matrix of doubles.
+     * Entry (i, j) is at data[i * rowStride + j * colStride]. Swapping the strides gives the transpose.
+     */
+    struct View {
+        double *data;
+        uint32_t rowStride;
+        uint32_t colStride;
+
+        inline double &operator()(uint16_t i, uint16_t j) const {
+            return data[i * rowStride + j * colStride];
+        }
+        inline View transpose() const {
+            return {data, colStride, rowStride};
+        }
+    };
+
+    // C (m x n) = alpha * A (m x k) * B (k x n) + beta * C
+    // If beta is 0 the original contents of C are ignored.
+    void gemm(uint16_t m, uint16_t n, uint16_t k, double alpha, const View &a, const View &b, double beta,
+            const View &c);
+    // y += alpha * x, where x and y have strides incX and incY
+    void axpy(uint16_t len, double alpha, const double *x, uint32_t incX, double *y, uint32_t incY);
+    // x *= alpha, where x has stride incX
+    void scal(uint16_t len, double alpha, double *x, uint32_t incX);
+    // Returns the dot product of x and y
+    double dot(uint16_t len, const double *x, uint32_t incX, const double *y, uint32_t incY);
+} // namespace matkern
+
+#endif
@@ -97,13 +97,26 @@ namespace neda {
     class Expr : public NEDAObj {
     public:
         // The width, height, top spacing, x and y coordinates are all cached
-        virtual void computeDimensions(bool recurseParent = true) = 0;
+        // Computes the width, height and top spacing from the cached dimensions of the children
+        virtual void computeDimensions() = 0;
+        // Marks this expr and all its parents as needing their dimensions recomputed
+        // Edits call this instead of recomputing right away, so that a keystroke does not redo the whole tree
+        void invalidate();
+        // Recomputes the dimensions of this expr and every dirty expr inside it, skipping the subtrees that are not dirty
+        // This must be called before the cached dimensions are used; drawing at the cached coords does this
+        void layout();
 
         virtual void updatePosition(int16_t, int16_t) = 0;
 
-        // Draws the expr at the specified coords, updating the cached x and y as it goes
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) = 0;
-        // Draws the expr at the cached coords
+        // Moves the expr to the specified coords and positions everything inside it, without drawing anything
+        // The cached dimensions must be up to date (see layout())
+        virtual void setPosition(int16_t, int16_t);
+        // Draws the expr at the cached coords, without positioning anything
+        // The cached coords must be up to date (see setPosition())
+        virtual void render(lcd::LCD12864 &) = 0;
+        // Lays out, positions and draws the expr at the specified coords
+        void draw(lcd::LCD12864 &, int16_t, int16_t);
+        // Lays out, positions and draws the expr at the cached coords
         void draw(lcd::LCD12864 &);
         // Draws all expressions that are connected in some way to this one. e.g. its parents, siblings, grandparents,
         // etc.
@@ -127,6 +140,14 @@ namespace neda {
         uint16_t topSpacing;
         int16_t x;
         int16_t y;
+        // Whether the cached dimensions are out of date
+        // New exprs start dirty, since they have no dimensions yet
+        bool dirty = true;
+
+    protected:
+        // Calls layout() on every child expr
+        virtual void layoutChildren() {
+        }
     };
 
     /*
@@ -142,7 +163,7 @@ namespace neda {
                     ((Expr *) ex)->parent = this;
                 }
             }
-            computeDimensions();
+            layout();
         }
         Container(const Container &other) : contents(other.contents) {
             for (NEDAObj *ex : contents) {
@@ -150,10 +171,10 @@ namespace neda {
                     ((Expr *) ex)->parent = this;
                 }
             }
-            computeDimensions();
+            layout();
         }
         Container() : contents() {
-            computeDimensions();
+            layout();
         }
 
         static constexpr uint16_t EMPTY_EXPR_WIDTH = 5;
@@ -165,8 +186,9 @@ namespace neda {
         void addAt(uint16_t, NEDAObj *);
         uint16_t indexOf(NEDAObj *);
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         virtual ~Container();
 
@@ -203,6 +225,7 @@ namespace neda {
     protected:
         void _add(NEDAObj *obj);
         void _addAtCursor(NEDAObj *obj, Cursor &cursor);
+        virtual void layoutChildren() override;
     };
 
     // Fraction
@@ -211,14 +234,15 @@ namespace neda {
         Fraction(Expr *numerator, Expr *denominator) : numerator(numerator), denominator(denominator) {
             numerator->parent = this;
             denominator->parent = this;
-            computeDimensions();
+            layout();
         }
         Fraction() : numerator(nullptr), denominator(nullptr) {
-            computeDimensions();
+            layout();
         }
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         Expr *getNumerator();
         Expr *getDenominator();
@@ -241,17 +265,20 @@ namespace neda {
         Expr *denominator;
 
         virtual Fraction *copy() override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     // Left bracket
     class LeftBracket : public Expr {
     public:
         LeftBracket() {
-            computeDimensions();
+            layout();
         }
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void render(lcd::LCD12864 &) override;
         // Do nothing
         // Realistically this method is never going to be called on LeftBracket anyways
         virtual void getCursor(Cursor &cursor, CursorLocation location) override {
@@ -270,11 +297,11 @@ namespace neda {
     class RightBracket : public Expr {
     public:
         RightBracket() {
-            computeDimensions();
+            layout();
         }
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void render(lcd::LCD12864 &) override;
         // Do nothing
         // Realistically this method is never going to be called on RightBracket anyways
         virtual void getCursor(Cursor &cursor, CursorLocation location) override {
@@ -298,17 +325,18 @@ namespace neda {
             if (n) {
                 n->parent = this;
             }
-            computeDimensions();
+            layout();
         }
         Radical() : contents(nullptr), n(nullptr) {
-            computeDimensions();
+            layout();
         }
 
         static constexpr uint16_t CONTENTS_N_OVERLAP = 7;
         static constexpr uint16_t SIGN_N_OVERLAP = 1;
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         void setContents(Expr *);
         void setN(Expr *);
@@ -328,6 +356,9 @@ namespace neda {
         Expr *contents, *n;
 
         virtual Radical *copy() override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     // Superscript
@@ -335,16 +366,17 @@ namespace neda {
     public:
         Superscript(Expr *contents) : contents(contents) {
             contents->parent = this;
-            computeDimensions();
+            layout();
         }
         Superscript() : contents(nullptr) {
-            computeDimensions();
+            layout();
         }
 
         static constexpr uint16_t OVERLAP = 4;
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         void setContents(Expr *);
 
@@ -361,6 +393,9 @@ namespace neda {
         Expr *contents;
 
         virtual Superscript *copy() override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     // Subscript
@@ -368,16 +403,17 @@ namespace neda {
     public:
         Subscript(Expr *contents) : contents(contents) {
             contents->parent = this;
-            computeDimensions();
+            layout();
         }
         Subscript() : contents(nullptr) {
-            computeDimensions();
+            layout();
         }
 
         static constexpr uint16_t OVERLAP = 4;
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         void setContents(Expr *);
 
@@ -394,6 +430,9 @@ namespace neda {
         Expr *contents;
 
         virtual Subscript *copy() override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     // Summation (Sigma) or Product (Pi)
@@ -405,16 +444,17 @@ namespace neda {
             finish->parent = this;
             contents->parent = this;
 
-            computeDimensions();
+            layout();
         }
         SigmaPi(const lcd::Image &symbol) : symbol(symbol), start(nullptr), finish(nullptr), contents(nullptr) {
-            computeDimensions();
+            layout();
         }
 
         static constexpr uint16_t CONTENT_SYMBOL_OVERLAP = 12;
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         void setStart(Expr *start);
         void setFinish(Expr *finish);
@@ -437,6 +477,9 @@ namespace neda {
         Expr *start, *finish, *contents;
 
         virtual SigmaPi *copy() override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     // Matrix/Column Vector
@@ -465,12 +508,12 @@ namespace neda {
             return x + y * n;
         }
         // Sets an entry
-        // DOES NOT RECOMPUTE THE SIZE!
         inline void setEntry(uint8_t row, uint8_t col, Expr *entry) {
             contents[index_0(col, row)] = entry;
             if(entry != nullptr) {
                 entry->parent = this;
             }
+            invalidate();
         }
         inline Expr *getEntry(uint8_t row, uint8_t col) {
             return contents[index_0(col, row)];
@@ -483,8 +526,9 @@ namespace neda {
 
         bool findElem(Expr *ex, uint8_t &rowOut, uint8_t &colOut);
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         virtual void left(Expr *, Cursor &) override;
         virtual void right(Expr *, Cursor &) override;
@@ -497,6 +541,9 @@ namespace neda {
         virtual Matrix *copy() override;
 
         virtual ObjType getType() const override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     // Piecewise function
@@ -506,7 +553,7 @@ namespace neda {
             values = new Expr *[pieces];
             conditions = new Expr *[pieces];
             memset(values, 0, pieces * sizeof(Expr *));
-            memset(values, 0, pieces * sizeof(Expr *));
+            memset(conditions, 0, pieces * sizeof(Expr *));
         }
 
         virtual ~Piecewise();
@@ -516,16 +563,16 @@ namespace neda {
         Expr **conditions;
 
         // Sets a value
-        // DOES NOT RECOMPUTE THE SIZE!
         inline void setValue(uint8_t index, Expr *value) {
             values[index] = value;
             value->parent = this;
+            invalidate();
         }
         // Sets a condition
-        // DOES NOT RECOMPUTE THE SIZE!
         inline void setCondition(uint8_t index, Expr *condition) {
             conditions[index] = condition;
             condition->parent = this;
+            invalidate();
         }
 
         static constexpr uint16_t VALUE_CONDITION_SPACING = 4;
@@ -533,8 +580,9 @@ namespace neda {
         static constexpr uint16_t LEFT_SPACING = 4;
         static constexpr uint16_t TOP_SPACING = 2;
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         virtual void left(Expr *, Cursor &) override;
         virtual void right(Expr *, Cursor &) override;
@@ -547,6 +595,9 @@ namespace neda {
         virtual Piecewise *copy() override;
 
         virtual ObjType getType() const override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     // Absolute value
@@ -554,24 +605,25 @@ namespace neda {
     public:
         Abs(Expr *contents) : contents(contents) {
             contents->parent = this;
-            computeDimensions();
+            layout();
         }
         Abs() : contents(nullptr) {
-            computeDimensions();
+            layout();
         }
 
         inline void setContents(Expr *contents) {
             this->contents = contents;
             contents->parent = this;
-            computeDimensions();
+            invalidate();
         }
 
         virtual ~Abs();
 
         Expr *contents;
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &, int16_t, int16_t) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t, int16_t) override;
+        virtual void render(lcd::LCD12864 &) override;
 
         virtual void getCursor(Cursor &, CursorLocation) override;
 
@@ -580,6 +632,9 @@ namespace neda {
         virtual Abs *copy() override;
 
         virtual ObjType getType() const override;
+
+    protected:
+        virtual void layoutChildren() override;
     };
 
     class Derivative : public Expr {
@@ -590,8 +645,9 @@ namespace neda {
 
         Expr *contents;
 
-        virtual void computeDimensions(bool recurseParent = true) override;
-        virtual void draw(lcd::LCD12864 &display, int16_t x, int16_t y) override;
+        virtual void computeDimensions() override;
+        virtual void setPosition(int16_t x, int16_t y) override;
+        virtual void render(lcd::LCD12864 &display) override;
 
         virtual void getCursor(Cursor &cursor, CursorLocation location) override;
 
@@ -0,0 +1,86 @@
+#ifndef __NUMTHEORY_H__
+#define __NUMTHEORY_H__
+
+#include <stdint.h>
+
+/*
+ * Number theory on 64-bit integers.
+ *
+ * Modular multiplication needs the full 128-bit product, which the Cortex-M3 doesn't have, so it is put together from
+ * 32x32->64-bit multiplies. For odd moduli everything is done in Montgomery form, which replaces the 128-bit division
+ * by a few more multiplies.
+ */
+namespace numtheory {
+
+    // hi:lo = a * b
+    void mul128(uint64_t a, uint64_t b, uint64_t &hi, uint64_t &lo);
+
+    /*
+     * Montgomery arithmetic modulo an odd n, with R = 2^64.
+     * Values in Montgomery form are aR mod n; they can be added and subtracted normally (mod n).
+     */
+    class Montgomery {
+    public:
+        Montgomery(uint64_t n);
+
+        uint64_t n;
+        // R mod n, i.e. 1 in Montgomery form
+        uint64_t one;
+
+        // Converts to and from Montgomery form
+        uint64_t to(uint64_t a) const;
+        uint64_t from(uint64_t a) const;
+        // Multiplies two numbers in Montgomery form
+        uint64_t mul(uint64_t a, uint64_t b) const;
+        // Raises a number in Montgomery form to a (normal) power
+        uint64_t pow(uint64_t a, uint64_t e) const;
+
+    protected:
+        // -n^-1 mod R
+        uint64_t nPrime;
+        // R^2 mod n
+        uint64_t r2;
+
+        // Computes TR^-1 mod n for T = hi:lo < nR
+        uint64_t reduce(uint64_t hi, uint64_t lo) const;
+    };
+
+    // a + b mod n, for a, b < n
+    inline uint64_t addmod(uint64_t a, uint64_t b, uint64_t n) {
+        const uint64_t sum = a + b;
+        return sum < a || sum >= n ? sum - n : sum;
+    }
+    // a * b mod n
+    uint64_t mulmod(uint64_t a, uint64_t b, uint64_t n);
+    // a^e mod n
+    uint64_t powmod(uint64_t a, uint64_t e, uint64_t n);
+    // The inverse of a mod n, or 0 if a and n are not coprime
+    int64_t modinv(int64_t a, int64_t n);
+    // Greatest common divisor, which is 0 only if both are 0
+    uint64_t gcd(uint64_t a, uint64_t b);
+
+    // Deterministic Miller-Rabin, exact for all 64-bit numbers
+    bool isPrime(uint64_t n);
+    // Finds the prime factors of n, with multiplicity and in ascending order
+    // factors must have space for 64 entries (no 64-bit number has more). Returns the number of factors.
+    uint8_t factor(uint64_t n, uint64_t *factors);
+
+    // The largest n for which n! fits in an int64 and a double respectively
+    constexpr uint8_t MAX_EXACT_FACTORIAL = 20;
+    constexpr uint8_t MAX_FACTORIAL = 170;
+    // n! exactly, for n <= MAX_EXACT_FACTORIAL
+    int64_t factorial(uint8_t n);
+    // n! correctly rounded to a double; infinity if n > MAX_FACTORIAL
+    double factorialDouble(uint32_t n);
+    /*
+     * nCr and nPr for 0 <= k <= n. Return false if the result doesn't fit in an int64.
+     * Intermediate values never exceed the result, so these succeed whenever the result fits.
+     */
+    bool binomial(int64_t n, int64_t k, int64_t &out);
+    bool permutations(int64_t n, int64_t k, int64_t &out);
+    // nCr and nPr as doubles, for when the result is too large for an int64
+    double binomialDouble(int64_t n, int64_t k);
+    double permutationsDouble(int64_t n, int64_t k);
+} // namespace numtheory
+
+#endif
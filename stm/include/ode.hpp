@@ -0,0 +1,47 @@
+#ifndef __ODE_H__
+#define __ODE_H__
+
+#include <stdint.h>
+
+/*
+ * Initial value problems for systems of ordinary differential equations y' = f(t, y).
+ *
+ * Integration uses the Dormand-Prince 5(4) embedded Runge-Kutta pair with adaptive step size control. The last stage
+ * of each step is evaluated at the new point, so it is reused as the first stage of the next step, which makes it 6
+ * evaluations of f per step.
+ */
+namespace ode {
+
+    // The most steps a single call to integrate() will take before giving up
+    constexpr uint16_t MAX_STEPS = 4096;
+
+    // The right-hand side f(t, y) of a system
+    class System {
+    public:
+        virtual ~System() {};
+
+        // Computes f(t, y) into dydt. Returns false if f cannot be evaluated.
+        virtual bool operator()(double t, const double *y, double *dydt) = 0;
+    };
+
+    enum class Status : uint8_t {
+        OK,
+        // f could not be evaluated, or there was not enough memory
+        ERROR,
+        // The step size needed to meet the tolerance became too small to make progress
+        STEP_TOO_SMALL,
+        // MAX_STEPS was reached
+        TOO_MANY_STEPS,
+    };
+
+    /*
+     * Integrates the system of n equations from t to tEnd, updating t and y in place. tEnd may be less than t.
+     * tol is used as both the absolute and the relative tolerance on the local error of each step.
+     *
+     * h is the step size to try first, or 0 to choose one automatically. On return it holds the step size for the next
+     * step, so that consecutive calls (e.g. for a series of output points) carry on without starting over.
+     */
+    Status integrate(System &f, uint16_t n, double &t, double tEnd, double *y, double tol, double &h);
+} // namespace ode
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef __OPTIM_H__
+#define __OPTIM_H__
+
+#include <stdint.h>
+
+/*
+ * Derivative-free minimization.
+ *
+ * Functions of one variable on an interval use Brent's method, which takes parabolic interpolation steps when the
+ * function looks smooth and falls back to golden section search when it doesn't. Functions of several variables use
+ * the Nelder-Mead simplex method.
+ */
+namespace optim {
+
+    // Default tolerance on x for brent(), the square root of the machine epsilon
+    // Near a minimum f only changes quadratically, so x can't be found more accurately than this
+    constexpr double BRENT_DEFAULT_TOLERANCE = 1.5e-8;
+    constexpr uint16_t BRENT_MAX_ITERATIONS = 200;
+    // Nelder-Mead gives up after this many evaluations per variable
+    constexpr uint16_t NELDER_MEAD_MAX_EVALUATIONS = 400;
+
+    // A function to minimize
+    class Objective {
+    public:
+        virtual ~Objective() {};
+
+        // Computes f(x) into fx. Returns false if f cannot be evaluated.
+        virtual bool operator()(const double *x, double &fx) = 0;
+    };
+
+    enum class Status : uint8_t {
+        OK,
+        // f could not be evaluated, or there was not enough memory
+        ERROR,
+        // The iteration limit was reached
+        NOT_CONVERGED,
+    };
+
+    /*
+     * Finds a local minimum of a function of one variable in [a, b], to a tolerance of tol * (|x| + 1) in x.
+     * The minimum and the value there are written to x and fx, and the number of evaluations of f to evaluations.
+     */
+    Status brent(Objective &f, double a, double b, double tol, double &x, double &fx, uint16_t &evaluations);
+    /*
+     * Finds a local minimum of a function of n variables, starting from x and updating it in place.
+     * Stops once every vertex of the simplex is within tol of the best one both in x and in f(x).
+     * The value at the minimum is written to fx, and the number of evaluations of f to evaluations.
+     */
+    Status nelderMead(Objective &f, uint16_t n, double *x, double tol, double &fx, uint16_t &evaluations);
+} // namespace optim
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef __POLY_H__
+#define __POLY_H__
+
+#include <stdint.h>
+
+/*
+ * Polynomials with real coefficients.
+ *
+ * A polynomial with n coefficients c is c[0] + c[1]x + ... + c[n-1]x^(n-1), i.e. the coefficients are in ascending
+ * order of power. Complex values (the roots) use the same interleaved layout as the FFT, so they can be copied
+ * straight into an n x 2 matrix.
+ */
+namespace poly {
+
+    struct Complex {
+        double re;
+        double im;
+    };
+
+    // Evaluates the polynomial at x with Horner's scheme
+    double evaluate(const double *c, uint16_t n, double x);
+    // Computes the derivative; out must have space for n - 1 coefficients
+    void derivative(const double *c, uint16_t n, double *out);
+    // Computes the product; out must have space for na + nb - 1 coefficients
+    void multiply(const double *a, uint16_t na, const double *b, uint16_t nb, double *out);
+
+    /*
+     * Finds all n - 1 complex roots at once with the Aberth-Ehrlich iteration, sorted by their real and then their
+     * imaginary parts. The leading coefficient must be nonzero.
+     * Returns false if the iteration did not converge.
+     */
+    bool roots(const double *c, uint16_t n, Complex *out);
+} // namespace poly
+
+#endif
@@ -76,6 +76,19 @@ namespace pt {
     extern const uint8_t PERIOD_LENGTHS[];
     extern const uint8_t PERIOD_COUNT;
 
+    // Where an element is in ELEMENTS
+    struct ElementIndex {
+        uint8_t period;
+        uint8_t index;
+    };
+
+    // Search indices generated with the element data
+    // Sorted by atomic number, and case-insensitively by symbol and by name
+    extern const ElementIndex ELEMENTS_BY_NUMBER[];
+    extern const ElementIndex ELEMENTS_BY_SYMBOL[];
+    extern const ElementIndex ELEMENTS_BY_NAME[];
+    extern const uint8_t ELEMENT_COUNT;
+
     const Element *elemWithLocation(const Location &location);
     const Element *rightOf(Location &locationIO);
     const Element *leftOf(Location &locationIO);
@@ -86,10 +99,16 @@ namespace pt {
     void drawElementInfo(int16_t x, int16_t y, const Element *elem, uint8_t field, lcd::LCD12864 &disp);
 
     const Element *searchElemByNumber(Location &locationOut, uint8_t atomicNumber);
-    const Element *searchElemByString(
-            Location &locationOut, const char *(*field)(const Element *), const char *str, uint16_t len = UINT16_MAX);
+    // Finds an element whose field matches str exactly, or else the lowest numbered one whose field starts with str
+    // The index must be sorted by the field
+    const Element *searchElemByString(Location &locationOut, const ElementIndex *index,
+            const char *(*field)(const Element *), const char *str, uint16_t len = UINT16_MAX);
     const Element *searchElemBySymbol(Location &locationOut, const char *str, uint16_t len = UINT16_MAX);
     const Element *searchElemByName(Location &locationOut, const char *str, uint16_t len = UINT16_MAX);
+
+    // Computes the molar mass in g/mol of a chemical formula, e.g. H2SO4, Ca(OH)2 or CuSO4*5H2O
+    // Returns NAN if the formula is not valid
+    double molarMass(const char *formula);
 } // namespace pt
 
 #endif
@@ -0,0 +1,36 @@
+#ifndef __RNG_H__
+#define __RNG_H__
+
+#include <stdint.h>
+
+/*
+ * A seedable pseudorandom number generator.
+ *
+ * The generator is xoshiro128**, which only needs 32-bit shifts, rotates and multiplies, so it is fast on the
+ * Cortex-M3 and has a period of 2^128 - 1. Seeding always gives the same stream for the same seed. Normally distributed
+ * numbers use the ziggurat method, which needs one 32-bit output, a table lookup and a multiply for about 99% of them.
+ */
+namespace rng {
+
+    // Sets the state from a seed; every seed (including 0) gives a valid state
+    void seed(uint64_t s);
+    // The next 32 random bits
+    uint32_t next();
+    // The next 64 random bits
+    inline uint64_t next64() {
+        return static_cast<uint64_t>(next()) << 32 | next();
+    }
+    // Uniformly distributed in [0, 1), with all 53 bits of the mantissa random
+    double uniform();
+    // Uniformly distributed integer in [0, n), without modulo bias
+    // n = 0 stands for 2^64
+    uint64_t below(uint64_t n);
+    // Standard normal distribution
+    double normal();
+
+    // Fill count doubles at once with uniform() or normal()
+    void fillUniform(double *out, uint32_t count);
+    void fillNormal(double *out, uint32_t count);
+} // namespace rng
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef __SORT_H__
+#define __SORT_H__
+
+#include "util.hpp"
+#include <stdint.h>
+
+/*
+ * In-place sorting and selection on arrays.
+ *
+ * Neither allocates, and both keep a depth limit so that bad pivots can't make them quadratic: introsort falls back
+ * to heapsort, and introselect falls back to heapsorting the range it has narrowed down to. Recursion only ever goes
+ * into the smaller half, so the stack use is O(log n).
+ */
+namespace util {
+
+    // Ranges at most this long are finished with insertion sort
+    constexpr uint8_t INSERTION_SORT_CUTOFF = 16;
+
+    template <typename T, typename Less>
+    void insertionSort(T *a, uint32_t n, Less less) {
+        for (uint32_t i = 1; i < n; i++) {
+            const T x = a[i];
+            uint32_t j = i;
+            for (; j > 0 && less(x, a[j - 1]); j--) {
+                a[j] = a[j - 1];
+            }
+            a[j] = x;
+        }
+    }
+
+    template <typename T, typename Less>
+    void siftDown(T *a, uint32_t i, uint32_t n, Less less) {
+        const T x = a[i];
+        while (2 * i + 1 < n) {
+            uint32_t child = 2 * i + 1;
+            if (child + 1 < n && less(a[child], a[child + 1])) {
+                child++;
+            }
+            if (!less(x, a[child])) {
+                break;
+            }
+            a[i] = a[child];
+            i = child;
+        }
+        a[i] = x;
+    }
+
+    template <typename T, typename Less>
+    void heapSort(T *a, uint32_t n, Less less) {
+        for (uint32_t i = n / 2; i-- > 0;) {
+            siftDown(a, i, n, less);
+        }
+        for (uint32_t i = n; i-- > 1;) {
+            swap(a[0], a[i]);
+            siftDown(a, 0, i, less);
+        }
+    }
+
+    /*
+     * Partitions around the median of the first, middle and last entries.
+     * Returns the final index p of the pivot; everything before it is not greater and everything after is not less.
+     * n must be at least 3.
+     */
+    template <typename T, typename Less>
+    uint32_t partition(T *a, uint32_t n, Less less) {
+        const uint32_t mid = n / 2;
+        if (less(a[mid], a[0])) {
+            swap(a[mid], a[0]);
+        }
+        if (less(a[n - 1], a[0])) {
+            swap(a[n - 1], a[0]);
+        }
+        if (less(a[n - 1], a[mid])) {
+            swap(a[n - 1], a[mid]);
+        }
+        swap(a[0], a[mid]);
+        const T pivot = a[0];
+
+        // The scans are bounds-checked, so a comparison that isn't a strict weak order can't run off the ends
+        uint32_t i = 0;
+        uint32_t j = n;
+        while (true) {
+            do {
+                i++;
+            } while (i < n && less(a[i], pivot));
+            do {
+                j--;
+            } while (j > 0 && less(pivot, a[j]));
+            if (i >= j) {
+                break;
+            }
+            swap(a[i], a[j]);
+        }
+        swap(a[0], a[j]);
+        return j;
+    }
+
+    inline uint8_t introDepthLimit(uint32_t n) {
+        uint8_t depth = 0;
+        for (; n > 1; n >>= 1) {
+            depth += 2;
+        }
+        return depth;
+    }
+
+    template <typename T, typename Less>
+    void introsort(T *a, uint32_t n, uint8_t depth, Less less) {
+        while (n > INSERTION_SORT_CUTOFF) {
+            if (depth-- == 0) {
+                heapSort(a, n, less);
+                return;
+            }
+            const uint32_t p = partition(a, n, less);
+            // Recurse into the smaller side and keep looping on the larger one
+            if (p < n - p - 1) {
+                introsort(a, p, depth, less);
+                a += p + 1;
+                n -= p + 1;
+            }
+            else {
+                introsort(a + p + 1, n - p - 1, depth, less);
+                n = p;
+            }
+        }
+        insertionSort(a, n, less);
+    }
+
+    // Sorts a in ascending order according to less
+    template <typename T, typename Less>
+    void introsort(T *a, uint32_t n, Less less) {
+        introsort(a, n, introDepthLimit(n), less);
+    }
+
+    /*
+     * Reorders a so that a[k] is the entry that would be there if a were sorted, with everything before it not greater
+     * and everything after it not less. Takes O(n) time on average.
+     */
+    template <typename T, typename Less>
+    void introselect(T *a, uint32_t n, uint32_t k, Less less) {
+        uint8_t depth = introDepthLimit(n);
+        while (n > INSERTION_SORT_CUTOFF) {
+            if (depth-- == 0) {
+                heapSort(a, n, less);
+                return;
+            }
+            const uint32_t p = partition(a, n, less);
+            if (p == k) {
+                return;
+            }
+            if (k < p) {
+                n = p;
+            }
+            else {
+                a += p + 1;
+                n -= p + 1;
+                k -= p + 1;
+            }
+        }
+        insertionSort(a, n, less);
+    }
+} // namespace util
+
+#endif
@@ -1,10 +1,16 @@
 #ifndef __UNITCONV_H__
 #define __UNITCONV_H__
 
+#include <stdint.h>
+
 namespace eval {
 
     double convertUnits(double, const char *, const char *);
 
+    // The number of SI base quantities units can be made of
+    // In order: length (m), mass (kg), time (s), electric current (A), temperature (K), amount of substance (mol)
+    constexpr uint8_t BASE_QUANTITY_COUNT = 6;
+
     /*
      * Represents a unit.
      *
@@ -23,7 +29,32 @@ namespace eval {
         // A constant added/subtracted during conversion.
         // For more information see docs for the struct Unit.
         double bias;
+        // The power of each base quantity in the unit. E.g. N is kg m s^-2, so this is {1, 1, -2, 0, 0, 0}.
+        int8_t dimension[BASE_QUANTITY_COUNT];
+        // Whether SI prefixes can be put in front of the name, e.g. k in km.
+        bool prefixable;
     };
+
+    /*
+     * A unit made of prefixed units raised to powers, e.g. km/h or kg m/s2.
+     *
+     * The conversion and bias work the same way as in Unit. Only a single unit to the first power can have a bias, since
+     * e.g. J/C is a unit of energy per temperature difference and so does not include the offset of Celsius.
+     */
+    struct CompoundUnit {
+        double conversion;
+        double bias;
+        int8_t dimension[BASE_QUANTITY_COUNT];
+    };
+
+    /*
+     * Parses a unit. Returns false if it is not valid.
+     *
+     * Each part of the unit is a unit name with an optional SI prefix, followed by an optional integer power, e.g. cm3.
+     * Parts are multiplied when separated by a multiplication sign, and everything after a division sign is divided by,
+     * so J/kg*K is J/(kg K).
+     */
+    bool parseUnit(const char *str, CompoundUnit &unit);
 } // namespace eval
 
 #endif
@@ -0,0 +1,388 @@
+#include "bench.hpp"
+#include "eval.hpp"
+#include "neda.hpp"
+#include "numtheory.hpp"
+#include "rng.hpp"
+#include "sort.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The DWT registers are not defined by the CMSIS version used
+#define DEMCR (*reinterpret_cast<volatile uint32_t *>(0xE000EDFC))
+#define DWT_CTRL (*reinterpret_cast<volatile uint32_t *>(0xE0001000))
+#define DWT_CYCCNT (*reinterpret_cast<volatile uint32_t *>(0xE0001004))
+#define DEMCR_TRCENA 0x01000000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+
+namespace bench {
+
+    constexpr double PI = 3.14159265358979323846;
+
+    void initCycleCounter() {
+        DEMCR |= DEMCR_TRCENA;
+        DWT_CYCCNT = 0;
+        DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+    }
+
+    uint32_t cycles() {
+        return DWT_CYCCNT;
+    }
+
+    // Creates a matrix with random floating-point entries
+    eval::Matrix *randomMatrix(uint16_t m, uint16_t n) {
+        eval::Matrix *mat = new eval::Matrix(m, n);
+        for (uint32_t i = 0; i < mat->size(); i++) {
+            mat->set(i, static_cast<double>(rand()) / RAND_MAX - 0.5);
+        }
+        return mat;
+    }
+
+    /*
+     * LU decomposition vs. Gauss-Jordan elimination for det, inv and solve.
+     */
+    void lu() {
+        printf("size  gj inv    lu inv    lu det    solve     cached\n");
+        for (uint8_t n = 8; n <= 16; n += 2) {
+            eval::Matrix *a = randomMatrix(n, n);
+            eval::Matrix *b = randomMatrix(n, 1);
+            eval::LUDecomposition::clearCache();
+
+            // Old method: Gauss-Jordan on [A|I]
+            uint32_t start = cycles();
+            eval::Matrix block(n, 2 * n);
+            for (uint8_t i = 0; i < n; i++) {
+                for (uint8_t j = 0; j < n; j++) {
+                    block.setEntry(i, j, a->getEntry(i, j));
+                }
+                block.setEntry(i, i + n, 1);
+            }
+            block.eliminate(false);
+            uint32_t gjInv = cycles() - start;
+
+            start = cycles();
+            delete a->inv();
+            uint32_t luInv = cycles() - start;
+            eval::LUDecomposition::clearCache();
+
+            start = cycles();
+            a->det();
+            uint32_t luDet = cycles() - start;
+            eval::LUDecomposition::clearCache();
+
+            start = cycles();
+            delete eval::LUDecomposition::of(*a).solve(*b);
+            uint32_t solve = cycles() - start;
+
+            // Same matrix again, this time the factorization should be reused
+            start = cycles();
+            delete eval::LUDecomposition::of(*a).solve(*b);
+            uint32_t cached = cycles() - start;
+
+            printf("%2dx%-2d %-9lu %-9lu %-9lu %-9lu %lu\n", n, n, gjInv, luInv, luDet, solve, cached);
+            delete a;
+            delete b;
+        }
+        eval::LUDecomposition::clearCache();
+    }
+
+    /*
+     * Matrix multiplication with util::Numerical arithmetic vs. the floating-point kernel.
+     * The larger sizes won't fit in RAM on the device and are shown as "-".
+     */
+    void matmul() {
+        static const uint8_t SIZES[] = {2, 4, 8, 16, 24, 32, 48, 64};
+        // Above this size 3 matrices of util::Numerical don't fit in RAM alongside everything else
+        constexpr uint8_t NUMERICAL_MAX_SIZE = 16;
+
+        printf("size  numerical kernel\n");
+        for (uint8_t n : SIZES) {
+            double *a = static_cast<double *>(malloc(sizeof(double) * n * n));
+            double *b = static_cast<double *>(malloc(sizeof(double) * n * n));
+            double *c = static_cast<double *>(malloc(sizeof(double) * n * n));
+            if (!a || !b || !c) {
+                printf("%2dx%-2d -         -\n", n, n);
+                free(a);
+                free(b);
+                free(c);
+                continue;
+            }
+            for (uint16_t i = 0; i < n * n; i++) {
+                a[i] = static_cast<double>(rand()) / RAND_MAX - 0.5;
+                b[i] = static_cast<double>(rand()) / RAND_MAX - 0.5;
+            }
+
+            char numericalStr[12] = "-";
+            if (n <= NUMERICAL_MAX_SIZE) {
+                eval::Matrix numA(n, n), numB(n, n), numC(n, n);
+                for (uint16_t i = 0; i < n * n; i++) {
+                    numA.set(i, a[i]);
+                    numB.set(i, b[i]);
+                }
+                // Same loop as the generic path in Matrix::multiply
+                uint32_t start = cycles();
+                for (uint8_t i = 0; i < n; i++) {
+                    for (uint8_t j = 0; j < n; j++) {
+                        util::Numerical sum = 0;
+                        for (uint8_t k = 0; k < n; k++) {
+                            sum += numA.getEntry(i, k) * numB.getEntry(k, j);
+                        }
+                        numC.setEntry(i, j, sum);
+                    }
+                }
+                snprintf(numericalStr, sizeof(numericalStr), "%lu", cycles() - start);
+            }
+
+            const matkern::View aView = {a, n, 1}, bView = {b, n, 1}, cView = {c, n, 1};
+            uint32_t start = cycles();
+            matkern::gemm(n, n, n, 1, aView, bView, 0, cView);
+            uint32_t kernel = cycles() - start;
+
+            printf("%2dx%-2d %-9s %lu\n", n, n, numericalStr, kernel);
+            free(a);
+            free(b);
+            free(c);
+        }
+    }
+
+    int compareDoubles(const void *a, const void *b) {
+        const double x = *static_cast<const double *>(a);
+        const double y = *static_cast<const double *>(b);
+        return x < y ? -1 : x > y ? 1 : 0;
+    }
+
+    /*
+     * Introsort vs. the C library's qsort, and finding the median with introselect instead of sorting.
+     */
+    void sort() {
+        static const uint16_t SIZES[] = {64, 256, 1024, 2048};
+        const auto less = [](double a, double b) {
+            return a < b;
+        };
+
+        printf("size  qsort     introsort select\n");
+        for (uint16_t n : SIZES) {
+            // The random values, and a copy for each run to work on
+            double *values = static_cast<double *>(malloc(sizeof(double) * n));
+            double *work = static_cast<double *>(malloc(sizeof(double) * n));
+            if (!values || !work) {
+                printf("%-5d -         -         -\n", n);
+                free(values);
+                free(work);
+                continue;
+            }
+            for (uint16_t i = 0; i < n; i++) {
+                values[i] = static_cast<double>(rand()) / RAND_MAX - 0.5;
+            }
+
+            memcpy(work, values, sizeof(double) * n);
+            uint32_t start = cycles();
+            qsort(work, n, sizeof(double), &compareDoubles);
+            uint32_t qsortCycles = cycles() - start;
+
+            memcpy(work, values, sizeof(double) * n);
+            start = cycles();
+            util::introsort(work, n, less);
+            uint32_t introsortCycles = cycles() - start;
+
+            memcpy(work, values, sizeof(double) * n);
+            start = cycles();
+            util::introselect(work, n, n / 2, less);
+            uint32_t selectCycles = cycles() - start;
+
+            printf("%-5d %-9lu %-9lu %lu\n", n, qsortCycles, introsortCycles, selectCycles);
+            free(values);
+            free(work);
+        }
+    }
+
+    /*
+     * Primality testing and factoring of 64-bit numbers, the worst cases being semiprimes with two large factors.
+     */
+    void factor() {
+        static const uint64_t NUMBERS[] = {
+            // Largest 64-bit prime
+            18446744073709551557ULL,
+            // 1000000007 * 998244353
+            998244359987710471ULL,
+            // Product of the two largest 32-bit primes
+            18446743979220271189ULL,
+        };
+        uint64_t factors[64];
+
+        printf("n                     isPrime   factor\n");
+        for (uint64_t n : NUMBERS) {
+            uint32_t start = cycles();
+            numtheory::isPrime(n);
+            uint32_t primeCycles = cycles() - start;
+
+            start = cycles();
+            numtheory::factor(n, factors);
+            uint32_t factorCycles = cycles() - start;
+
+            printf("%-21llu %-9lu %lu\n", n, primeCycles, factorCycles);
+        }
+    }
+
+    /*
+     * nCr near the limit of int64, where the naive product overflows, and factorials with exact vs. naive products.
+     */
+    void combinatorics() {
+        static const int64_t BINOMIALS[][2] = {
+            // Largest central binomial that fits
+            {66, 33},
+            // Just under 2^63, needs the gcd reduction
+            {4294967296, 2},
+            // Too large, falls back to doubles
+            {67, 33},
+            {1000, 500},
+        };
+
+        printf("n          k     nCr\n");
+        for (const auto &args : BINOMIALS) {
+            int64_t result;
+            const uint32_t start = cycles();
+            if (!numtheory::binomial(args[0], args[1], result)) {
+                numtheory::binomialDouble(args[0], args[1]);
+            }
+            printf("%-10lld %-5lld %lu\n", args[0], args[1], cycles() - start);
+        }
+
+        static const uint8_t FACTORIALS[] = {20, 100, 170};
+        printf("n     naive     rounded\n");
+        for (uint8_t n : FACTORIALS) {
+            uint32_t start = cycles();
+            volatile double naive = 1;
+            for (uint8_t i = 2; i <= n; i++) {
+                naive = naive * i;
+            }
+            const uint32_t naiveCycles = cycles() - start;
+
+            start = cycles();
+            numtheory::factorialDouble(n);
+            printf("%-5d %-9lu %lu\n", n, naiveCycles, cycles() - start);
+        }
+    }
+
+    /*
+     * newlib rand() vs. the xoshiro128** generator, and the ziggurat vs. the Box-Muller transform.
+     * Cycles are per number.
+     */
+    void prng() {
+        constexpr uint16_t COUNT = 1000;
+        static double values[COUNT];
+
+        uint32_t start = cycles();
+        for (uint16_t i = 0; i < COUNT; i++) {
+            values[i] = static_cast<double>(rand()) / RAND_MAX;
+        }
+        const uint32_t newlib = cycles() - start;
+
+        start = cycles();
+        rng::fillUniform(values, COUNT);
+        const uint32_t uniform = cycles() - start;
+
+        start = cycles();
+        for (uint16_t i = 0; i < COUNT; i += 2) {
+            const double r = sqrt(-2 * log(1 - rng::uniform()));
+            const double theta = 2 * PI * rng::uniform();
+            values[i] = r * cos(theta);
+            values[i + 1] = r * sin(theta);
+        }
+        const uint32_t boxMuller = cycles() - start;
+
+        start = cycles();
+        rng::fillNormal(values, COUNT);
+        const uint32_t ziggurat = cycles() - start;
+
+        printf("rand()    uniform   boxmuller ziggurat\n");
+        printf("%-9lu %-9lu %-9lu %lu\n", newlib / COUNT, uniform / COUNT, boxMuller / COUNT, ziggurat / COUNT);
+    }
+
+    /*
+     * Keystroke-to-layout time in large expressions, i.e. adding a character and laying out the tree again before it
+     * is drawn. Each term is (123/(2 1/x))^2+, and characters are typed at the end of the expression and in the
+     * innermost fraction of the last term. The burst types all the characters before a single layout.
+     * Cycles are per character.
+     */
+    void keystroke() {
+        constexpr uint8_t KEYS = 8;
+
+        printf("terms top       nested    burst\n");
+        for (uint8_t terms = 8; terms <= 32; terms *= 2) {
+            neda::Container *top = new neda::Container();
+            neda::Container *inner = nullptr;
+            for (uint8_t i = 0; i < terms; i++) {
+                inner = neda::makeString("x");
+                neda::Container *denominator = neda::makeString("2");
+                denominator->add(new neda::Fraction(neda::makeString("1"), inner));
+
+                top->add(new neda::LeftBracket());
+                top->add(new neda::Fraction(neda::makeString("123"), denominator));
+                top->add(new neda::RightBracket());
+                top->add(new neda::Superscript(neda::makeString("2")));
+                top->add(new neda::Character('+'));
+            }
+            top->layout();
+            neda::Cursor cursor;
+
+            top->getCursor(cursor, neda::CURSORLOCATION_END);
+            uint32_t start = cycles();
+            for (uint8_t i = 0; i < KEYS; i++) {
+                cursor.add(new neda::Character('1'));
+                top->layout();
+            }
+            const uint32_t topCycles = cycles() - start;
+
+            inner->getCursor(cursor, neda::CURSORLOCATION_END);
+            start = cycles();
+            for (uint8_t i = 0; i < KEYS; i++) {
+                cursor.add(new neda::Character('1'));
+                top->layout();
+            }
+            const uint32_t nestedCycles = cycles() - start;
+
+            start = cycles();
+            for (uint8_t i = 0; i < KEYS; i++) {
+                cursor.add(new neda::Character('1'));
+            }
+            top->layout();
+            const uint32_t burstCycles = cycles() - start;
+
+            printf("%-5d %-9lu %-9lu %lu\n", terms, topCycles / KEYS, nestedCycles / KEYS, burstCycles / KEYS);
+            delete top;
+        }
+    }
+
+    struct Benchmark {
+        const char *name;
+        void (*func)();
+    };
+    const Benchmark BENCHMARKS[] = {
+        { "lu", &lu },
+        { "matmul", &matmul },
+        { "sort", &sort },
+        { "factor", &factor },
+        { "combinatorics", &combinatorics },
+        { "random", &prng },
+        { "layout", &keystroke },
+    };
+    constexpr uint8_t BENCHMARK_COUNT = sizeof(BENCHMARKS) / sizeof(Benchmark);
+
+    bool run(const char *name) {
+        for (uint8_t i = 0; i < BENCHMARK_COUNT; i++) {
+            if (strcmp(name, BENCHMARKS[i].name) == 0) {
+                initCycleCounter();
+                BENCHMARKS[i].func();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void list() {
+        for (uint8_t i = 0; i < BENCHMARK_COUNT; i++) {
+            printf("%s\n", BENCHMARKS[i].name);
+        }
+    }
+} // namespace bench
@@ -1,6 +1,7 @@
 #include <string.h>
 #include <malloc.h>
 #include <stdio.h>
+#include "bench.hpp"
 #include "console.hpp"
 #ifndef USART_RECEIVE_METHOD_INTERRUPT
     #define USART_RECEIVE_METHOD_INTERRUPT
@@ -78,6 +79,16 @@ namespace console {
                     printf("Usage: blink [on|off]\n");
                 }
             }
+        }
+        else if(strcmp(cmd, "bench") == 0) {
+            cmd = strtok(NULL, " ");
+            if(!cmd) {
+                printf("Usage: bench [name]\nAvailable benchmarks:\n");
+                bench::list();
+            }
+            else if(!bench::run(cmd)) {
+                printf("Unknown benchmark: %s\n", cmd);
+            }
         }
 		else if (strcmp(cmd, "crash") == 0) {
 			// crash the system
@@ -1,9 +1,17 @@
 #include "eval.hpp"
+#include "fft.hpp"
 #include "lcd12864_charset.hpp"
 #include "ntoa.hpp"
+#include "numtheory.hpp"
+#include "ode.hpp"
+#include "optim.hpp"
+#include "rng.hpp"
+#include "sort.hpp"
 #include "unitconv.hpp"
 #include "usart.hpp"
+#include <float.h>
 #include <math.h>
+#include <new>
 #include <stdlib.h>
 #include <string.h>
 
@@ -16,6 +24,10 @@ namespace eval {
 
     bool useRadians = true;
     bool autoFractions = true;
+    // When set, matrices are treated as arrays of independent values, and operators and scalar functions are applied
+    // to each entry separately
+    // Used by linReg to evaluate each model term only once for all the data points
+    bool elementwise = false;
 
     constexpr double CONST_PI = 3.14159265358979323846;
     constexpr double CONST_E = 2.71828182845904523536;
@@ -25,41 +37,164 @@ namespace eval {
     constexpr double CONST_AGRAV = 9.80665;
 
     /******************** Numerical ********************/
+    constexpr const char *const CONST_NAMES[] = {
+            LCD_STR_PI, LCD_STR_EULR, LCD_STR_AVGO, LCD_STR_ECHG, LCD_STR_VLIG, LCD_STR_AGV,
+    };
+    // Must be in the same order as CONST_NAMES
+    const double CONST_VALUES[] = {
+            CONST_PI, CONST_E, CONST_AVOGADRO, CONST_ELEMCHG, CONST_VLIGHT, CONST_AGRAV,
+    };
+    constexpr lookup::PerfectHash<sizeof(CONST_NAMES) / sizeof(const char *), 16> CONST_TABLE(CONST_NAMES);
+    static_assert(CONST_TABLE.isValid(), "No perfect hash found for the constant names");
+
     Numerical *Numerical::constFromString(const char *str) {
-        if (strcmp(str, LCD_STR_PI) == 0) {
-            return new Numerical(CONST_PI);
-        }
-        else if (strcmp(str, LCD_STR_EULR) == 0) {
-            return new Numerical(CONST_E);
+        const int16_t index = CONST_TABLE.find(str);
+        return index >= 0 ? new Numerical(CONST_VALUES[index]) : nullptr;
+    }
+
+    /******************** Matrix ********************/
+    Matrix::Matrix(uint16_t m, uint16_t n, Storage storage, Structure structure)
+            : m(m), n(n), storage(storage), structure(structure), ownership(Ownership::STATIC), buffer(nullptr) {
+        reallocate(storage);
+    }
+    Matrix::Matrix(const Matrix &mat)
+            : m(mat.m), n(mat.n), storage(mat.storage), structure(mat.structure), ownership(mat.ownership),
+              data(mat.data), buffer(mat.buffer), rowStride(mat.rowStride), colStride(mat.colStride) {
+        if (ownership == Ownership::SHARED) {
+            buffer->refs++;
+        }
+        // Entries inside the token are small enough to just copy
+        else if (ownership == Ownership::INLINE) {
+            memcpy(inlineEntries, mat.inlineEntries, sizeof(inlineEntries));
+            data = reinterpret_cast<uint8_t *>(inlineEntries) +
+                   (static_cast<const uint8_t *>(mat.data) - reinterpret_cast<const uint8_t *>(mat.inlineEntries));
         }
-        else if (strcmp(str, LCD_STR_AVGO) == 0) {
-            return new Numerical(CONST_AVOGADRO);
+    }
+    Matrix::Matrix(Matrix &&mat)
+            : m(mat.m), n(mat.n), storage(mat.storage), structure(mat.structure), ownership(mat.ownership),
+              data(mat.data), buffer(mat.buffer), rowStride(mat.rowStride), colStride(mat.colStride) {
+        // Entries inside the token have to move with it
+        if (ownership == Ownership::INLINE) {
+            memcpy(inlineEntries, mat.inlineEntries, sizeof(inlineEntries));
+            data = reinterpret_cast<uint8_t *>(inlineEntries) +
+                   (static_cast<uint8_t *>(mat.data) - reinterpret_cast<uint8_t *>(mat.inlineEntries));
+        }
+        mat.ownership = Ownership::STATIC;
+        mat.data = mat.buffer = nullptr;
+        mat.m = mat.n = 0;
+    }
+    Matrix::Matrix(const Matrix &parent, uint16_t m, uint16_t n, void *data, uint32_t rowStride, uint32_t colStride)
+            : m(m), n(n), storage(parent.storage), structure(Structure::UNKNOWN), ownership(parent.ownership),
+              data(data), buffer(parent.buffer), rowStride(rowStride), colStride(colStride) {
+        if (ownership == Ownership::SHARED) {
+            buffer->refs++;
         }
-        else if (strcmp(str, LCD_STR_ECHG) == 0) {
-            return new Numerical(CONST_ELEMCHG);
+        // Entries inside the parent token go away with it, so they have to be copied
+        else if (ownership == Ownership::INLINE) {
+            convert(storage);
         }
-        else if (strcmp(str, LCD_STR_VLIG) == 0) {
-            return new Numerical(CONST_VLIGHT);
+    }
+    Matrix *Matrix::fromStatic(uint16_t m, uint16_t n, const double *entries) {
+        Matrix *mat = new Matrix(m, n, Storage::DOUBLE);
+        mat->release();
+        mat->ownership = Ownership::STATIC;
+        mat->data = const_cast<double *>(entries);
+        return mat;
+    }
+    void *Matrix::allocate(Storage s, uint32_t count, MatrixBuffer *&newBuffer) {
+        const uint32_t entrySize = s == Storage::DOUBLE ? sizeof(double) : sizeof(util::Numerical);
+        if (count * entrySize <= sizeof(inlineEntries)) {
+            newBuffer = nullptr;
+            return inlineEntries;
+        }
+        newBuffer = static_cast<MatrixBuffer *>(::operator new(sizeof(MatrixBuffer) + count * entrySize));
+        newBuffer->refs = 1;
+        newBuffer->count = count;
+        return newBuffer->entries();
+    }
+    void Matrix::release() {
+        if (ownership == Ownership::SHARED && --buffer->refs == 0) {
+            ::operator delete(buffer);
         }
-        else if (strcmp(str, LCD_STR_AGV) == 0) {
-            return new Numerical(CONST_AGRAV);
+        buffer = nullptr;
+    }
+    void Matrix::reallocate(Storage s) {
+        release();
+        MatrixBuffer *newBuffer;
+        data = allocate(s, size(), newBuffer);
+        buffer = newBuffer;
+        ownership = newBuffer ? Ownership::SHARED : Ownership::INLINE;
+        storage = s;
+        rowStride = n;
+        colStride = 1;
+        if (s == Storage::DOUBLE) {
+            memset(data, 0, sizeof(double) * size());
         }
         else {
-            return nullptr;
+            const util::Numerical zero = s == Storage::FRACTION ? util::Numerical(0, 1) : util::Numerical(0.0);
+            for (uint32_t i = 0; i < size(); i++) {
+                static_cast<util::Numerical *>(data)[i] = zero;
+            }
+        }
+    }
+    void Matrix::convert(Storage s) {
+        MatrixBuffer *newBuffer;
+        void *newData = allocate(s, size(), newBuffer);
+        // If both the old and the new entries are inside the token, the new ones have to be put somewhere else first
+        double temp[INLINE_CAPACITY];
+        void *entries = newBuffer ? newData : temp;
+        for (uint16_t i = 0; i < m; i++) {
+            for (uint16_t j = 0; j < n; j++) {
+                if (s == Storage::DOUBLE) {
+                    static_cast<double *>(entries)[i * n + j] = getEntry(i, j).asDouble();
+                }
+                else {
+                    static_cast<util::Numerical *>(entries)[i * n + j] = getEntry(i, j);
+                }
+            }
+        }
+        release();
+        if (!newBuffer) {
+            memcpy(inlineEntries, temp, sizeof(inlineEntries));
+        }
+        data = newData;
+        buffer = newBuffer;
+        ownership = newBuffer ? Ownership::SHARED : Ownership::INLINE;
+        storage = s;
+        rowStride = n;
+        colStride = 1;
+    }
+    void Matrix::compact() {
+        if (storage == Storage::DOUBLE) {
+            return;
+        }
+        bool numbers = true;
+        bool fractions = true;
+        for (uint32_t i = 0; i < size() && (numbers || fractions); i++) {
+            const bool number = (*this)[i].isNumber();
+            numbers &= number;
+            fractions &= !number;
+        }
+        if (numbers) {
+            convert(Storage::DOUBLE);
+        }
+        else if (fractions) {
+            storage = Storage::FRACTION;
+        }
+    }
+    void Matrix::trim() {
+        if (ownership == Ownership::SHARED && buffer->refs == 1 && 2 * size() < buffer->count) {
+            convert(storage);
         }
     }
-
-    /******************** Matrix ********************/
     Matrix *Matrix::add(const Matrix &a, const Matrix &b) {
         // Make sure two matrices are the same size
         if (a.m != b.m || a.n != b.n) {
             return nullptr;
         }
 
-        Matrix *result = new Matrix(a.m, a.n);
-        for (uint16_t i = 0; i < a.m * a.n; i++) {
-            (*result)[i] = a[i] + b[i];
-        }
+        Matrix *result = new Matrix(a);
+        result->addInPlace(b);
         return result;
     }
     Matrix *Matrix::subtract(const Matrix &a, const Matrix &b) {
@@ -68,10 +203,8 @@ namespace eval {
             return nullptr;
         }
 
-        Matrix *result = new Matrix(a.m, a.n);
-        for (uint16_t i = 0; i < a.m * a.n; i++) {
-            (*result)[i] = a[i] - b[i];
-        }
+        Matrix *result = new Matrix(a);
+        result->addInPlace(b, -1);
         return result;
     }
     Matrix *Matrix::multiply(const Matrix &a, const Matrix &b) {
@@ -81,29 +214,203 @@ namespace eval {
         }
 
         Matrix *result = new Matrix(a.m, b.n);
-        for (uint8_t row = 0; row < a.m; row++) {
-            for (uint8_t col = 0; col < b.n; col++) {
+        multiply(*result, a, b);
+        return result;
+    }
+    bool Matrix::multiply(Matrix &result, const Matrix &a, const Matrix &b, util::Numerical alpha,
+            util::Numerical beta, bool transA, bool transB) {
+        // Dimensions of op(a) and op(b)
+        const uint16_t rows = transA ? a.n : a.m;
+        const uint16_t inner = transA ? a.m : a.n;
+        const uint16_t cols = transB ? b.m : b.n;
+        if ((transB ? b.n : b.m) != inner || result.m != rows || result.n != cols) {
+            return false;
+        }
+
+        const bool scaled = alpha != 1;
+        const bool accumulate = beta != 0;
+        // Structures of op(a) and op(b)
+        const Structure structA = transA ? transposed(a.getStructure()) : a.getStructure();
+        const Structure structB = transB ? transposed(b.getStructure()) : b.getStructure();
+        // The structure of the product, if it can be told without looking at it
+        const Structure structResult =
+                accumulate || scaled ? Structure::UNKNOWN : productStructure(structA, structB);
+        if (multiplyStructured(result, a, b, alpha, beta, transA, transB)) {
+            result.structure = structResult;
+            return true;
+        }
+
+        // Use the floating-point kernel if the result is going to be floating-point anyways
+        if (alpha.isNumber() && beta.isNumber() && ((a.isFloatingPoint() && b.hasOnlyNumbers()) ||
+                (b.isFloatingPoint() && a.hasOnlyNumbers()))) {
+            if (!accumulate && (result.storage != Storage::DOUBLE || !result.isWritable())) {
+                // Make sure every entry is a number, since the kernel only writes the doubles
+                result.reallocate(Storage::DOUBLE);
+            }
+            if (!accumulate || result.hasOnlyNumbers()) {
+                result.makeWritable();
+                matkern::View aView = transA ? a.view().transpose() : a.view();
+                matkern::View bView = transB ? b.view().transpose() : b.view();
+                matkern::gemm(rows, cols, inner, alpha.asDouble(), aView, bView, beta.asDouble(), result.view());
+                result.structure = structResult;
+                return true;
+            }
+        }
+        for (uint16_t row = 0; row < rows; row++) {
+            for (uint16_t col = 0; col < cols; col++) {
+                // Skip the parts of the dot product where either side is known to be 0
+                uint16_t start = 0;
+                uint16_t end = inner;
+                if (structA == Structure::UPPER_TRIANGULAR) {
+                    start = row;
+                }
+                else if (structA == Structure::LOWER_TRIANGULAR) {
+                    end = row + 1;
+                }
+                if (structB == Structure::UPPER_TRIANGULAR) {
+                    end = util::min(end, static_cast<uint16_t>(col + 1));
+                }
+                else if (structB == Structure::LOWER_TRIANGULAR) {
+                    start = util::max(start, col);
+                }
                 // Take the dot product
                 util::Numerical sum = 0;
-                for (uint8_t i = 0; i < a.n; i++) {
-                    sum += a.getEntry(row, i) * b.getEntry(i, col);
+                for (uint16_t i = start; i < end; i++) {
+                    sum += (transA ? a.getEntry(i, row) : a.getEntry(row, i)) *
+                           (transB ? b.getEntry(col, i) : b.getEntry(i, col));
                 }
-                result->setEntry(row, col, sum);
+                if (scaled) {
+                    sum *= alpha;
+                }
+                if (accumulate) {
+                    sum += beta * result.getEntry(row, col);
+                }
+                result.setEntry(row, col, sum);
             }
         }
-        return result;
+        result.structure = structResult;
+        return true;
     }
-    Matrix *Matrix::multiply(const Matrix &a, util::Numerical scalar) {
-        Matrix *result = new Matrix(a.m, a.n);
-        for (uint16_t i = 0; i < a.m * a.n; i++) {
-            (*result)[i] = a[i] * scalar;
+    Matrix::Structure Matrix::productStructure(Structure a, Structure b) {
+        if (a == Structure::ZERO || b == Structure::ZERO) {
+            return Structure::ZERO;
+        }
+        if (a == Structure::IDENTITY) {
+            return b;
+        }
+        if (b == Structure::IDENTITY) {
+            return a;
+        }
+        if (a == Structure::PERMUTATION && b == Structure::PERMUTATION) {
+            return Structure::PERMUTATION;
+        }
+        // Diagonal matrices are both upper and lower triangular
+        const bool upper = (a == Structure::DIAGONAL || a == Structure::UPPER_TRIANGULAR) &&
+                           (b == Structure::DIAGONAL || b == Structure::UPPER_TRIANGULAR);
+        const bool lower = (a == Structure::DIAGONAL || a == Structure::LOWER_TRIANGULAR) &&
+                           (b == Structure::DIAGONAL || b == Structure::LOWER_TRIANGULAR);
+        if (upper && lower) {
+            return Structure::DIAGONAL;
+        }
+        if (upper) {
+            return Structure::UPPER_TRIANGULAR;
+        }
+        if (lower) {
+            return Structure::LOWER_TRIANGULAR;
+        }
+        return Structure::UNKNOWN;
+    }
+    bool Matrix::multiplyStructured(Matrix &result, const Matrix &a, const Matrix &b, util::Numerical alpha,
+            util::Numerical beta, bool transA, bool transB) {
+        const Structure structA = a.getStructure();
+        const Structure structB = b.getStructure();
+        const bool scaled = alpha != 1;
+        const bool accumulate = beta != 0;
+        // Stores alpha * value + beta * result into the result
+        auto store = [&](uint16_t row, uint16_t col, util::Numerical value) {
+            if (scaled) {
+                value *= alpha;
+            }
+            if (accumulate) {
+                value += beta * result.getEntry(row, col);
+            }
+            result.setEntry(row, col, value);
+        };
+        // Entries of op(a) and op(b)
+        auto entryA = [&](uint16_t row, uint16_t col) {
+            return transA ? a.getEntry(col, row) : a.getEntry(row, col);
+        };
+        auto entryB = [&](uint16_t row, uint16_t col) {
+            return transB ? b.getEntry(col, row) : b.getEntry(row, col);
+        };
+
+        if (structA == Structure::ZERO || structB == Structure::ZERO) {
+            for (uint16_t row = 0; row < result.m; row++) {
+                for (uint16_t col = 0; col < result.n; col++) {
+                    store(row, col, util::Numerical(0, 1));
+                }
+            }
+        }
+        // Diagonal matrices scale the rows or columns of the other matrix
+        else if (structA == Structure::IDENTITY || structA == Structure::DIAGONAL) {
+            for (uint16_t row = 0; row < result.m; row++) {
+                for (uint16_t col = 0; col < result.n; col++) {
+                    store(row, col,
+                            structA == Structure::IDENTITY ? entryB(row, col) : a.getEntry(row, row) * entryB(row, col));
+                }
+            }
+        }
+        else if (structB == Structure::IDENTITY || structB == Structure::DIAGONAL) {
+            for (uint16_t row = 0; row < result.m; row++) {
+                for (uint16_t col = 0; col < result.n; col++) {
+                    store(row, col,
+                            structB == Structure::IDENTITY ? entryA(row, col) : entryA(row, col) * b.getEntry(col, col));
+                }
+            }
+        }
+        // Permutation matrices shuffle the rows or columns of the other matrix
+        else if (structA == Structure::PERMUTATION) {
+            for (uint16_t i = 0; i < result.m; i++) {
+                // Row i of PB is row p(i) of B, and row p(i) of P^TB is row i of B
+                const uint16_t p = a.permutationCol(i);
+                for (uint16_t col = 0; col < result.n; col++) {
+                    if (transA) {
+                        store(p, col, entryB(i, col));
+                    }
+                    else {
+                        store(i, col, entryB(p, col));
+                    }
+                }
+            }
+        }
+        else if (structB == Structure::PERMUTATION) {
+            for (uint16_t i = 0; i < result.n; i++) {
+                // Column p(i) of AP is column i of A, and column i of AP^T is column p(i) of A
+                const uint16_t p = b.permutationCol(i);
+                for (uint16_t row = 0; row < result.m; row++) {
+                    if (transB) {
+                        store(row, i, entryA(row, p));
+                    }
+                    else {
+                        store(row, p, entryA(row, i));
+                    }
+                }
+            }
+        }
+        else {
+            return false;
         }
+        return true;
+    }
+    Matrix *Matrix::multiply(const Matrix &a, util::Numerical scalar) {
+        Matrix *result = new Matrix(a);
+        result->multiplyInPlace(scalar);
         return result;
     }
     util::Numerical Matrix::dot(const Matrix &a, const Matrix &b) {
         if (a.n == 1 && b.n == 1 && a.m == b.m) {
             util::Numerical sum = 0;
-            for (uint8_t i = 0; i < a.m; i++) {
+            for (uint16_t i = 0; i < a.m; i++) {
                 sum += a[i] * b[i];
             }
             return sum;
@@ -117,8 +424,8 @@ namespace eval {
             return false;
         }
         bool equal = true;
-        for (uint16_t i = 0; i < a.m * a.n; i++) {
-            if (a[i].feq(b[i])) {
+        for (uint32_t i = 0; i < a.size(); i++) {
+            if (!a[i].feq(b[i])) {
                 equal = false;
                 break;
             }
@@ -126,91 +433,169 @@ namespace eval {
         return equal;
     }
     Matrix *Matrix::leastSquares(const Matrix &a, const Matrix &b) {
+        if (a.m != b.m) {
+            return nullptr;
+        }
+        // The normal equations square the condition number of A, which only doesn't matter in exact arithmetic
+        if (a.isFloatingPoint() || b.isFloatingPoint()) {
+            return leastSquaresQR(a, b);
+        }
+        // Form the normal equations without materializing A^T
         // Matrix
-        Matrix *aTranspose = a.transpose();
-        // Matrix
-        Matrix *aTransposeA = Matrix::multiply(*aTranspose, a);
+        Matrix aTransposeA(a.n, a.n);
+        multiply(aTransposeA, a, a, 1, 0, true, false);
         // Vector
-        Matrix *aTransposeB = Matrix::multiply(*aTranspose, b);
-
-        delete aTranspose;
-        // Matrix
-        Matrix augmented(aTransposeA->m, aTransposeA->n + 1);
-        for (uint8_t i = 0; i < aTransposeA->m; i++) {
-            for (uint8_t j = 0; j < aTransposeA->n; j++) {
-                augmented.setEntry(i, j, aTransposeA->getEntry(i, j));
+        Matrix aTransposeB(a.n, b.n);
+        multiply(aTransposeB, a, b, 1, 0, true, false);
+
+        // Solve the normal equations
+        if (aTransposeA.isExact() && aTransposeB.isExact() && a.n + b.n <= 0xFFFF) {
+            Matrix augmented(a.n, a.n + b.n, Storage::NUMERICAL);
+            for (uint16_t i = 0; i < a.n; i++) {
+                for (uint16_t j = 0; j < a.n; j++) {
+                    augmented.setEntry(i, j, aTransposeA.getEntry(i, j));
+                }
+                for (uint16_t j = 0; j < b.n; j++) {
+                    augmented.setEntry(i, a.n + j, aTransposeB.getEntry(i, j));
+                }
             }
+            Matrix *x;
+            if (solveExact(augmented, x)) {
+                return x;
+            }
+            // Too big for exact arithmetic
+            return leastSquaresQR(a, b);
         }
-        for (uint8_t i = 0; i < aTransposeA->m; i++) {
-            augmented.setEntry(i, aTransposeA->n, (*aTransposeB)[i]);
-        }
-        delete aTransposeA;
-        delete aTransposeB;
-
-        if (!augmented.eliminate(false)) {
+        // A^TA is not needed after this, so the factorization can take over its entries
+        LUDecomposition lu(static_cast<Matrix &&>(aTransposeA));
+        return lu.solve(aTransposeB);
+    }
+    Matrix *Matrix::leastSquaresQR(const Matrix &a, const Matrix &b, double *rss) {
+        const uint16_t m = a.m;
+        const uint16_t n = a.n;
+        if (b.m != m || m < n) {
             return nullptr;
         }
-        // Construct solution as vector
-        Matrix *solution = new Matrix(augmented.m, 1);
-        for (uint8_t i = 0; i < augmented.m; i++) {
-            (*solution)[i] = augmented.getEntry(i, augmented.m);
+        // Work on floating-point copies of A and b, so the kernels can be used
+        // A gets overwritten by R, and b by Q^T b
+        Matrix r(a);
+        Matrix qtb(b);
+        r.convert(Storage::DOUBLE);
+        qtb.convert(Storage::DOUBLE);
+        const matkern::View rView = r.view();
+        const matkern::View qtbView = qtb.view();
+
+        // Columns with a norm this small compared to the largest column are considered linearly dependent
+        double maxNorm = 0;
+        for (uint16_t j = 0; j < n; j++) {
+            maxNorm = util::max(maxNorm, sqrt(matkern::dot(m, &rView(0, j), rView.rowStride, &rView(0, j),
+                                                 rView.rowStride)));
+        }
+        const double tolerance = maxNorm * 1e-12;
+
+        for (uint16_t k = 0; k < n; k++) {
+            // Find the Householder reflection that zeroes out column k below the diagonal
+            double *v = &rView(k, k);
+            const uint16_t len = m - k;
+            double norm = sqrt(matkern::dot(len, v, rView.rowStride, v, rView.rowStride));
+            if (norm <= tolerance) {
+                return nullptr;
+            }
+            // Choose the sign that avoids cancellation
+            const double diagonal = v[0] > 0 ? -norm : norm;
+            // The reflection vector is the column with the diagonal subtracted from its first entry
+            // It is kept in place of the column until the reflection has been applied everywhere
+            v[0] -= diagonal;
+            const double vNormSquared = matkern::dot(len, v, rView.rowStride, v, rView.rowStride);
+
+            // Reflect the rest of the columns, and b
+            for (uint16_t j = k + 1; j < n; j++) {
+                double *col = &rView(k, j);
+                matkern::axpy(len, -2 * matkern::dot(len, v, rView.rowStride, col, rView.rowStride) / vNormSquared, v,
+                        rView.rowStride, col, rView.rowStride);
+            }
+            for (uint16_t j = 0; j < b.n; j++) {
+                double *col = &qtbView(k, j);
+                matkern::axpy(len, -2 * matkern::dot(len, v, rView.rowStride, col, qtbView.rowStride) / vNormSquared,
+                        v, rView.rowStride, col, qtbView.rowStride);
+            }
+            v[0] = diagonal;
+        }
+
+        // Back substitution with R
+        Matrix *x = new Matrix(n, b.n);
+        const matkern::View xView = x->view();
+        for (uint16_t col = 0; col < b.n; col++) {
+            for (uint16_t i = n; i-- > 0;) {
+                xView(i, col) = (qtbView(i, col) - matkern::dot(n - i - 1, &rView(i, i + 1), rView.colStride,
+                                                           &xView(i + 1, col), xView.rowStride)) /
+                                rView(i, i);
+            }
+            // Whatever Q^T b has left below the first n rows can't be fitted
+            if (rss) {
+                rss[col] = matkern::dot(m - n, &qtbView(n, col), qtbView.rowStride, &qtbView(n, col),
+                        qtbView.rowStride);
+            }
         }
-        return solution;
+        return x;
     }
-    util::Numerical Matrix::det() {
+    util::Numerical Matrix::det() const {
         // No determinant for nonsquare matrices
         if (m != n) {
             return NAN;
         }
-
-        // Apply gaussian elimination to make the matrix upper-triangular
-        // Keep track of the negating
-        bool neg = 0;
-        // Copied from eliminate() and modified
-        for (uint8_t i = 0; i < m; i++) {
-            if (getEntry(i, i) == 0) {
-                uint8_t k = i;
-                for (; k < m; k++) {
-                    if (getEntry(k, i) != 0) {
-                        rowSwap(i, k);
-                        // Swapping two rows negates the determinant
-                        neg = !neg;
-                        break;
-                    }
+        switch (getStructure()) {
+        case Structure::ZERO:
+            return util::Numerical(0, 1);
+        case Structure::IDENTITY:
+            return util::Numerical(1, 1);
+        // The determinant of a triangular matrix is the product of its main diagonal
+        case Structure::DIAGONAL:
+        case Structure::UPPER_TRIANGULAR:
+        case Structure::LOWER_TRIANGULAR: {
+            util::Numerical result(1, 1);
+            for (uint16_t i = 0; i < n; i++) {
+                result *= getEntry(i, i);
+            }
+            return result;
+        }
+        // The determinant of a permutation matrix is -1 if the permutation has an odd number of even-length cycles
+        case Structure::PERMUTATION: {
+            bool *visited = new bool[n]();
+            bool negate = false;
+            for (uint16_t i = 0; i < n; i++) {
+                uint16_t length = 0;
+                for (uint16_t j = i; !visited[j]; j = permutationCol(j)) {
+                    visited[j] = true;
+                    length++;
                 }
-
-                if (k == m) {
-                    // If the entire column is 0, the matrix is singular
-                    // Therefore the determinant must be 0
-                    return 0;
+                if (length && length % 2 == 0) {
+                    negate = !negate;
                 }
             }
-
-            util::Numerical pivot = getEntry(i, i);
-
-            // Eliminate this column in all rows below
-            // Adding to one row a scalar multiple of another does not change the determinant
-            for (uint8_t k = i + 1; k < m; k++) {
-                rowAdd(k, i, -(getEntry(k, i) / pivot));
-            }
+            delete[] visited;
+            return util::Numerical(negate ? -1 : 1, 1);
         }
-
-        // Now the matrix should be upper-triangular
-        // Take the product of the main diagonal to get the determinant
-        util::Numerical d = 1;
-        for (uint8_t i = 0; i < m; i++) {
-            d *= getEntry(i, i);
+        default:
+            break;
         }
-
-        return neg ? -d : d;
+        if (isExact()) {
+            util::Numerical result;
+            if (eliminateExact(*this, nullptr, n, &result)) {
+                return result;
+            }
+            // Too big for exact arithmetic
+            return LUDecomposition(*this, true).det();
+        }
+        return LUDecomposition::of(*this).det();
     }
     util::Numerical Matrix::len() const {
         if (n != 1) {
             return NAN;
         }
         util::Numerical sum = 0;
-        for (uint8_t i = 0; i < m; i++) {
-            sum += contents[i] * contents[i];
+        for (uint16_t i = 0; i < m; i++) {
+            sum += getEntry(i, 0) * getEntry(i, 0);
         }
         sum.sqrt();
         return sum;
@@ -222,52 +607,268 @@ namespace eval {
         }
 
         Matrix *result = new Matrix(3, 1);
-        (*result)[0] = a[1] * b[2] - a[2] * b[1];
-        (*result)[1] = a[2] * b[0] - a[0] * b[2];
-        (*result)[2] = a[0] * b[1] - a[1] * b[0];
+        result->set(0, a[1] * b[2] - a[2] * b[1]);
+        result->set(1, a[2] * b[0] - a[0] * b[2]);
+        result->set(2, a[0] * b[1] - a[1] * b[0]);
         return result;
     }
     Matrix *Matrix::transpose() const {
-        Matrix *result = new Matrix(n, m);
+        // The result shares the entries and only swaps the strides
+        Matrix *result = new Matrix(*this);
+        result->transposeInPlace();
+        return result;
+    }
+    Matrix::Structure Matrix::transposed(Structure s) {
+        if (s == Structure::UPPER_TRIANGULAR) {
+            return Structure::LOWER_TRIANGULAR;
+        }
+        if (s == Structure::LOWER_TRIANGULAR) {
+            return Structure::UPPER_TRIANGULAR;
+        }
+        return s;
+    }
+    uint16_t Matrix::permutationCol(uint16_t row) const {
+        uint16_t col = 0;
+        while (getEntry(row, col) == 0) {
+            col++;
+        }
+        return col;
+    }
+    Matrix::Structure Matrix::getStructure() const {
+        if (structure != Structure::UNKNOWN) {
+            return structure;
+        }
+        // Go through the entries once, ruling out structures until none are left
+        bool zero = true;
+        bool upper = m == n;
+        bool lower = m == n;
+        // All entries are either 0 or 1
+        bool binary = m == n;
+        for (uint16_t i = 0; i < m; i++) {
+            for (uint16_t j = 0; j < n; j++) {
+                const util::Numerical &entry = getEntry(i, j);
+                if (entry == 0) {
+                    continue;
+                }
+                zero = false;
+                if (i > j) {
+                    upper = false;
+                }
+                else if (i < j) {
+                    lower = false;
+                }
+                if (entry != 1) {
+                    binary = false;
+                }
+                if (!upper && !lower && !binary) {
+                    return structure = Structure::GENERAL;
+                }
+            }
+        }
 
-        for (uint8_t i = 0; i < m; i++) {
-            for (uint8_t j = 0; j < n; j++) {
-                result->setEntry(j, i, getEntry(i, j));
+        if (zero) {
+            structure = Structure::ZERO;
+        }
+        else if (upper && lower) {
+            structure = binary ? Structure::IDENTITY : Structure::DIAGONAL;
+            // An identity matrix can't have any zeros on the diagonal
+            for (uint16_t i = 0; i < n && structure == Structure::IDENTITY; i++) {
+                if (getEntry(i, i) == 0) {
+                    structure = Structure::DIAGONAL;
+                }
             }
         }
-        return result;
+        else if (upper) {
+            structure = Structure::UPPER_TRIANGULAR;
+        }
+        else if (lower) {
+            structure = Structure::LOWER_TRIANGULAR;
+        }
+        else {
+            // Every row and column must have exactly one 1
+            structure = Structure::PERMUTATION;
+            uint16_t *colCounts = new uint16_t[n]();
+            for (uint16_t i = 0; i < m && structure == Structure::PERMUTATION; i++) {
+                uint16_t rowCount = 0;
+                for (uint16_t j = 0; j < n; j++) {
+                    if (getEntry(i, j) == 1) {
+                        rowCount++;
+                        colCounts[j]++;
+                    }
+                }
+                if (rowCount != 1) {
+                    structure = Structure::GENERAL;
+                }
+            }
+            for (uint16_t j = 0; j < n && structure == Structure::PERMUTATION; j++) {
+                if (colCounts[j] != 1) {
+                    structure = Structure::GENERAL;
+                }
+            }
+            delete[] colCounts;
+        }
+        return structure;
+    }
+    bool Matrix::hasOnlyNumbers() const {
+        if (storage != Storage::NUMERICAL) {
+            return storage == Storage::DOUBLE || size() == 0;
+        }
+        for (uint32_t i = 0; i < size(); i++) {
+            if (!(*this)[i].isNumber()) {
+                return false;
+            }
+        }
+        return true;
+    }
+    bool Matrix::isFloatingPoint() const {
+        if (storage == Storage::DOUBLE) {
+            for (uint32_t i = 0; i < size(); i++) {
+                if (!util::isInt((*this)[i].asDouble())) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        if (storage == Storage::FRACTION) {
+            return false;
+        }
+        bool nonInteger = false;
+        for (uint32_t i = 0; i < size(); i++) {
+            const util::Numerical entry = (*this)[i];
+            if (!entry.isNumber()) {
+                return false;
+            }
+            if (!nonInteger && !util::isInt(entry.asDouble())) {
+                nonInteger = true;
+            }
+        }
+        return nonInteger;
+    }
+    bool Matrix::addInPlace(const Matrix &other, util::Numerical scalar) {
+        if (m != other.m || n != other.n) {
+            return false;
+        }
+        // Only zero, diagonal and triangular matrices are closed under addition, so only sums of two of the same kind
+        // keep their structure
+        switch (structure == other.structure ? structure : Structure::UNKNOWN) {
+        case Structure::ZERO:
+        case Structure::DIAGONAL:
+        case Structure::UPPER_TRIANGULAR:
+        case Structure::LOWER_TRIANGULAR:
+            break;
+        case Structure::IDENTITY:
+            structure = Structure::DIAGONAL;
+            break;
+        default:
+            structure = Structure::UNKNOWN;
+            break;
+        }
+        const Structure s = structure;
+        // Floating-point sums stay floating-point, so the kernel can work on the packed doubles directly
+        if (storage == Storage::DOUBLE && other.storage == Storage::DOUBLE && scalar.isNumber() &&
+                (isFloatingPoint() || other.isFloatingPoint())) {
+            makeWritable();
+            const matkern::View a = view();
+            const matkern::View b = other.view();
+            for (uint16_t i = 0; i < m; i++) {
+                matkern::axpy(n, scalar.asDouble(), &b(i, 0), b.colStride, &a(i, 0), a.colStride);
+            }
+        }
+        else if (scalar == 1) {
+            for (uint32_t i = 0; i < size(); i++) {
+                set(i, (*this)[i] + other[i]);
+            }
+        }
+        else {
+            for (uint32_t i = 0; i < size(); i++) {
+                set(i, (*this)[i] + other[i] * scalar);
+            }
+        }
+        structure = s;
+        return true;
+    }
+    void Matrix::multiplyInPlace(util::Numerical scalar) {
+        const Structure s = structure;
+        if (storage == Storage::DOUBLE && scalar.isNumber() &&
+                (!util::isInt(scalar.asDouble()) || isFloatingPoint())) {
+            makeWritable();
+            const matkern::View v = view();
+            for (uint16_t i = 0; i < m; i++) {
+                matkern::scal(n, scalar.asDouble(), &v(i, 0), v.colStride);
+            }
+        }
+        else {
+            for (uint32_t i = 0; i < size(); i++) {
+                set(i, (*this)[i] * scalar);
+            }
+        }
+        structure = s;
+        if (scalar != 1) {
+            if (structure == Structure::IDENTITY) {
+                structure = Structure::DIAGONAL;
+            }
+            else if (structure == Structure::PERMUTATION) {
+                structure = Structure::UNKNOWN;
+            }
+        }
+    }
+    void Matrix::transposeInPlace() {
+        util::swap(m, n);
+        util::swap(rowStride, colStride);
+        structure = transposed(structure);
+    }
+    void Matrix::resolveTranspose() {
+        if (pendingTranspose) {
+            transposeInPlace();
+            pendingTranspose = false;
+        }
     }
     bool Matrix::eliminate(bool allowSingular) {
         // If there are more rows than columns, don't do anything
         if (n < m && !allowSingular) {
             return false;
         }
-
-        for (uint8_t i = 0, j = 0; i < m && j < n; j++) {
-            if (getEntry(i, j) == 0) {
-                uint8_t k = i;
-                for (; k < m; k++) {
-                    if (getEntry(k, j) != 0) {
-                        rowSwap(i, k);
-                        break;
-                    }
+        // The kernels write to the entries directly
+        structure = Structure::UNKNOWN;
+        if (allowSingular && isExact() && eliminateExact(*this, this, n)) {
+            return true;
+        }
+        // Floating-point matrices stay floating-point throughout, so the kernels can be used for the row operations
+        const bool floatingPoint = isFloatingPoint();
+        if (floatingPoint) {
+            convert(Storage::DOUBLE);
+        }
+
+        for (uint16_t i = 0, j = 0; i < m && j < n; j++) {
+            // Partial pivoting: use the entry with the largest magnitude in this column as the pivot
+            uint16_t pivotRow = i;
+            double pivotMag = util::abs(getEntry(i, j).asDouble());
+            for (uint16_t k = i + 1; k < m; k++) {
+                double mag = util::abs(getEntry(k, j).asDouble());
+                if (mag > pivotMag) {
+                    pivotRow = k;
+                    pivotMag = mag;
                 }
+            }
 
-                if (k == m) {
-                    if (!allowSingular) {
-                        return false;
-                    }
-                    continue;
+            if (pivotMag == 0) {
+                if (!allowSingular) {
+                    return false;
                 }
+                continue;
+            }
+            if (pivotRow != i) {
+                rowSwap(i, pivotRow);
             }
 
-            rowMult(i, 1 / getEntry(i, j));
-            for (uint8_t k = 0; k < m; k++) {
-                if (i == k) {
+            // Everything to the left of this column is already 0
+            rowMult(i, 1 / getEntry(i, j), floatingPoint, j);
+            for (uint16_t k = 0; k < m; k++) {
+                if (i == k || getEntry(k, j) == 0) {
                     continue;
                 }
 
-                rowAdd(k, i, -getEntry(k, j));
+                rowAdd(k, i, -getEntry(k, j), floatingPoint, j);
             }
 
             i++;
@@ -275,62 +876,577 @@ namespace eval {
 
         return true;
     }
-    Matrix *Matrix::inv() const {
-        // Nonsquare matrices have no inverses
-        if (m != n) {
-            return nullptr;
-        }
-        // Create block matrix [A|I], where I is the identity matrix
-        Matrix block(m, n + m);
-        // Copy the original matrix
-        for (uint8_t i = 0; i < m; i++) {
-            for (uint8_t j = 0; j < n; j++) {
-                block.setEntry(i, j, getEntry(i, j));
-            }
-        }
-        // Copy the identity matrix
-        for (uint8_t i = 0; i < m; i++) {
-            block.setEntry(i, i + m, 1);
-        }
-        // Eliminate
-        if (!block.eliminate(false)) {
-            return nullptr;
+    bool Matrix::isExact() const {
+        if (storage == Storage::FRACTION) {
+            return true;
         }
-        // Copy inverse
-        Matrix *result = new Matrix(m, n);
-        for (uint8_t i = 0; i < m; i++) {
-            for (uint8_t j = 0; j < n; j++) {
-                result->setEntry(i, j, block.getEntry(i, j + m));
+        for (uint32_t i = 0; i < size(); i++) {
+            const util::Numerical entry = (*this)[i];
+            if (entry.isNumber() && !util::isInt(entry.asDouble())) {
+                return false;
             }
         }
-        return result;
+        return true;
     }
-    Matrix *Matrix::getRowVector(uint8_t row) const {
-        if (row >= m) {
-            return nullptr;
+    bool Matrix::eliminateExact(const Matrix &src, Matrix *rref, uint16_t pivotCols, util::Numerical *det) {
+        const uint16_t m = src.m;
+        const uint16_t n = src.n;
+        int64_t *work = new int64_t[src.size()];
+        // The determinant has to be divided by all the factors the rows were scaled by
+        util::Numerical scale(1, 1);
+
+        // Scale every row to a common denominator
+        bool overflow = false;
+        for (uint16_t i = 0; i < m && !overflow; i++) {
+            int64_t denom = 1;
+            for (uint16_t j = 0; j < n; j++) {
+                const util::Numerical &entry = src.getEntry(i, j);
+                if (!entry.isNumber()) {
+                    const int64_t d = entry.asFraction().denom;
+                    overflow |= __builtin_mul_overflow(denom / util::gcd(denom, d), d, &denom);
+                }
+            }
+            for (uint16_t j = 0; j < n; j++) {
+                const util::Numerical &entry = src.getEntry(i, j);
+                if (entry.isNumber()) {
+                    overflow |= __builtin_mul_overflow(static_cast<int64_t>(entry.asDouble()), denom, &work[i * n + j]);
+                }
+                else {
+                    const util::Fraction frac = entry.asFraction();
+                    overflow |= __builtin_mul_overflow(frac.num, denom / frac.denom, &work[i * n + j]);
+                }
+            }
+            if (det) {
+                scale *= util::Numerical(denom, 1);
+            }
         }
 
-        Matrix *mat = new Matrix(1, n);
-        for (uint8_t i = 0; i < n; i++) {
-            mat->contents[i] = getEntry(row, i);
-        }
-        return mat;
-    }
-    Matrix *Matrix::getColVector(uint8_t col) const {
-        if (col >= n) {
-            return nullptr;
-        }
+        // Since all pivots are exact, the first nonzero entry can be used as the pivot
+        int64_t prevPivot = 1;
+        bool negate = false;
+        uint16_t row = 0;
+        for (uint16_t col = 0; col < pivotCols && row < m && !overflow; col++) {
+            uint16_t pivotRow = row;
+            while (pivotRow < m && work[pivotRow * n + col] == 0) {
+                pivotRow++;
+            }
+            if (pivotRow == m) {
+                continue;
+            }
+            if (pivotRow != row) {
+                for (uint16_t j = 0; j < n; j++) {
+                    util::swap(work[row * n + j], work[pivotRow * n + j]);
+                }
+                negate = !negate;
+            }
 
-        Matrix *mat = new Matrix(m, 1);
-        for (uint8_t i = 0; i < m; i++) {
-            mat->contents[i] = getEntry(i, col);
+            const int64_t pivot = work[row * n + col];
+            // For the determinant only the rows below need to be eliminated
+            for (uint16_t i = rref ? 0 : row + 1; i < m && !overflow; i++) {
+                if (i == row) {
+                    continue;
+                }
+                // Rows above still have their own pivots to the left that need to be scaled
+                // Rows below are all 0 to the left
+                const int64_t factor = work[i * n + col];
+                for (uint16_t j = i < row ? 0 : col + 1; j < n; j++) {
+                    if (j == col) {
+                        continue;
+                    }
+                    int64_t a, b;
+                    overflow |= __builtin_mul_overflow(pivot, work[i * n + j], &a);
+                    overflow |= __builtin_mul_overflow(factor, work[row * n + j], &b);
+                    overflow |= __builtin_sub_overflow(a, b, &a);
+                    work[i * n + j] = a / prevPivot;
+                }
+                work[i * n + col] = 0;
+            }
+            prevPivot = pivot;
+            row++;
         }
-        return mat;
-    }
 
-    /******************** Operator ********************/
-    uint8_t Operator::getPrecedence() const {
-        switch (type) {
+        if (overflow) {
+            delete[] work;
+            return false;
+        }
+        if (det) {
+            // The last pivot is the determinant of the scaled matrix, unless it's singular
+            if (row < pivotCols) {
+                *det = util::Numerical(0, 1);
+            }
+            else {
+                *det = util::Numerical(negate ? -prevPivot : prevPivot, 1) / scale;
+            }
+        }
+        if (rref) {
+            // Everything has been read from src already, so the old entries can be thrown away even if it's the same
+            // matrix
+            rref->reallocate(Storage::FRACTION);
+            // Divide every row by its pivot, which is its first nonzero entry
+            for (uint16_t i = 0; i < m; i++) {
+                int64_t pivot = 0;
+                for (uint16_t j = 0; j < n; j++) {
+                    if (!pivot) {
+                        pivot = work[i * n + j];
+                    }
+                    rref->setEntry(i, j, pivot ? util::Numerical(work[i * n + j], pivot) : util::Numerical(0, 1));
+                }
+            }
+        }
+        delete[] work;
+        return true;
+    }
+    bool Matrix::solveExact(Matrix &augmented, Matrix *&x) {
+        const uint16_t size = augmented.m;
+        if (!eliminateExact(augmented, &augmented, size)) {
+            return false;
+        }
+        // The left part is the identity unless a is singular
+        if (augmented.getEntry(size - 1, size - 1) == 0) {
+            x = nullptr;
+            return true;
+        }
+        x = new Matrix(size, augmented.n - size, Storage::FRACTION);
+        for (uint16_t i = 0; i < size; i++) {
+            for (uint16_t j = 0; j < x->n; j++) {
+                x->setEntry(i, j, augmented.getEntry(i, j + size));
+            }
+        }
+        return true;
+    }
+    bool Matrix::solveStructured(const Matrix &a, const Matrix &b, Matrix *&x) {
+        const uint16_t size = a.m;
+        if (a.n != size || b.m != size) {
+            return false;
+        }
+        const Structure s = a.getStructure();
+        switch (s) {
+        case Structure::ZERO:
+            x = nullptr;
+            return true;
+        case Structure::IDENTITY:
+            x = new Matrix(b);
+            return true;
+        case Structure::DIAGONAL:
+        case Structure::UPPER_TRIANGULAR:
+        case Structure::LOWER_TRIANGULAR:
+            for (uint16_t i = 0; i < size; i++) {
+                if (a.getEntry(i, i) == 0) {
+                    x = nullptr;
+                    return true;
+                }
+            }
+            break;
+        case Structure::PERMUTATION:
+            break;
+        default:
+            return false;
+        }
+
+        x = new Matrix(size, b.n);
+        for (uint16_t col = 0; col < b.n; col++) {
+            if (s == Structure::PERMUTATION) {
+                // Px = b means x = P^Tb, so row p(i) of x is row i of b
+                for (uint16_t i = 0; i < size; i++) {
+                    x->setEntry(a.permutationCol(i), col, b.getEntry(i, col));
+                }
+            }
+            else if (s == Structure::DIAGONAL) {
+                for (uint16_t i = 0; i < size; i++) {
+                    x->setEntry(i, col, b.getEntry(i, col) / a.getEntry(i, i));
+                }
+            }
+            // Forward substitution
+            else if (s == Structure::LOWER_TRIANGULAR) {
+                for (uint16_t i = 0; i < size; i++) {
+                    util::Numerical sum = b.getEntry(i, col);
+                    for (uint16_t j = 0; j < i; j++) {
+                        sum -= a.getEntry(i, j) * x->getEntry(j, col);
+                    }
+                    x->setEntry(i, col, sum / a.getEntry(i, i));
+                }
+            }
+            // Back substitution
+            else {
+                for (uint16_t i = size; i-- > 0;) {
+                    util::Numerical sum = b.getEntry(i, col);
+                    for (uint16_t j = i + 1; j < size; j++) {
+                        sum -= a.getEntry(i, j) * x->getEntry(j, col);
+                    }
+                    x->setEntry(i, col, sum / a.getEntry(i, i));
+                }
+            }
+        }
+        return true;
+    }
+    Matrix *Matrix::inv() const {
+        // Nonsquare matrices have no inverses
+        if (m != n) {
+            return nullptr;
+        }
+        // The inverse of a matrix with a special structure has the same structure
+        if (getStructure() != Structure::GENERAL) {
+            Matrix identity(m, m, Structure::IDENTITY);
+            for (uint16_t i = 0; i < m; i++) {
+                identity.writeAt(i * m + i, 1.0);
+            }
+            Matrix *x;
+            if (solveStructured(*this, identity, x)) {
+                if (x) {
+                    x->structure = structure;
+                }
+                return x;
+            }
+        }
+        // Exact matrices are inverted by eliminating [A|I]
+        if (isExact() && 2 * m <= 0xFFFF) {
+            Matrix augmented(m, 2 * m, Storage::NUMERICAL);
+            for (uint16_t i = 0; i < m; i++) {
+                for (uint16_t j = 0; j < m; j++) {
+                    augmented.setEntry(i, j, getEntry(i, j));
+                }
+                augmented.setEntry(i, i + m, 1);
+            }
+            Matrix *x;
+            if (solveExact(augmented, x)) {
+                return x;
+            }
+            // Too big for exact arithmetic
+            return LUDecomposition(*this, true).inv();
+        }
+        return LUDecomposition::of(*this).inv();
+    }
+    Matrix *Matrix::pow(int32_t e) const {
+        if (m != n) {
+            return nullptr;
+        }
+        if (e == 0) {
+            Matrix *identity = new Matrix(m, m, Structure::IDENTITY);
+            for (uint16_t i = 0; i < m; i++) {
+                identity->setEntry(i, i, 1);
+            }
+            return identity;
+        }
+        // Negative powers are powers of the inverse
+        Matrix *base = e < 0 ? inv() : new Matrix(*this);
+        if (!base) {
+            return nullptr;
+        }
+        uint32_t k = e < 0 ? 0u - static_cast<uint32_t>(e) : e;
+
+        // Square-and-multiply, with each product written into a scratch matrix and swapped in
+        // This way it only takes O(log e) multiplications and no allocations per step
+        Matrix *result = nullptr;
+        Matrix *temp = new Matrix(m, m);
+        while (true) {
+            if (k & 1) {
+                if (result) {
+                    multiply(*temp, *result, *base);
+                    util::swap(result, temp);
+                }
+                else {
+                    result = new Matrix(*base);
+                }
+            }
+            k >>= 1;
+            if (!k) {
+                break;
+            }
+            multiply(*temp, *base, *base);
+            util::swap(base, temp);
+        }
+        delete base;
+        delete temp;
+        return result;
+    }
+    Matrix *Matrix::exp() const {
+        if (m != n) {
+            return nullptr;
+        }
+        // Scale A by 2^-s so that its infinity norm is at most 1/2, where the Pade approximant is accurate
+        double norm = 0;
+        for (uint16_t i = 0; i < m; i++) {
+            double rowSum = 0;
+            for (uint16_t j = 0; j < n; j++) {
+                rowSum += util::abs(getEntry(i, j).asDouble());
+            }
+            norm = util::max(norm, rowSum);
+        }
+        int s;
+        frexp(norm, &s);
+        s = util::max(s + 1, 0);
+
+        // Everything is done on packed doubles with the kernels, in a fixed set of matrices
+        Matrix a(*this);
+        a.convert(Storage::DOUBLE);
+        if (s > 0) {
+            a.multiplyInPlace(ldexp(1, -s));
+        }
+        Matrix power(m, m, Storage::DOUBLE);
+        Matrix scratch(m, m, Storage::DOUBLE);
+        Matrix num(m, m, Storage::DOUBLE);
+        Matrix denom(m, m, Storage::DOUBLE);
+        for (uint16_t i = 0; i < m; i++) {
+            power.writeAt(i * m + i, 1.0);
+            num.writeAt(i * m + i, 1.0);
+            denom.writeAt(i * m + i, 1.0);
+        }
+        // Degree 6 diagonal Pade approximant: e^A ~ D^-1 N, where N = sum c_k A^k and D = sum (-1)^k c_k A^k
+        constexpr uint8_t q = 6;
+        Matrix *x = &power;
+        Matrix *temp = &scratch;
+        double c = 1;
+        for (uint8_t k = 1; k <= q; k++) {
+            c = c * (q - k + 1) / ((2 * q - k + 1) * k);
+            matkern::gemm(m, m, m, 1, a.view(), x->view(), 0, temp->view());
+            util::swap(x, temp);
+            const matkern::View xView = x->view();
+            const matkern::View numView = num.view();
+            const matkern::View denomView = denom.view();
+            for (uint16_t i = 0; i < m; i++) {
+                matkern::axpy(m, c, &xView(i, 0), 1, &numView(i, 0), 1);
+                matkern::axpy(m, k % 2 ? -c : c, &xView(i, 0), 1, &denomView(i, 0), 1);
+            }
+        }
+        Matrix *result = LUDecomposition(static_cast<Matrix &&>(denom), true).solve(num);
+        if (!result) {
+            return nullptr;
+        }
+
+        // Undo the scaling: e^A = (e^(A/2^s))^(2^s)
+        // The squares alternate between the result and a scratch matrix
+        Matrix *square = result;
+        temp = &scratch;
+        for (; s > 0; s--) {
+            matkern::gemm(m, m, m, 1, square->view(), square->view(), 0, temp->view());
+            util::swap(square, temp);
+        }
+        if (square != result) {
+            // The last square ended up in the scratch matrix, so take its entries
+            delete result;
+            result = new Matrix(static_cast<Matrix &&>(scratch));
+        }
+        result->structure = Structure::UNKNOWN;
+        return result;
+    }
+    Matrix *Matrix::getRowVector(uint16_t row) const {
+        if (row >= m) {
+            return nullptr;
+        }
+        return new Matrix(*this, 1, n, &view()(row, 0), n * colStride, colStride);
+    }
+    Matrix *Matrix::getColVector(uint16_t col) const {
+        if (col >= n) {
+            return nullptr;
+        }
+        return new Matrix(*this, m, 1, &view()(0, col), rowStride, 1);
+    }
+
+    /******************** LUDecomposition ********************/
+    LUDecomposition::LUDecomposition(const Matrix &a, bool floatingPoint)
+            : lu(a), perm(new uint16_t[a.m]), oddSwaps(false), singular(false), floatingPoint(floatingPoint) {
+        factor();
+    }
+    LUDecomposition::LUDecomposition(Matrix &&a, bool floatingPoint)
+            : lu(static_cast<Matrix &&>(a)), perm(new uint16_t[lu.m]), oddSwaps(false), singular(false),
+              floatingPoint(floatingPoint) {
+        factor();
+    }
+    void LUDecomposition::factor() {
+        const uint16_t n = lu.m;
+        // The kernels write to the entries directly
+        lu.setStructure(Matrix::Structure::UNKNOWN);
+        if (!floatingPoint) {
+            floatingPoint = lu.isFloatingPoint();
+        }
+        // Packed doubles are faster for the kernels
+        if (floatingPoint) {
+            lu.convert(Matrix::Storage::DOUBLE);
+        }
+        for (uint16_t i = 0; i < n; i++) {
+            perm[i] = i;
+        }
+
+        for (uint16_t k = 0; k < n; k++) {
+            // Partial pivoting: find the entry in this column with the largest magnitude
+            uint16_t pivotRow = k;
+            double pivotMag = util::abs(lu.getEntry(k, k).asDouble());
+            for (uint16_t i = k + 1; i < n; i++) {
+                double mag = util::abs(lu.getEntry(i, k).asDouble());
+                if (mag > pivotMag) {
+                    pivotRow = i;
+                    pivotMag = mag;
+                }
+            }
+            // The entire column is 0, so the matrix is singular
+            // Keep going anyways so that U still has the correct shape
+            if (pivotMag == 0) {
+                singular = true;
+                continue;
+            }
+            if (pivotRow != k) {
+                lu.rowSwap(k, pivotRow);
+                util::swap(perm[k], perm[pivotRow]);
+                oddSwaps = !oddSwaps;
+            }
+
+            const util::Numerical pivot = lu.getEntry(k, k);
+            for (uint16_t i = k + 1; i < n; i++) {
+                util::Numerical factor = lu.getEntry(i, k);
+                if (factor == 0) {
+                    continue;
+                }
+                // Store the multiplier in the space freed up below the diagonal
+                // Entries must stay as doubles for the kernels, even if the division happens to give an integer
+                if (floatingPoint) {
+                    factor = factor.asDouble() / pivot.asDouble();
+                }
+                else {
+                    factor /= pivot;
+                }
+                lu.setEntry(i, k, factor);
+                lu.rowAdd(i, k, -factor, floatingPoint, k + 1);
+            }
+        }
+    }
+    LUDecomposition::~LUDecomposition() {
+        delete[] perm;
+    }
+
+    // The last matrix factored, and its factorization
+    // This is so that repeated operations with the same matrix (e.g. solving with a matrix variable while graphing)
+    // does not need to factor the matrix every time
+    Matrix *luCacheSource = nullptr;
+    LUDecomposition *luCache = nullptr;
+
+    const LUDecomposition &LUDecomposition::of(const Matrix &a) {
+        if (luCache && luCacheSource->m == a.m && luCacheSource->n == a.n &&
+                luCacheSource->getStorage() == a.getStorage()) {
+            // Copies of the same matrix share their entries, so there's no need to compare them
+            bool same = luCacheSource->data == a.data && luCacheSource->rowStride == a.rowStride &&
+                        luCacheSource->colStride == a.colStride;
+            if (same) {
+                return *luCache;
+            }
+            same = true;
+            for (uint32_t i = 0; i < a.size() && same; i++) {
+                const util::Numerical x = (*luCacheSource)[i];
+                const util::Numerical y = a[i];
+                // Compare the representations, since a fraction and a double with the same value factor differently
+                same = x.isNumber() == y.isNumber() && x == y;
+            }
+            if (same) {
+                return *luCache;
+            }
+        }
+        clearCache();
+        luCacheSource = new Matrix(a);
+        luCache = new LUDecomposition(a);
+        return *luCache;
+    }
+    void LUDecomposition::clearCache() {
+        delete luCacheSource;
+        delete luCache;
+        luCacheSource = nullptr;
+        luCache = nullptr;
+    }
+    util::Numerical LUDecomposition::det() const {
+        if (singular) {
+            return 0;
+        }
+        // The determinant of a triangular matrix is the product of its main diagonal
+        if (floatingPoint) {
+            double d = 1;
+            for (uint16_t i = 0; i < lu.m; i++) {
+                d *= lu.getEntry(i, i).asDouble();
+            }
+            return oddSwaps ? -d : d;
+        }
+        util::Numerical d = 1;
+        for (uint16_t i = 0; i < lu.m; i++) {
+            d *= lu.getEntry(i, i);
+        }
+        // Swapping two rows negates the determinant
+        return oddSwaps ? -d : d;
+    }
+    Matrix *LUDecomposition::solve(const Matrix &b) const {
+        const uint16_t n = lu.m;
+        if (singular || b.m != n) {
+            return nullptr;
+        }
+
+        Matrix *x = new Matrix(n, b.n);
+        if (floatingPoint) {
+            // The solution is going to be floating-point anyways, so do the substitutions with the kernels
+            const matkern::View luView = lu.view();
+            const matkern::View xView = x->view();
+            for (uint16_t col = 0; col < b.n; col++) {
+                for (uint16_t i = 0; i < n; i++) {
+                    xView(i, col) = b.getEntry(perm[i], col).asDouble() -
+                                    matkern::dot(i, &luView(i, 0), luView.colStride, &xView(0, col), xView.rowStride);
+                }
+                for (uint16_t i = n; i-- > 0;) {
+                    xView(i, col) = (xView(i, col) - matkern::dot(n - i - 1, &luView(i, i + 1), luView.colStride,
+                                                             &xView(i + 1, col), xView.rowStride)) /
+                                    luView(i, i);
+                }
+            }
+            return x;
+        }
+        for (uint16_t col = 0; col < b.n; col++) {
+            // Forward substitution with L, applying the permutation on the fly
+            for (uint16_t i = 0; i < n; i++) {
+                util::Numerical sum = b.getEntry(perm[i], col);
+                for (uint16_t j = 0; j < i; j++) {
+                    sum -= lu.getEntry(i, j) * x->getEntry(j, col);
+                }
+                x->setEntry(i, col, sum);
+            }
+            // Back substitution with U
+            for (uint16_t i = n; i-- > 0;) {
+                util::Numerical sum = x->getEntry(i, col);
+                for (uint16_t j = i + 1; j < n; j++) {
+                    sum -= lu.getEntry(i, j) * x->getEntry(j, col);
+                }
+                x->setEntry(i, col, sum / lu.getEntry(i, i));
+            }
+        }
+        return x;
+    }
+    Matrix *LUDecomposition::inv() const {
+        if (singular) {
+            return nullptr;
+        }
+        Matrix identity(lu.m, lu.m);
+        for (uint16_t i = 0; i < lu.m; i++) {
+            identity.setEntry(i, i, 1);
+        }
+        return solve(identity);
+    }
+
+    /******************** Polynomial ********************/
+    Polynomial::Polynomial(uint16_t count) : coeffs(new double[count]), count(count) {
+        for (uint16_t i = 0; i < count; i++) {
+            coeffs[i] = 0;
+        }
+    }
+    Polynomial::Polynomial(const Polynomial &other) : coeffs(new double[other.count]), count(other.count) {
+        memcpy(coeffs, other.coeffs, sizeof(double) * count);
+    }
+    void Polynomial::normalize() {
+        while (count > 1 && coeffs[count - 1] == 0) {
+            count--;
+        }
+    }
+    Polynomial *Polynomial::derivative() const {
+        Polynomial *result = new Polynomial(count > 1 ? count - 1 : 1);
+        poly::derivative(coeffs, count, result->coeffs);
+        return result;
+    }
+
+    /******************** Operator ********************/
+    uint8_t Operator::getPrecedence() const {
+        switch (type) {
         case Type::SP_MULT:
         case Type::SP_DIV:
             return 0;
@@ -401,6 +1517,16 @@ namespace eval {
             return false;
         }
     }
+    bool Operator::isPostfix() const {
+        switch (type) {
+        case Type::FACT:
+        case Type::TRANSPOSE:
+        case Type::INVERSE:
+            return true;
+        default:
+            return false;
+        }
+    }
     const Operator *Operator::fromChar(char ch) {
         switch (ch) {
         case '+':
@@ -457,195 +1583,338 @@ namespace eval {
             return nullptr;
         }
     }
-    Token *Operator::operator()(Token *lhs, Token *rhs) const {
-        Token *result = nullptr;
-        switch (type) {
-        case Type::PLUS: {
-            if (lhs->getType() == TokenType::NUMERICAL && rhs->getType() == TokenType::NUMERICAL) {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value + static_cast<Numerical *>(rhs)->value);
-            }
-            else if (lhs->getType() == TokenType::MATRIX && rhs->getType() == TokenType::MATRIX) {
-                result = Matrix::add(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs));
-            }
-            break;
+    // Carries out the pending transpose of a matrix token
+    void resolveTranspose(Token *t) {
+        if (t->getType() == TokenType::MATRIX) {
+            static_cast<Matrix *>(t)->resolveTranspose();
         }
-        case Type::MINUS: {
-            if (lhs->getType() == TokenType::NUMERICAL && rhs->getType() == TokenType::NUMERICAL) {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value - static_cast<Numerical *>(rhs)->value);
+    }
+    /*
+     * Applies a binary operator to each entry of one or two matrices of the same size, broadcasting scalars.
+     * Like Operator::operator(), this deletes the operands.
+     */
+    Token *applyElementwise(const Operator &op, Token *lhs, Token *rhs) {
+        resolveTranspose(lhs);
+        resolveTranspose(rhs);
+        Matrix *lMat = lhs->getType() == TokenType::MATRIX ? static_cast<Matrix *>(lhs) : nullptr;
+        Matrix *rMat = rhs->getType() == TokenType::MATRIX ? static_cast<Matrix *>(rhs) : nullptr;
+        if (lMat && rMat && (lMat->m != rMat->m || lMat->n != rMat->n)) {
+            delete lhs;
+            delete rhs;
+            return new Numerical(NAN);
+        }
+        // The result is written over one of the matrix operands, since it would be deleted afterwards anyways
+        Matrix *result = lMat ? lMat : rMat;
+        (lMat ? lhs : rhs) = nullptr;
+        const util::Numerical *scalar = !lMat ? &static_cast<Numerical *>(lhs)->value :
+                                        !rMat ? &static_cast<Numerical *>(rhs)->value : nullptr;
+
+        // Floating-point entries with a number can be done directly on the doubles
+        if (scalar && scalar->isNumber() && result->getStorage() == Matrix::Storage::DOUBLE &&
+                result->isFloatingPoint() && (op.type == Operator::Type::PLUS || op.type == Operator::Type::MINUS)) {
+            result->makeWritable();
+            result->setStructure(Matrix::Structure::UNKNOWN);
+            const matkern::View v = result->view();
+            const double x = scalar->asDouble();
+            // Scalar minus matrix flips the sign of the entries
+            const double sign = op.type == Operator::Type::MINUS && !lMat ? -1 : 1;
+            const double offset = op.type == Operator::Type::MINUS && lMat ? -x : x;
+            for (uint16_t i = 0; i < result->m; i++) {
+                for (uint16_t j = 0; j < result->n; j++) {
+                    v(i, j) = sign * v(i, j) + offset;
+                }
             }
-            else if (lhs->getType() == TokenType::MATRIX && rhs->getType() == TokenType::MATRIX) {
-                result = Matrix::subtract(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs));
+        }
+        else {
+            for (uint32_t i = 0; i < result->size(); i++) {
+                util::Numerical entry = lMat ? (*lMat)[i] : *scalar;
+                // Syntax errors stay syntax errors
+                if (!op.applyScalar(entry, rMat ? (*rMat)[i] : *scalar)) {
+                    delete result;
+                    result = nullptr;
+                    break;
+                }
+                result->set(i, entry);
             }
-            break;
         }
+        delete lhs;
+        delete rhs;
+        return result;
+    }
+    bool Operator::applyScalar(util::Numerical &lhs, const util::Numerical &rhs) const {
+        switch (type) {
+        case Type::PLUS:
+            lhs += rhs;
+            return true;
+        case Type::MINUS:
+            lhs -= rhs;
+            return true;
         // Cross product symbol is treated like regular multiplication when not on vectors
         case Type::CROSS:
         case Type::SP_MULT:
-        case Type::MULTIPLY: {
-            if (lhs->getType() == TokenType::NUMERICAL && rhs->getType() == TokenType::NUMERICAL) {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value * static_cast<Numerical *>(rhs)->value);
+        case Type::MULTIPLY:
+            lhs *= rhs;
+            return true;
+        case Type::SP_DIV:
+        case Type::DIVIDE:
+            // If auto fractions is off, the division of integers must not create a fraction
+            // So if both operands are integers, convert them to doubles and use the builtin double / operator
+            if (!autoFractions && util::isInt(lhs.asDouble()) && util::isInt(rhs.asDouble())) {
+                lhs = lhs.asDouble() / rhs.asDouble();
             }
-            else if (lhs->getType() == TokenType::MATRIX && rhs->getType() == TokenType::MATRIX) {
-                if (type == Type::MULTIPLY) {
-                    result = Matrix::multiply(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs));
-                    // If matrix multiplication is not possible, try to take the dot product
-                    if (!result) {
-                        auto n = Matrix::dot(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs));
-                        if (!isnan(static_cast<double>(n))) {
-                            result = new Numerical(n);
-                        }
-                    }
-                }
-                else {
-                    result = Matrix::cross(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs));
-                }
+            else {
+                lhs /= rhs;
             }
-            else if (lhs->getType() == TokenType::NUMERICAL && rhs->getType() == TokenType::MATRIX) {
-                result = Matrix::multiply(*static_cast<Matrix *>(rhs), static_cast<Numerical *>(lhs)->value);
+            return true;
+        case Type::EXPONENT:
+            lhs.pow(rhs);
+            return true;
+        case Type::EQUALITY:
+            lhs = lhs.feq(rhs);
+            return true;
+        case Type::NOT_EQUAL:
+            lhs = !lhs.feq(rhs);
+            return true;
+        case Type::GT:
+            lhs = lhs > rhs;
+            return true;
+        case Type::LT:
+            lhs = lhs < rhs;
+            return true;
+        case Type::GTEQ:
+            lhs = lhs > rhs || lhs.feq(rhs);
+            return true;
+        case Type::LTEQ:
+            lhs = lhs < rhs || lhs.feq(rhs);
+            return true;
+        case Type::AND:
+        case Type::OR:
+        case Type::XOR: {
+            int8_t l = isTruthy(lhs);
+            int8_t r = isTruthy(rhs);
+
+            if (l == -1 || r == -1) {
+                lhs = NAN;
             }
             else {
-                result = Matrix::multiply(*static_cast<Matrix *>(lhs), static_cast<Numerical *>(rhs)->value);
+                lhs = type == Type::AND ? l && r : type == Type::OR ? l || r : l ^ r;
             }
-            break;
+            return true;
         }
-        case Type::SP_DIV:
-        case Type::DIVIDE: {
-            if (lhs->getType() == TokenType::NUMERICAL && rhs->getType() == TokenType::NUMERICAL) {
-                // If auto fractions is off, the division of integers must not create a fraction
-                // So if both operands are integers, convert them to doubles and use the builtin double / operator
-                if (!autoFractions && util::isInt(static_cast<Numerical *>(lhs)->value.asDouble()) &&
-                        util::isInt(static_cast<Numerical *>(rhs)->value.asDouble())) {
-                    result = new Numerical(static_cast<Numerical *>(lhs)->value.asDouble() /
-                                           static_cast<Numerical *>(rhs)->value.asDouble());
-                }
-                else {
-                    result = new Numerical(static_cast<Numerical *>(lhs)->value / static_cast<Numerical *>(rhs)->value);
-                }
+        default:
+            return false;
+        }
+    }
+    /*
+     * Applies a binary operator where at least one operand is a polynomial, with numbers acting as constant
+     * polynomials. Like Operator::operator(), this deletes the operands.
+     */
+    Token *applyPolynomial(Operator::Type type, Token *lhs, Token *rhs) {
+        // Polynomials with matrices are not defined
+        if (lhs->getType() == TokenType::MATRIX || rhs->getType() == TokenType::MATRIX) {
+            delete lhs;
+            delete rhs;
+            return nullptr;
+        }
+        const Polynomial *lPoly = lhs->getType() == TokenType::POLYNOMIAL ? static_cast<Polynomial *>(lhs) : nullptr;
+        const Polynomial *rPoly = rhs->getType() == TokenType::POLYNOMIAL ? static_cast<Polynomial *>(rhs) : nullptr;
+        const double lConst = lPoly ? 0 : static_cast<Numerical *>(lhs)->value.asDouble();
+        const double rConst = rPoly ? 0 : static_cast<Numerical *>(rhs)->value.asDouble();
+        const double *a = lPoly ? lPoly->coeffs : &lConst;
+        const double *b = rPoly ? rPoly->coeffs : &rConst;
+        const uint16_t na = lPoly ? lPoly->count : 1;
+        const uint16_t nb = rPoly ? rPoly->count : 1;
+
+        Polynomial *result = nullptr;
+        switch (type) {
+        case Operator::Type::PLUS:
+        case Operator::Type::MINUS: {
+            result = new Polynomial(util::max(na, nb));
+            const double sign = type == Operator::Type::MINUS ? -1 : 1;
+            for (uint16_t i = 0; i < na; i++) {
+                result->coeffs[i] = a[i];
             }
-            // Only matrix divided by scalar is allowed
-            else if (lhs->getType() == TokenType::MATRIX && rhs->getType() == TokenType::NUMERICAL) {
-                result = Matrix::multiply(*static_cast<Matrix *>(lhs), 1 / static_cast<Numerical *>(rhs)->value);
+            for (uint16_t i = 0; i < nb; i++) {
+                result->coeffs[i] += sign * b[i];
             }
             break;
         }
-        case Type::EXPONENT: {
-            // Currently only scalar exponentiation is supported
-            if (lhs->getType() == TokenType::NUMERICAL && rhs->getType() == TokenType::NUMERICAL) {
-                static_cast<Numerical *>(lhs)->value.pow(static_cast<Numerical *>(rhs)->value);
-                result = new Numerical(static_cast<Numerical *>(lhs)->value);
+        case Operator::Type::MULTIPLY:
+        case Operator::Type::CROSS:
+            if (static_cast<uint32_t>(na) + nb - 1 <= 0xFFFF) {
+                result = new Polynomial(na + nb - 1);
+                poly::multiply(a, na, b, nb, result->coeffs);
             }
             break;
-        }
-        case Type::EQUALITY: {
-            // Different types is always not equal
-            if (lhs->getType() != rhs->getType()) {
-                result = new Numerical(false);
+        // Only division by a number
+        case Operator::Type::DIVIDE:
+            if (!rPoly) {
+                result = new Polynomial(na);
+                for (uint16_t i = 0; i < na; i++) {
+                    result->coeffs[i] = a[i] / rConst;
+                }
             }
-            else if (lhs->getType() == TokenType::NUMERICAL) {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value.feq(static_cast<Numerical *>(rhs)->value));
+            break;
+        // Only nonnegative integer powers
+        case Operator::Type::EXPONENT: {
+            if (rPoly || !util::isInt(rConst) || rConst < 0 || (na - 1) * rConst + 1 > 0xFFFF) {
+                break;
             }
-            else {
-                result = new Numerical(Matrix::equality(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs)));
+            result = new Polynomial(1);
+            result->coeffs[0] = 1;
+            for (uint16_t i = 0; i < static_cast<uint16_t>(rConst); i++) {
+                Polynomial *product = new Polynomial(result->count + na - 1);
+                poly::multiply(result->coeffs, result->count, a, na, product->coeffs);
+                delete result;
+                result = product;
             }
             break;
         }
-        case Type::NOT_EQUAL: {
-            // Different types is always not equal
-            if (lhs->getType() != rhs->getType()) {
-                result = new Numerical(true);
-            }
-            else if (lhs->getType() == TokenType::NUMERICAL) {
-                result = new Numerical(!static_cast<Numerical *>(lhs)->value.feq(static_cast<Numerical *>(rhs)->value));
-            }
-            else {
-                result = new Numerical(!Matrix::equality(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs)));
-            }
+        default:
             break;
         }
-        case Type::GT: {
-            // Matrices cannot be involved in any way
-            if (lhs->getType() == TokenType::MATRIX || rhs->getType() == TokenType::MATRIX) {
-                result = nullptr;
-            }
-            // If neither are matrices then both must be numbers
-            else {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value > static_cast<Numerical *>(rhs)->value);
-            }
-            break;
+        if (result) {
+            result->normalize();
         }
-        case Type::LT: {
-            // Matrices cannot be involved in any way
-            if (lhs->getType() == TokenType::MATRIX || rhs->getType() == TokenType::MATRIX) {
-                result = nullptr;
+        delete lhs;
+        delete rhs;
+        return result;
+    }
+    Token *Operator::operator()(Token *lhs, Token *rhs) const {
+        if (lhs->getType() == TokenType::POLYNOMIAL || rhs->getType() == TokenType::POLYNOMIAL) {
+            return applyPolynomial(type, lhs, rhs);
+        }
+        const bool lMat = lhs->getType() == TokenType::MATRIX;
+        const bool rMat = rhs->getType() == TokenType::MATRIX;
+        if (!lMat && !rMat) {
+            // The result is stored in the left operand
+            if (!applyScalar(static_cast<Numerical *>(lhs)->value, static_cast<Numerical *>(rhs)->value)) {
+                delete lhs;
+                lhs = nullptr;
             }
-            // If neither are matrices then both must be numbers
-            else {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value < static_cast<Numerical *>(rhs)->value);
+            delete rhs;
+            return lhs;
+        }
+        // Adding a number to a matrix or comparing a matrix with something is done entry by entry
+        const bool broadcast = ((type == Type::PLUS || type == Type::MINUS) && lMat != rMat) || type == Type::GT ||
+                               type == Type::LT || type == Type::GTEQ || type == Type::LTEQ;
+        if ((elementwise && type != Type::AUGMENT) || broadcast) {
+            return applyElementwise(*this, lhs, rhs);
+        }
+        Token *result = nullptr;
+        // Only matrix multiplication can make use of pending transposes
+        if (type != Type::MULTIPLY || lhs->getType() != TokenType::MATRIX || rhs->getType() != TokenType::MATRIX) {
+            resolveTranspose(lhs);
+            resolveTranspose(rhs);
+        }
+        // Since both operands are deleted afterwards, matrix operations are done in place whenever possible
+        // When an operand is reused for the result, it is set to null so it doesn't get deleted
+        switch (type) {
+        case Type::PLUS:
+        case Type::MINUS: {
+            if (static_cast<Matrix *>(lhs)->addInPlace(*static_cast<Matrix *>(rhs), type == Type::MINUS ? -1 : 1)) {
+                result = lhs;
+                lhs = nullptr;
             }
             break;
         }
-        case Type::GTEQ: {
-            // Matrices cannot be involved in any way
-            if (lhs->getType() == TokenType::MATRIX || rhs->getType() == TokenType::MATRIX) {
-                result = nullptr;
+        // Cross product symbol is treated like regular multiplication when not on vectors
+        case Type::CROSS:
+        case Type::SP_MULT:
+        case Type::MULTIPLY: {
+            if (lMat && rMat) {
+                if (type == Type::MULTIPLY) {
+                    Matrix *a = static_cast<Matrix *>(lhs);
+                    Matrix *b = static_cast<Matrix *>(rhs);
+                    // Multiply using the transposes directly if there are pending transposes
+                    if ((a->pendingTranspose ? a->m : a->n) == (b->pendingTranspose ? b->n : b->m)) {
+                        Matrix *product =
+                                new Matrix(a->pendingTranspose ? a->n : a->m, b->pendingTranspose ? b->m : b->n);
+                        Matrix::multiply(*product, *a, *b, 1, 0, a->pendingTranspose, b->pendingTranspose);
+                        result = product;
+                    }
+                    // If matrix multiplication is not possible, try to take the dot product
+                    else {
+                        a->resolveTranspose();
+                        b->resolveTranspose();
+                        auto n = Matrix::dot(*a, *b);
+                        if (!isnan(static_cast<double>(n))) {
+                            result = new Numerical(n);
+                        }
+                    }
+                }
+                else {
+                    result = Matrix::cross(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs));
+                }
+            }
+            else if (rMat) {
+                static_cast<Matrix *>(rhs)->multiplyInPlace(static_cast<Numerical *>(lhs)->value);
+                result = rhs;
+                rhs = nullptr;
             }
-            // If neither are matrices then both must be numbers
             else {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value > static_cast<Numerical *>(rhs)->value ||
-                                       static_cast<Numerical *>(lhs)->value.feq(static_cast<Numerical *>(rhs)->value));
+                static_cast<Matrix *>(lhs)->multiplyInPlace(static_cast<Numerical *>(rhs)->value);
+                result = lhs;
+                lhs = nullptr;
             }
             break;
         }
-        case Type::LTEQ: {
-            // Matrices cannot be involved in any way
-            if (lhs->getType() == TokenType::MATRIX || rhs->getType() == TokenType::MATRIX) {
-                result = nullptr;
-            }
-            // If neither are matrices then both must be numbers
-            else {
-                result = new Numerical(static_cast<Numerical *>(lhs)->value < static_cast<Numerical *>(rhs)->value ||
-                                       static_cast<Numerical *>(lhs)->value.feq(static_cast<Numerical *>(rhs)->value));
+        case Type::SP_DIV:
+        case Type::DIVIDE: {
+            // Only matrix divided by scalar is allowed
+            if (lMat && !rMat) {
+                static_cast<Matrix *>(lhs)->multiplyInPlace(1 / static_cast<Numerical *>(rhs)->value);
+                result = lhs;
+                lhs = nullptr;
             }
             break;
         }
-        case Type::AND: {
-            int8_t l = isTruthy(lhs);
-            int8_t r = isTruthy(rhs);
-
-            if (l == -1 || r == -1) {
-                result = new Numerical(NAN);
+        case Type::EXPONENT: {
+            // Matrix powers are only defined for integer exponents
+            if (lMat && !rMat) {
+                const double e = static_cast<Numerical *>(rhs)->value.asDouble();
+                Matrix *mat = nullptr;
+                if (util::isInt(e) && util::abs(e) <= INT32_MAX) {
+                    mat = static_cast<Matrix *>(lhs)->pow(static_cast<int32_t>(e));
+                }
+                result = mat ? static_cast<Token *>(mat) : static_cast<Token *>(new Numerical(NAN));
             }
-            else {
-                result = new Numerical(l && r);
+            // b^A = e^(ln(b) A)
+            else if (!lMat && rMat) {
+                const double b = static_cast<Numerical *>(lhs)->value.asDouble();
+                Matrix *mat = nullptr;
+                if (b > 0) {
+                    Matrix *a = static_cast<Matrix *>(rhs);
+                    if (b != CONST_E) {
+                        a->multiplyInPlace(log(b));
+                    }
+                    mat = a->exp();
+                }
+                result = mat ? static_cast<Token *>(mat) : static_cast<Token *>(new Numerical(NAN));
             }
             break;
         }
-        case Type::OR: {
-            int8_t l = isTruthy(lhs);
-            int8_t r = isTruthy(rhs);
-
-            if (l == -1 || r == -1) {
-                result = new Numerical(NAN);
-            }
-            else {
-                result = new Numerical(l || r);
-            }
+        case Type::EQUALITY:
+        case Type::NOT_EQUAL: {
+            // Different types is always not equal
+            const bool equal =
+                    lMat == rMat && Matrix::equality(*static_cast<Matrix *>(lhs), *static_cast<Matrix *>(rhs));
+            result = new Numerical(type == Type::EQUALITY ? equal : !equal);
             break;
         }
+        // Matrices are always truthy
+        case Type::AND:
+        case Type::OR:
         case Type::XOR: {
-            int8_t l = isTruthy(lhs);
-            int8_t r = isTruthy(rhs);
-
-            if (l == -1 || r == -1) {
-                result = new Numerical(NAN);
-            }
-            else {
-                result = new Numerical(l ^ r);
-            }
+            const int8_t l = isTruthy(lhs);
+            const int8_t r = isTruthy(rhs);
+            util::Numerical value = l == -1 ? NAN : l;
+            applyScalar(value, r == -1 ? NAN : r);
+            result = new Numerical(value);
             break;
         }
         case Type::AUGMENT: {
-            if (lhs->getType() != TokenType::MATRIX || rhs->getType() != TokenType::MATRIX) {
+            if (!lMat || !rMat) {
                 result = nullptr;
                 break;
             }
@@ -657,8 +1926,8 @@ namespace eval {
             }
             else {
                 Matrix *mat = new Matrix(lMat->m, lMat->n + rMat->n);
-                for (uint8_t i = 0; i < mat->m; i++) {
-                    for (uint8_t j = 0; j < mat->n; j++) {
+                for (uint16_t i = 0; i < mat->m; i++) {
+                    for (uint16_t j = 0; j < mat->n; j++) {
                         if (j < lMat->n) {
                             mat->setEntry(i, j, lMat->getEntry(i, j));
                         }
@@ -679,63 +1948,107 @@ namespace eval {
         delete rhs;
         return result;
     }
-    Token *Operator::operator()(Token *t) const {
+    bool Operator::applyScalar(util::Numerical &x) const {
         switch (type) {
         case Type::NOT: {
-            int8_t truthy = isTruthy(t);
-            delete t;
-
-            if (truthy == 1) {
-                return new Numerical(false);
+            int8_t truthy = isTruthy(x);
+            // Undefined if the value is infinite or NaN
+            x = truthy == -1 ? NAN : !truthy;
+            return true;
+        }
+        case Type::NEGATE:
+            x = -x;
+            return true;
+        case Type::FACT: {
+            double n = x.asDouble();
+            if (!util::isInt(n) || n < 0) {
+                x = NAN;
+                return true;
             }
-            else if (truthy == 0) {
-                return new Numerical(true);
+            // Integers give exact results as long as they fit, however they were stored
+            // This way 20! and (19+1)! show the same result, like nPr(20,20)
+            if (n <= numtheory::MAX_EXACT_FACTORIAL) {
+                x = util::Numerical(numtheory::factorial(n), 1);
             }
-            // Undefined
             else {
-                return new Numerical(NAN);
+                x = numtheory::factorialDouble(util::min(n, numtheory::MAX_FACTORIAL + 1.0));
             }
+            return true;
         }
-        case Type::NEGATE: {
-            if (t->getType() == TokenType::NUMERICAL) {
-                static_cast<Numerical *>(t)->value = -static_cast<Numerical *>(t)->value;
-            }
-            // Matrix
-            else {
-                for (uint16_t i = 0; i < static_cast<Matrix *>(t)->m * static_cast<Matrix *>(t)->n; i++) {
-                    // Negate every entry
-                    (*static_cast<Matrix *>(t))[i] = -(*static_cast<Matrix *>(t))[i];
-                }
+        default:
+            return false;
+        }
+    }
+    Token *Operator::operator()(Token *t) const {
+        if (t->getType() == TokenType::NUMERICAL) {
+            if (!applyScalar(static_cast<Numerical *>(t)->value)) {
+                delete t;
+                return nullptr;
             }
             return t;
         }
+        if (t->getType() == TokenType::POLYNOMIAL) {
+            // Negation is the only unary operator that makes sense for polynomials
+            if (type != Type::NEGATE) {
+                delete t;
+                return nullptr;
+            }
+            Polynomial *p = static_cast<Polynomial *>(t);
+            for (uint16_t i = 0; i < p->count; i++) {
+                p->coeffs[i] = -p->coeffs[i];
+            }
+            return p;
+        }
+        Matrix *mat = static_cast<Matrix *>(t);
+        switch (type) {
+        case Type::NOT:
         case Type::FACT: {
-            double x = extractDouble(t);
-            delete t;
-            if (!util::isInt(x) || x < 0) {
-                return new Numerical(NAN);
+            // Matrices are always truthy
+            if (type == Type::NOT && !elementwise) {
+                delete t;
+                return new Numerical(false);
             }
-            double d = 1;
-            while (x > 0) {
-                d *= x;
-                --x;
+            mat->resolveTranspose();
+            for (uint32_t i = 0; i < mat->size(); i++) {
+                util::Numerical entry = (*mat)[i];
+                applyScalar(entry);
+                mat->set(i, entry);
+            }
+            return mat;
+        }
+        case Type::NEGATE: {
+            // Negating every entry doesn't care about the order, so any pending transpose can stay
+            if (mat->getStorage() == Matrix::Storage::DOUBLE) {
+                mat->makeWritable();
+                mat->setStructure(Matrix::Structure::UNKNOWN);
+                const matkern::View v = mat->view();
+                for (uint16_t i = 0; i < mat->m; i++) {
+                    for (uint16_t j = 0; j < mat->n; j++) {
+                        v(i, j) = -v(i, j);
+                    }
+                }
+                return mat;
+            }
+            for (uint32_t i = 0; i < mat->size(); i++) {
+                mat->set(i, -(*mat)[i]);
             }
-            return new Numerical(d);
+            return mat;
         }
         case Type::TRANSPOSE: {
             if (t->getType() != TokenType::MATRIX) {
                 return nullptr;
             }
+            // Don't move anything yet; the transpose is carried out later if it can't be fused into a multiplication
             Matrix *mat = static_cast<Matrix *>(t);
-            Matrix *result = mat->transpose();
-            delete t;
-            return result;
+            mat->pendingTranspose = !mat->pendingTranspose;
+            return mat;
         }
         case Type::INVERSE: {
             if (t->getType() != TokenType::MATRIX) {
                 return nullptr;
             }
             Matrix *mat = static_cast<Matrix *>(t);
+            mat->resolveTranspose();
             Matrix *result = mat->inv();
             delete t;
 
@@ -748,13 +2061,16 @@ namespace eval {
 
     /******************** Function ********************/
     // Must be in the same order as type
-    const char *const Function::FUNCNAMES[TYPE_COUNT] = {"sin", "cos", "tan", "asin", "acos", "atan", "atan2", "sinh",
+    constexpr const char *const Function::FUNCNAMES[TYPE_COUNT] = {"sin", "cos", "tan", "asin", "acos", "atan", "atan2", "sinh",
             "cosh", "tanh", "asinh", "acosh", "atanh", "ln",
             // log10 and log2 cannot be directly entered with a string
             "\xff", "\xff",
 
-            "qdRts", "round", "min", "max", "floor", "ceil", "det", "linSolve", "leastSquares", "rref", "mean", "rand"};
-    const char *const Function::FUNC_FULLNAMES[TYPE_COUNT_DISPLAYABLE] = {
+            "qdRts", "round", "min", "max", "floor", "ceil", "det", "linSolve", "leastSquares", "rref", "mean", "rand",
+            "fft", "ifft", "conv", "sum", "prod", "cumsum", "norm", "var", "sort", "median", "quantile", "mode",
+            "isPrime", "factor", "powmod", "modinv", "gcd", "lcm", "nCr", "nPr",
+            "poly", "coeffs", "roots", "deriv", "polyFit", "randint", "randn", "seed"};
+    constexpr const char *const Function::FUNC_FULLNAMES[TYPE_COUNT_DISPLAYABLE] = {
             "sin(angle)",
             "cos(angle)",
             "tan(angle)",
@@ -780,27 +2096,72 @@ namespace eval {
             "leastSquares(A, b)",
             "rref(A)",
             "mean(values...)",
-            "rand()",
+            "rand(m,n)",
+            "fft(v)",
+            "ifft(v)",
+            "conv(a,b)",
+            "sum(v)",
+            "prod(v)",
+            "cumsum(v)",
+            "norm(v)",
+            "var(v)",
+            "sort(v)",
+            "median(v)",
+            "quantile(v,p)",
+            "mode(v)",
+            "isPrime(n)",
+            "factor(n)",
+            "powmod(a,e,n)",
+            "modinv(a,n)",
+            "gcd(a,b)",
+            "lcm(a,b)",
+            "nCr(n,k)",
+            "nPr(n,k)",
+            "poly([an,...,a1,a0])",
+            "coeffs(p)",
+            "roots(p)",
+            "deriv(p)",
+            "polyFit(x,y,degree)",
+            "randint(a,b,m,n)",
+            "randn(m,n)",
+            "seed(s)",
             "linReg(x,y,model...)",
-            "solve(eqn,min,max,err)"
+            "linRegStats(x,y,model...)",
+            "solve(eqn,min,max,err)",
+            "ode(f,t0,y0,t1,tol)",
+            "fmin(f,a,b,tol)",
+            "fmax(f,a,b,tol)",
+            "nsolve(F,x0,tol)"
     };
+    constexpr lookup::PrefixIndex<Function::TYPE_COUNT_DISPLAYABLE> Function::FUNC_FULLNAMES_INDEX(FUNC_FULLNAMES);
+    constexpr lookup::PerfectHash<Function::TYPE_COUNT, 256> FUNCNAME_TABLE(Function::FUNCNAMES);
+    static_assert(FUNCNAME_TABLE.isValid(), "No perfect hash found for the function names");
+
     Function *Function::fromString(const char *str) {
-        for (uint8_t i = 0; i < TYPE_COUNT; i++) {
-            if (strcmp(str, FUNCNAMES[i]) == 0) {
-                return new Function(static_cast<Type>(i));
-            }
-        }
-        return nullptr;
+        const int16_t index = FUNCNAME_TABLE.find(str);
+        return index >= 0 ? new Function(static_cast<Type>(index)) : nullptr;
     }
     uint8_t Function::getNumArgs() const {
         switch (type) {
         case Type::QUADROOTS:
+        case Type::POWMOD:
+        case Type::POLYFIT:
             return 3;
         case Type::ROUND:
         case Type::LEASTSQUARES:
         case Type::ATAN2:
+        case Type::CONV:
+        case Type::QUANTILE:
+        case Type::MODINV:
+        case Type::GCD:
+        case Type::LCM:
+        case Type::NCR:
+        case Type::NPR:
+            return 2;
+        case Type::RANDINT:
             return 2;
         case Type::RAND:
+        case Type::RANDN:
             return 0;
         default:
             return 1;
@@ -811,89 +2172,532 @@ namespace eval {
         case Type::MIN:
         case Type::MAX:
         case Type::MEAN:
+        // The random functions take an optional size
+        case Type::RAND:
+        case Type::RANDINT:
+        case Type::RANDN:
             return true;
         default:
             return false;
         }
     }
-    Token *Function::operator()(Token **args, uint16_t argc) const {
-        // Since extractDouble returns NAN if the input is a matrix, functions that don't support matrices
-        // will simply return NAN
+    bool Function::isScalar() const {
         switch (type) {
-        case Type::SIN: {
-            return new Numerical(sin(TRIG_FUNC_INPUT(extractDouble(args[0]))));
+        case Type::QUADROOTS:
+        case Type::DET:
+        case Type::LINSOLVE:
+        case Type::LEASTSQUARES:
+        case Type::RREF:
+        case Type::FFT:
+        case Type::IFFT:
+        case Type::CONV:
+        case Type::SUM:
+        case Type::PROD:
+        case Type::CUMSUM:
+        case Type::NORM:
+        case Type::VAR:
+        case Type::SORT:
+        case Type::MEDIAN:
+        case Type::QUANTILE:
+        case Type::MODE:
+        case Type::FACTOR:
+        case Type::POLY:
+        case Type::COEFFS:
+        case Type::ROOTS:
+        case Type::DERIV:
+        case Type::POLYFIT:
+        case Type::RAND:
+        case Type::RANDINT:
+        case Type::RANDN:
+        case Type::SEED:
+            return false;
+        default:
+            return true;
         }
-        case Type::COS: {
-            return new Numerical(cos(TRIG_FUNC_INPUT(extractDouble(args[0]))));
+    }
+    // Gets the value of an integer, or returns false if x is not an integer that fits in 64 bits
+    bool asInteger(const util::Numerical &x, int64_t &out) {
+        if (!x.isNumber()) {
+            const util::Fraction frac = x.asFraction();
+            out = frac.num;
+            return frac.denom == 1;
+        }
+        const double d = x.asDouble();
+        // 2^63 is exactly representable but doesn't fit
+        if (!(d >= -9223372036854775808.0 && d < 9223372036854775808.0) || d != floor(d)) {
+            return false;
         }
-        case Type::TAN: {
-            return new Numerical(tan(TRIG_FUNC_INPUT(extractDouble(args[0]))));
+        out = static_cast<int64_t>(d);
+        return true;
+    }
+    // Gets the dimensions for the random matrix functions from two arguments
+    // Returns false if either isn't a positive integer that fits in 16 bits
+    bool asMatrixSize(const Token *m, const Token *n, uint16_t &rows, uint16_t &cols) {
+        int64_t mVal, nVal;
+        if (!asInteger(static_cast<const Numerical *>(m)->value, mVal) ||
+                !asInteger(static_cast<const Numerical *>(n)->value, nVal) || mVal < 1 || mVal > 0xFFFF || nVal < 1 ||
+                nVal > 0xFFFF) {
+            return false;
         }
-        case Type::ASIN: {
-            return new Numerical(TRIG_FUNC_OUTPUT(asin(extractDouble(args[0]))));
+        rows = mVal;
+        cols = nVal;
+        return true;
+    }
+    bool Function::applyScalar(const util::Numerical *args, uint16_t argc, util::Numerical &out) const {
+        switch (type) {
+        case Type::SIN:
+            out = sin(TRIG_FUNC_INPUT(args[0].asDouble()));
+            return true;
+        case Type::COS:
+            out = cos(TRIG_FUNC_INPUT(args[0].asDouble()));
+            return true;
+        case Type::TAN:
+            out = tan(TRIG_FUNC_INPUT(args[0].asDouble()));
+            return true;
+        case Type::ASIN:
+            out = TRIG_FUNC_OUTPUT(asin(args[0].asDouble()));
+            return true;
+        case Type::ACOS:
+            out = TRIG_FUNC_OUTPUT(acos(args[0].asDouble()));
+            return true;
+        case Type::ATAN:
+            out = TRIG_FUNC_OUTPUT(atan(args[0].asDouble()));
+            return true;
+        case Type::ATAN2:
+            out = TRIG_FUNC_OUTPUT(atan2(args[0].asDouble(), args[1].asDouble()));
+            return true;
+        case Type::LN:
+            out = log(args[0].asDouble());
+            return true;
+        case Type::LOG10:
+            out = log10(args[0].asDouble());
+            return true;
+        case Type::LOG2:
+            out = log2(args[0].asDouble());
+            return true;
+        case Type::SINH:
+            out = sinh(TRIG_FUNC_INPUT(args[0].asDouble()));
+            return true;
+        case Type::COSH:
+            out = cosh(TRIG_FUNC_INPUT(args[0].asDouble()));
+            return true;
+        case Type::TANH:
+            out = tanh(TRIG_FUNC_INPUT(args[0].asDouble()));
+            return true;
+        case Type::ASINH:
+            out = TRIG_FUNC_OUTPUT(asinh(args[0].asDouble()));
+            return true;
+        case Type::ACOSH:
+            out = TRIG_FUNC_OUTPUT(acosh(args[0].asDouble()));
+            return true;
+        case Type::ATANH:
+            out = TRIG_FUNC_OUTPUT(atanh(args[0].asDouble()));
+            return true;
+        case Type::ROUND:
+            if (!util::isInt(args[1].asDouble())) {
+                out = NAN;
+            }
+            else {
+                out = util::round(args[0].asDouble(), args[1].asDouble());
+            }
+            return true;
+        case Type::MIN:
+        case Type::MAX:
+            out = args[0];
+            for (uint16_t i = 1; i < argc; i++) {
+                if (type == Type::MIN ? args[i] < out : args[i] > out) {
+                    out = args[i];
+                }
+            }
+            return true;
+        case Type::FLOOR:
+            out = floor(args[0].asDouble());
+            return true;
+        case Type::CEIL:
+            out = ceil(args[0].asDouble());
+            return true;
+        case Type::MEAN:
+            out = 0;
+            for (uint16_t i = 0; i < argc; i++) {
+                out += (args[i] - out) / (i + 1);
+            }
+            return true;
+        case Type::ISPRIME: {
+            int64_t n;
+            if (!asInteger(args[0], n)) {
+                out = NAN;
+            }
+            else {
+                out = n > 0 && numtheory::isPrime(n);
+            }
+            return true;
         }
-        case Type::ACOS: {
-            return new Numerical(TRIG_FUNC_OUTPUT(acos(extractDouble(args[0]))));
+        case Type::POWMOD: {
+            int64_t a, e, n;
+            if (!asInteger(args[0], a) || !asInteger(args[1], e) || !asInteger(args[2], n) || n <= 0) {
+                out = NAN;
+                return true;
+            }
+            a = util::positiveMod(a, n);
+            // A negative power is a power of the inverse
+            // The power is negated as unsigned, since -2^63 has no positive int64
+            uint64_t power = e;
+            if (e < 0) {
+                a = numtheory::modinv(a, n);
+                if (!a && n != 1) {
+                    out = NAN;
+                    return true;
+                }
+                power = -static_cast<uint64_t>(e);
+            }
+            out = util::Numerical(numtheory::powmod(a, power, n), 1);
+            return true;
         }
-        case Type::ATAN: {
-            return new Numerical(TRIG_FUNC_OUTPUT(atan(extractDouble(args[0]))));
+        case Type::MODINV: {
+            int64_t a, n;
+            if (!asInteger(args[0], a) || !asInteger(args[1], n) || n <= 0) {
+                out = NAN;
+                return true;
+            }
+            const int64_t inv = numtheory::modinv(a, n);
+            // 0 is only a valid inverse mod 1
+            out = inv || n == 1 ? util::Numerical(inv, 1) : util::Numerical(NAN);
+            return true;
         }
-        case Type::ATAN2: {
-            return new Numerical(TRIG_FUNC_OUTPUT(atan2(extractDouble(args[0]), extractDouble(args[1]))));
+        case Type::GCD:
+        case Type::LCM: {
+            int64_t a, b;
+            if (!asInteger(args[0], a) || !asInteger(args[1], b)) {
+                out = NAN;
+                return true;
+            }
+            // The magnitudes are unsigned, since -2^63 has no positive int64
+            const uint64_t ua = a < 0 ? -static_cast<uint64_t>(a) : a;
+            const uint64_t ub = b < 0 ? -static_cast<uint64_t>(b) : b;
+            if (type == Type::GCD) {
+                const uint64_t gcd = numtheory::gcd(ua, ub);
+                // Only gcd(-2^63, 0) and gcd(-2^63, -2^63) don't fit
+                out = gcd <= INT64_MAX ? util::Numerical(static_cast<int64_t>(gcd), 1)
+                                       : util::Numerical(static_cast<double>(gcd));
+            }
+            // The lcm with 0 is 0, which also keeps the divisions below away from 0
+            else if (!ua || !ub) {
+                out = util::Numerical(0, 1);
+            }
+            else {
+                const uint64_t multiple = ua / numtheory::gcd(ua, ub);
+                // Fall back to floating point if the result doesn't fit
+                if (multiple > INT64_MAX / ub) {
+                    out = static_cast<double>(multiple) * ub;
+                }
+                else {
+                    out = util::Numerical(static_cast<int64_t>(multiple * ub), 1);
+                }
+            }
+            return true;
         }
-        case Type::LN: {
-            return new Numerical(log(extractDouble(args[0])));
+        case Type::NCR:
+        case Type::NPR: {
+            int64_t n, k;
+            if (!asInteger(args[0], n) || !asInteger(args[1], k) || n < 0 || k < 0) {
+                out = NAN;
+                return true;
+            }
+            int64_t result;
+            if (k > n) {
+                out = util::Numerical(0, 1);
+            }
+            else if (type == Type::NCR ? numtheory::binomial(n, k, result) : numtheory::permutations(n, k, result)) {
+                out = util::Numerical(result, 1);
+            }
+            else {
+                out = type == Type::NCR ? numtheory::binomialDouble(n, k) : numtheory::permutationsDouble(n, k);
+            }
+            return true;
         }
-        case Type::LOG10: {
-            return new Numerical(log10(extractDouble(args[0])));
+        default:
+            return false;
         }
-        case Type::LOG2: {
-            return new Numerical(log2(extractDouble(args[0])));
+    }
+    /*
+     * Reductions over all the entries of a matrix in row-major order, done in a single pass.
+     * Floating-point matrices are read straight from their storage as doubles; otherwise the entries are combined
+     * with util::Numerical so that fractions stay exact.
+     */
+    inline bool reducesAsDoubles(const Matrix &mat) {
+        return mat.getStorage() == Matrix::Storage::DOUBLE && mat.isFloatingPoint();
+    }
+    util::Numerical sumEntries(const Matrix &mat, bool product) {
+        if (reducesAsDoubles(mat)) {
+            const matkern::View v = mat.view();
+            double result = product ? 1 : 0;
+            for (uint16_t i = 0; i < mat.m; i++) {
+                for (uint16_t j = 0; j < mat.n; j++) {
+                    result = product ? result * v(i, j) : result + v(i, j);
+                }
+            }
+            return result;
         }
-        case Type::SINH: {
-            return new Numerical(sinh(TRIG_FUNC_INPUT(extractDouble(args[0]))));
+        util::Numerical result = product ? 1 : 0;
+        for (uint32_t i = 0; i < mat.size(); i++) {
+            if (product) {
+                result *= mat[i];
+            }
+            else {
+                result += mat[i];
+            }
         }
-        case Type::COSH: {
-            return new Numerical(cosh(TRIG_FUNC_INPUT(extractDouble(args[0]))));
+        return result;
+    }
+    util::Numerical extremeEntry(const Matrix &mat, bool max) {
+        if (reducesAsDoubles(mat)) {
+            const matkern::View v = mat.view();
+            double result = v(0, 0);
+            for (uint16_t i = 0; i < mat.m; i++) {
+                for (uint16_t j = 0; j < mat.n; j++) {
+                    result = max ? util::max(result, v(i, j)) : util::min(result, v(i, j));
+                }
+            }
+            return result;
         }
-        case Type::TANH: {
-            return new Numerical(tanh(TRIG_FUNC_INPUT(extractDouble(args[0]))));
+        util::Numerical result = mat[0];
+        for (uint32_t i = 1; i < mat.size(); i++) {
+            const util::Numerical x = mat[i];
+            if (max ? x > result : x < result) {
+                result = x;
+            }
         }
-        case Type::ASINH: {
-            return new Numerical(TRIG_FUNC_OUTPUT(asinh(extractDouble(args[0]))));
+        return result;
+    }
+    // The 2-norm (Frobenius norm for matrices)
+    util::Numerical normOf(const Matrix &mat) {
+        if (reducesAsDoubles(mat)) {
+            // Keep a running scale so that the squares can't overflow or underflow
+            const matkern::View v = mat.view();
+            double scale = 0;
+            double sumSquares = 1;
+            for (uint16_t i = 0; i < mat.m; i++) {
+                for (uint16_t j = 0; j < mat.n; j++) {
+                    const double x = util::abs(v(i, j));
+                    if (x == 0) {
+                        continue;
+                    }
+                    if (scale < x) {
+                        sumSquares = 1 + sumSquares * (scale / x) * (scale / x);
+                        scale = x;
+                    }
+                    else {
+                        sumSquares += (x / scale) * (x / scale);
+                    }
+                }
+            }
+            return scale * sqrt(sumSquares);
         }
-        case Type::ACOSH: {
-            return new Numerical(TRIG_FUNC_OUTPUT(acosh(extractDouble(args[0]))));
+        // Exact entries may have an exact norm, e.g. [3,4]
+        util::Numerical sumSquares = 0;
+        for (uint32_t i = 0; i < mat.size(); i++) {
+            const util::Numerical x = mat[i];
+            sumSquares += x * x;
         }
-        case Type::ATANH: {
-            return new Numerical(TRIG_FUNC_OUTPUT(atanh(extractDouble(args[0]))));
+        sumSquares.sqrt();
+        return sumSquares;
+    }
+    // Sample variance with Welford's algorithm, which doesn't lose precision to cancellation like the sum of squares
+    util::Numerical varianceOf(const Matrix &mat) {
+        if (mat.size() < 2) {
+            return NAN;
         }
-        case Type::QUADROOTS: {
-            if (args[0]->getType() == TokenType::MATRIX || args[1]->getType() == TokenType::MATRIX ||
-                    args[2]->getType() == TokenType::MATRIX) {
-                return nullptr;
-            }
-            auto &a = static_cast<Numerical *>(args[0])->value, &b = static_cast<Numerical *>(args[1])->value,
-                 &c = static_cast<Numerical *>(args[2])->value;
-            auto disc = b * b - 4 * a * c;
-            if (disc < 0) {
-                return new Numerical(NAN);
+        const int64_t dof = mat.size() - 1;
+        if (reducesAsDoubles(mat)) {
+            const matkern::View v = mat.view();
+            double mean = 0;
+            double m2 = 0;
+            uint32_t k = 0;
+            for (uint16_t i = 0; i < mat.m; i++) {
+                for (uint16_t j = 0; j < mat.n; j++) {
+                    const double x = v(i, j);
+                    const double delta = x - mean;
+                    mean += delta / ++k;
+                    m2 += delta * (x - mean);
+                }
             }
-            disc.sqrt();
-            Matrix *result = new Matrix(2, 1);
-            (*result)[0] = (-b + disc) / (2 * a);
-            (*result)[1] = (-b - disc) / (2 * a);
-            return result;
+            return m2 / dof;
         }
-        case Type::ROUND: {
-            if (args[0]->getType() == TokenType::MATRIX || args[1]->getType() == TokenType::MATRIX) {
-                return nullptr;
+        util::Numerical mean = 0;
+        util::Numerical m2 = 0;
+        for (uint32_t k = 0; k < mat.size(); k++) {
+            const util::Numerical x = mat[k];
+            const util::Numerical delta = x - mean;
+            mean += delta / util::Numerical(k + 1, 1);
+            m2 += delta * (x - mean);
+        }
+        return m2 / util::Numerical(dof, 1);
+    }
+    // Less-than for doubles that puts NaNs last, so that they still have a consistent order
+    inline bool lessDouble(double a, double b) {
+        return a < b || (isnan(b) && !isnan(a));
+    }
+    inline bool lessNumerical(const util::Numerical &a, const util::Numerical &b) {
+        return a < b;
+    }
+    // Copies a vector so that its entries can be reordered in place, or returns null if the token is not a vector
+    Matrix *reorderableCopy(Token *t) {
+        if (t->getType() != TokenType::MATRIX) {
+            return nullptr;
+        }
+        Matrix *vec = static_cast<Matrix *>(t);
+        vec->resolveTranspose();
+        if (vec->m != 1 && vec->n != 1) {
+            return nullptr;
+        }
+        Matrix *copy = new Matrix(*vec);
+        copy->makeContiguous();
+        return copy;
+    }
+    /*
+     * Finds the median, a quantile or the mode of n entries, reordering them in the process.
+     * Quantiles interpolate linearly between the two closest ranks, so the median is the quantile at p = 1/2.
+     */
+    template <typename T, typename Less>
+    util::Numerical orderStatistic(Function::Type type, T *x, uint32_t n, const util::Numerical &p, Less less) {
+        if (type == Function::Type::MODE) {
+            // Sort and find the longest run of equal values; ties go to the smallest value
+            util::introsort(x, n, less);
+            uint32_t best = 0;
+            uint32_t bestCount = 0;
+            for (uint32_t i = 0, count = 1; i < n; i++, count++) {
+                if (i + 1 == n || less(x[i], x[i + 1])) {
+                    if (count > bestCount) {
+                        best = i;
+                        bestCount = count;
+                    }
+                    count = 0;
+                }
+            }
+            return x[best];
+        }
+        const util::Numerical rank = p * util::Numerical(n - 1, 1);
+        const uint32_t lo = static_cast<uint32_t>(floor(rank.asDouble()));
+        const util::Numerical frac = rank - util::Numerical(lo, 1);
+        util::introselect(x, n, lo, less);
+        util::Numerical result = x[lo];
+        if (frac != 0 && lo + 1 < n) {
+            // Everything after lo is not less than it, so the next rank is the smallest of those
+            T next = x[lo + 1];
+            for (uint32_t i = lo + 2; i < n; i++) {
+                if (less(x[i], next)) {
+                    next = x[i];
+                }
+            }
+            result += frac * (util::Numerical(next) - result);
+        }
+        return result;
+    }
+    /*
+     * Makes a polynomial from a vector of coefficients in descending order of power (e.g. [1,0,-1] is x^2-1), a
+     * number, or another polynomial. Returns nullptr if t is not one of these.
+     */
+    Polynomial *toPolynomial(const Token *t) {
+        if (t->getType() == TokenType::POLYNOMIAL) {
+            return new Polynomial(*static_cast<const Polynomial *>(t));
+        }
+        if (t->getType() == TokenType::NUMERICAL) {
+            Polynomial *result = new Polynomial(1);
+            result->coeffs[0] = static_cast<const Numerical *>(t)->value.asDouble();
+            return result;
+        }
+        const Matrix *vec = static_cast<const Matrix *>(t);
+        if (vec->m != 1 && vec->n != 1) {
+            return nullptr;
+        }
+        Polynomial *result = new Polynomial(vec->size());
+        for (uint16_t i = 0; i < result->count; i++) {
+            result->coeffs[i] = (*vec)[result->count - 1 - i].asDouble();
+        }
+        result->normalize();
+        return result;
+    }
+    Token *Function::operator()(Token **args, uint16_t argc) const {
+        // Polynomials can only be given to the functions made for them
+        if (type != Type::POLY && type != Type::COEFFS && type != Type::ROOTS && type != Type::DERIV) {
+            for (uint16_t i = 0; i < argc; i++) {
+                if (args[i]->getType() == TokenType::POLYNOMIAL) {
+                    return nullptr;
+                }
+            }
+        }
+        // min, max and mean of a single matrix reduce over its entries instead of being applied to each one
+        if (!elementwise && argc == 1 && args[0]->getType() == TokenType::MATRIX &&
+                (type == Type::MIN || type == Type::MAX || type == Type::MEAN)) {
+            const Matrix &mat = *static_cast<Matrix *>(args[0]);
+            if (type == Type::MEAN) {
+                return new Numerical(sumEntries(mat, false) / util::Numerical(mat.size(), 1));
+            }
+            return new Numerical(extremeEntry(mat, type == Type::MAX));
+        }
+        if (isScalar()) {
+            // Matrix arguments are broadcast: the function is applied to each entry, with numbers used as they are
+            const Matrix *shape = nullptr;
+            for (uint16_t i = 0; i < argc; i++) {
+                if (args[i]->getType() == TokenType::MATRIX) {
+                    Matrix *mat = static_cast<Matrix *>(args[i]);
+                    mat->resolveTranspose();
+                    if (shape && (shape->m != mat->m || shape->n != mat->n)) {
+                        return new Numerical(NAN);
+                    }
+                    shape = mat;
+                }
+            }
+            // The arguments of one call go in a single buffer that is reused for every entry
+            util::Numerical argsBuf[4];
+            util::Numerical *entryArgs = argc <= 4 ? argsBuf : new util::Numerical[argc];
+            for (uint16_t i = 0; i < argc; i++) {
+                if (args[i]->getType() == TokenType::NUMERICAL) {
+                    entryArgs[i] = static_cast<Numerical *>(args[i])->value;
+                }
+            }
+            Token *result;
+            if (shape) {
+                Matrix *mat = new Matrix(shape->m, shape->n);
+                for (uint32_t i = 0; i < mat->size(); i++) {
+                    for (uint16_t j = 0; j < argc; j++) {
+                        if (args[j]->getType() == TokenType::MATRIX) {
+                            entryArgs[j] = (*static_cast<Matrix *>(args[j]))[i];
+                        }
+                    }
+                    util::Numerical entry;
+                    applyScalar(entryArgs, argc, entry);
+                    mat->set(i, entry);
+                }
+                result = mat;
+            }
+            else {
+                util::Numerical value;
+                applyScalar(entryArgs, argc, value);
+                result = new Numerical(value);
+            }
+            if (entryArgs != argsBuf) {
+                delete[] entryArgs;
+            }
+            return result;
+        }
+        switch (type) {
+        case Type::QUADROOTS: {
+            if (args[0]->getType() == TokenType::MATRIX || args[1]->getType() == TokenType::MATRIX ||
+                    args[2]->getType() == TokenType::MATRIX) {
+                return nullptr;
             }
-            if (!util::isInt(static_cast<Numerical *>(args[1])->value.asDouble())) {
+            auto &a = static_cast<Numerical *>(args[0])->value, &b = static_cast<Numerical *>(args[1])->value,
+                 &c = static_cast<Numerical *>(args[2])->value;
+            auto disc = b * b - 4 * a * c;
+            if (disc < 0) {
                 return new Numerical(NAN);
             }
-            return new Numerical(util::round(static_cast<Numerical *>(args[0])->value.asDouble(),
-                    static_cast<Numerical *>(args[1])->value.asDouble()));
+            disc.sqrt();
+            Matrix *result = new Matrix(2, 1);
+            result->set(0, (-b + disc) / (2 * a));
+            result->set(1, (-b - disc) / (2 * a));
+            return result;
         }
         case Type::DET: {
             // Syntax error: determinant of a scalar??
@@ -910,15 +2714,29 @@ namespace eval {
                 return nullptr;
             }
             Matrix *mat = static_cast<Matrix *>(args[0]);
-            if (!mat->eliminate(false)) {
-                return new Numerical(NAN);
+            // Split the augmented matrix into the coefficients and the constants
+            Matrix a(mat->m, mat->m);
+            Matrix b(mat->m, 1);
+            for (uint16_t i = 0; i < mat->m; i++) {
+                for (uint16_t j = 0; j < mat->m; j++) {
+                    a.setEntry(i, j, mat->getEntry(i, j));
+                }
+                b.set(i, mat->getEntry(i, mat->m));
             }
-            // Construct solution as vector
-            Matrix *solution = new Matrix(mat->m, 1);
-            for (uint8_t i = 0; i < mat->m; i++) {
-                (*solution)[i] = mat->getEntry(i, mat->m);
+            Matrix *solution;
+            if (Matrix::solveStructured(a, b, solution)) {
+                return solution ? static_cast<Token *>(solution) : static_cast<Token *>(new Numerical(NAN));
+            }
+            const bool exact = mat->isExact();
+            if (exact) {
+                Matrix augmented(*mat);
+                if (Matrix::solveExact(augmented, solution)) {
+                    return solution ? static_cast<Token *>(solution) : static_cast<Token *>(new Numerical(NAN));
+                }
             }
-            return solution;
+            // If the exact elimination overflowed, solve in floating-point instead
+            solution = exact ? LUDecomposition(a, true).solve(b) : LUDecomposition::of(a).solve(b);
+            return solution ? static_cast<Token *>(solution) : static_cast<Token *>(new Numerical(NAN));
         }
         case Type::LEASTSQUARES: {
             // Matrix
@@ -946,62 +2764,343 @@ namespace eval {
             mat->eliminate(true);
             return mat;
         }
-        case Type::MIN: {
-            if (args[0]->getType() != TokenType::NUMERICAL) {
+        case Type::SUM:
+        case Type::PROD:
+        case Type::NORM:
+        case Type::VAR: {
+            // The reductions of a number are trivial
+            if (args[0]->getType() == TokenType::NUMERICAL) {
+                const util::Numerical &x = static_cast<Numerical *>(args[0])->value;
+                return new Numerical(type == Type::NORM ? util::Numerical(util::abs(x.asDouble())) :
+                                     type == Type::VAR  ? util::Numerical(NAN) : x);
+            }
+            const Matrix &mat = *static_cast<Matrix *>(args[0]);
+            if (type == Type::NORM) {
+                return new Numerical(normOf(mat));
+            }
+            if (type == Type::VAR) {
+                return new Numerical(varianceOf(mat));
+            }
+            return new Numerical(sumEntries(mat, type == Type::PROD));
+        }
+        case Type::CUMSUM: {
+            if (args[0]->getType() != TokenType::MATRIX) {
+                return new Numerical(static_cast<Numerical *>(args[0])->value);
+            }
+            // The running sums are written over a copy, which has the same shape
+            static_cast<Matrix *>(args[0])->resolveTranspose();
+            Matrix *mat = new Matrix(*static_cast<Matrix *>(args[0]));
+            mat->setStructure(Matrix::Structure::UNKNOWN);
+            if (reducesAsDoubles(*mat)) {
+                mat->makeWritable();
+                const matkern::View v = mat->view();
+                double sum = 0;
+                for (uint16_t i = 0; i < mat->m; i++) {
+                    for (uint16_t j = 0; j < mat->n; j++) {
+                        sum += v(i, j);
+                        v(i, j) = sum;
+                    }
+                }
+                return mat;
+            }
+            util::Numerical sum = 0;
+            for (uint32_t i = 0; i < mat->size(); i++) {
+                sum += (*mat)[i];
+                mat->set(i, sum);
+            }
+            return mat;
+        }
+        case Type::SORT: {
+            Matrix *vec = reorderableCopy(args[0]);
+            if (!vec) {
                 return nullptr;
             }
-            util::Numerical *maxVal = &static_cast<Numerical *>(args[0])->value;
-            for (uint16_t i = 1; i < argc; i++) {
-                if (args[i]->getType() != TokenType::NUMERICAL) {
+            // Sort the entries where they are
+            if (vec->getStorage() == Matrix::Storage::DOUBLE) {
+                util::introsort(vec->view().data, vec->size(), lessDouble);
+            }
+            else {
+                util::introsort(reinterpret_cast<util::Numerical *>(vec->view().data), vec->size(), lessNumerical);
+            }
+            vec->setStructure(Matrix::Structure::UNKNOWN);
+            return vec;
+        }
+        case Type::MEDIAN:
+        case Type::QUANTILE:
+        case Type::MODE: {
+            util::Numerical p(1, 2);
+            if (type == Type::QUANTILE) {
+                if (args[1]->getType() != TokenType::NUMERICAL) {
                     return nullptr;
                 }
-
-                if (static_cast<Numerical *>(args[i])->value < *maxVal) {
-                    maxVal = &static_cast<Numerical *>(args[i])->value;
+                p = static_cast<Numerical *>(args[1])->value;
+                if (!(p.asDouble() >= 0 && p.asDouble() <= 1)) {
+                    return new Numerical(NAN);
                 }
             }
-            return new Numerical(*maxVal);
+            Matrix *vec = reorderableCopy(args[0]);
+            if (!vec) {
+                return nullptr;
+            }
+            util::Numerical result;
+            if (vec->getStorage() == Matrix::Storage::DOUBLE) {
+                result = orderStatistic(type, vec->view().data, vec->size(), p, lessDouble);
+            }
+            else {
+                result = orderStatistic(type, reinterpret_cast<util::Numerical *>(vec->view().data), vec->size(), p,
+                        lessNumerical);
+            }
+            delete vec;
+            return new Numerical(result);
         }
-        case Type::MAX: {
+        case Type::FACTOR: {
             if (args[0]->getType() != TokenType::NUMERICAL) {
                 return nullptr;
             }
-            util::Numerical *maxVal = &static_cast<Numerical *>(args[0])->value;
-            for (uint16_t i = 1; i < argc; i++) {
+            int64_t n;
+            if (!asInteger(static_cast<Numerical *>(args[0])->value, n) || n == 0) {
+                return new Numerical(NAN);
+            }
+            // The sign goes in front as a factor of -1
+            uint64_t factors[65];
+            const uint8_t sign = n < 0;
+            if (sign) {
+                factors[0] = -1;
+            }
+            uint8_t count = sign + numtheory::factor(n < 0 ? -static_cast<uint64_t>(n) : n, factors + sign);
+            if (!count) {
+                factors[count++] = 1;
+            }
+            Matrix *result = new Matrix(count, 1, Matrix::Storage::FRACTION);
+            for (uint8_t i = 0; i < count; i++) {
+                result->set(i, util::Numerical(i == 0 && sign ? -1 : static_cast<int64_t>(factors[i]), 1));
+            }
+            return result;
+        }
+        case Type::POLY:
+            return toPolynomial(args[0]);
+        case Type::COEFFS: {
+            Polynomial *p = toPolynomial(args[0]);
+            if (!p) {
+                return nullptr;
+            }
+            // Descending order, the same as poly() takes
+            Matrix *result = new Matrix(p->count, 1);
+            for (uint16_t i = 0; i < p->count; i++) {
+                result->set(i, p->coeffs[p->count - 1 - i]);
+            }
+            delete p;
+            return result;
+        }
+        case Type::DERIV: {
+            Polynomial *p = toPolynomial(args[0]);
+            if (!p) {
+                return nullptr;
+            }
+            Polynomial *result = p->derivative();
+            delete p;
+            return result;
+        }
+        case Type::POLYFIT: {
+            // Syntax error: the data must be two column vectors of the same length
+            if (args[0]->getType() != TokenType::MATRIX || args[1]->getType() != TokenType::MATRIX ||
+                    args[2]->getType() != TokenType::NUMERICAL) {
+                return nullptr;
+            }
+            const Matrix &x = *static_cast<Matrix *>(args[0]);
+            const Matrix &y = *static_cast<Matrix *>(args[1]);
+            if (x.n != 1 || y.n != 1 || x.m != y.m) {
+                return nullptr;
+            }
+            // There have to be more points than coefficients
+            int64_t degree;
+            if (!asInteger(static_cast<Numerical *>(args[2])->value, degree) || degree < 0 || degree >= x.m) {
+                return new Numerical(NAN);
+            }
+            // Column i of the Vandermonde matrix holds x^i, so the solution is the coefficients in ascending order
+            Matrix a(x.m, degree + 1);
+            for (uint16_t row = 0; row < x.m; row++) {
+                const double xi = x[row].asDouble();
+                double power = 1;
+                for (uint16_t col = 0; col <= degree; col++) {
+                    a.setEntry(row, col, power);
+                    power *= xi;
+                }
+            }
+            // QR instead of the normal equations, since Vandermonde matrices are often ill-conditioned
+            Matrix *solution = Matrix::leastSquaresQR(a, y);
+            if (!solution) {
+                return new Numerical(NAN);
+            }
+            Polynomial *result = new Polynomial(degree + 1);
+            for (uint16_t i = 0; i < result->count; i++) {
+                result->coeffs[i] = (*solution)[i].asDouble();
+            }
+            delete solution;
+            result->normalize();
+            return result;
+        }
+        case Type::ROOTS: {
+            Polynomial *p = toPolynomial(args[0]);
+            if (!p) {
+                return nullptr;
+            }
+            // Error: constants have no roots to find, and a matrix of none can't be shown
+            if (p->count == 1) {
+                delete p;
+                return nullptr;
+            }
+            // The roots are complex, so they go in an n x 2 matrix with the real parts in the first column like fft()
+            Matrix *result = new Matrix(p->count - 1, 2);
+            const bool converged =
+                    poly::roots(p->coeffs, p->count, reinterpret_cast<poly::Complex *>(result->view().data));
+            delete p;
+            if (!converged) {
+                delete result;
+                return new Numerical(NAN);
+            }
+            return result;
+        }
+        case Type::RAND:
+        case Type::RANDN:
+        case Type::RANDINT: {
+            // The size comes last, after the bounds for randint()
+            const uint16_t sizeArg = type == Type::RANDINT ? 2 : 0;
+            if (argc != sizeArg && argc != sizeArg + 2) {
+                return nullptr;
+            }
+            for (uint16_t i = 0; i < argc; i++) {
                 if (args[i]->getType() != TokenType::NUMERICAL) {
                     return nullptr;
                 }
+            }
+            uint16_t rows = 1, cols = 1;
+            if (argc == sizeArg + 2 && !asMatrixSize(args[sizeArg], args[sizeArg + 1], rows, cols)) {
+                return new Numerical(NAN);
+            }
 
-                if (static_cast<Numerical *>(args[i])->value > *maxVal) {
-                    maxVal = &static_cast<Numerical *>(args[i])->value;
+            if (type == Type::RANDINT) {
+                int64_t a, b;
+                if (!asInteger(static_cast<Numerical *>(args[0])->value, a) ||
+                        !asInteger(static_cast<Numerical *>(args[1])->value, b) || a > b) {
+                    return new Numerical(NAN);
+                }
+                // Inclusive on both ends; a range of every int64 wraps around to 0, which below() takes as 2^64
+                const uint64_t range = static_cast<uint64_t>(b) - static_cast<uint64_t>(a) + 1;
+                if (argc == sizeArg) {
+                    return new Numerical(util::Numerical(static_cast<int64_t>(a + rng::below(range)), 1));
+                }
+                Matrix *result = new Matrix(rows, cols, Matrix::Storage::FRACTION);
+                for (uint32_t i = 0; i < result->size(); i++) {
+                    result->set(i, util::Numerical(static_cast<int64_t>(a + rng::below(range)), 1));
                 }
+                return result;
+            }
+
+            if (argc == sizeArg) {
+                return new Numerical(type == Type::RANDN ? rng::normal() : rng::uniform());
+            }
+            // New matrices are contiguous packed doubles, so they can be filled directly
+            Matrix *result = new Matrix(rows, cols);
+            if (type == Type::RANDN) {
+                rng::fillNormal(result->view().data, result->size());
             }
-            return new Numerical(*maxVal);
+            else {
+                rng::fillUniform(result->view().data, result->size());
+            }
+            return result;
         }
-        case Type::FLOOR: {
-            if (args[0]->getType() == TokenType::MATRIX) {
+        case Type::SEED: {
+            if (args[0]->getType() != TokenType::NUMERICAL) {
                 return nullptr;
             }
-            return new Numerical(floor(extractDouble(args[0])));
+            int64_t s;
+            if (!asInteger(static_cast<Numerical *>(args[0])->value, s)) {
+                return new Numerical(NAN);
+            }
+            rng::seed(s);
+            return new Numerical(util::Numerical(s, 1));
         }
-        case Type::CEIL: {
-            if (args[0]->getType() == TokenType::MATRIX) {
+        case Type::FFT:
+        case Type::IFFT: {
+            if (args[0]->getType() != TokenType::MATRIX) {
+                return nullptr;
+            }
+            const Matrix *vec = static_cast<Matrix *>(args[0]);
+            // Vectors are real sequences; n x 2 matrices are complex, with the real parts in the first column
+            const bool complex = vec->n == 2 && vec->m > 1;
+            if (!complex && vec->m != 1 && vec->n != 1) {
                 return nullptr;
             }
-            return new Numerical(ceil(extractDouble(args[0])));
+            const uint16_t len = complex ? vec->m : vec->size();
+            // The result is n x 2, which has the same layout as the interleaved complex values the FFT works on
+            Matrix *result = new Matrix(len, 2);
+            double *data = result->view().data;
+            for (uint16_t i = 0; i < len; i++) {
+                data[2 * i] = (complex ? vec->getEntry(i, 0) : (*vec)[i]).asDouble();
+                data[2 * i + 1] = complex ? vec->getEntry(i, 1).asDouble() : 0;
+            }
+            if (!fft::transform(data, len, type == Type::IFFT)) {
+                delete result;
+                return new Numerical(NAN);
+            }
+            return result;
         }
-        case Type::MEAN: {
-            util::Numerical avg(0);
-            for (uint16_t i = 0; i < argc; i++) {
-                if (args[i]->getType() != TokenType::NUMERICAL) {
-                    return nullptr;
+        case Type::CONV: {
+            if (args[0]->getType() != TokenType::MATRIX || args[1]->getType() != TokenType::MATRIX) {
+                return nullptr;
+            }
+            const Matrix *a = static_cast<Matrix *>(args[0]);
+            const Matrix *b = static_cast<Matrix *>(args[1]);
+            if ((a->m != 1 && a->n != 1) || (b->m != 1 && b->n != 1)) {
+                return nullptr;
+            }
+            const uint16_t na = a->size();
+            const uint16_t nb = b->size();
+            if (static_cast<uint32_t>(na) + nb - 1 > 0xFFFF) {
+                return new Numerical(NAN);
+            }
+            const uint16_t len = na + nb - 1;
+            Matrix *result = new Matrix(len, 1);
+            // Short sequences are convolved directly, which also keeps exact values exact
+            if (util::min(na, nb) <= fft::CONV_DIRECT_THRESHOLD) {
+                for (uint16_t i = 0; i < len; i++) {
+                    util::Numerical sum = 0;
+                    for (uint16_t j = i < nb ? 0 : i - nb + 1; j <= i && j < na; j++) {
+                        sum += (*a)[j] * (*b)[i - j];
+                    }
+                    result->set(i, sum);
+                }
+                return result;
+            }
+            double *values = new double[na + nb];
+            bool integers = true;
+            double maxA = 0, maxB = 0;
+            for (uint16_t i = 0; i < na; i++) {
+                values[i] = (*a)[i].asDouble();
+                integers &= util::isInt(values[i]);
+                maxA = util::max(maxA, util::abs(values[i]));
+            }
+            for (uint16_t i = 0; i < nb; i++) {
+                values[na + i] = (*b)[i].asDouble();
+                integers &= util::isInt(values[na + i]);
+                maxB = util::max(maxB, util::abs(values[na + i]));
+            }
+            double *out = result->view().data;
+            const bool success = fft::convolve(values, na, values + na, nb, out);
+            delete[] values;
+            if (!success) {
+                delete result;
+                return new Numerical(NAN);
+            }
+            // The rounding errors are much smaller than 1/2 as long as the results are not too large,
+            // so integer sequences can have their exact convolution recovered
+            if (integers && maxA * maxB * util::min(na, nb) < 1e12) {
+                for (uint16_t i = 0; i < len; i++) {
+                    out[i] = round(out[i]);
                 }
-                avg += (static_cast<Numerical *>(args[i])->value - avg) / (i + 1);
             }
-            return new Numerical(avg);
-        }
-        case Type::RAND: {
-            return new Numerical(static_cast<double>(rand()) / RAND_MAX);
+            return result;
         }
         default:
             return new Numerical(NAN);
@@ -1059,12 +3158,58 @@ namespace eval {
                 cont->add(new neda::Fraction(num, denom));
             }
         }
+        else if (t->getType() == TokenType::POLYNOMIAL) {
+            // Written out in descending order of power, e.g. 2x^2-x+1
+            const Polynomial *p = static_cast<Polynomial *>(t);
+            bool first = true;
+            char buf[64];
+            for (uint16_t i = p->count; i-- > 0;) {
+                const double c = p->coeffs[i];
+                // Skip terms that are 0, unless the whole polynomial is 0
+                if (c == 0 && (i != 0 || !first)) {
+                    continue;
+                }
+                if (c < 0) {
+                    cont->add(new neda::Character('-'));
+                }
+                else if (!first) {
+                    cont->add(new neda::Character('+'));
+                }
+                first = false;
+                // Coefficients of 1 are left out
+                if (i == 0 || fabs(c) != 1) {
+                    util::ftoa(fabs(c), buf, significantDigits, LCD_CHAR_EE);
+                    cont->addString(buf);
+                }
+                if (i > 0) {
+                    cont->add(new neda::Character('x'));
+                }
+                if (i > 1) {
+                    neda::Container *exponent = new neda::Container();
+                    util::dtoa(i, buf);
+                    exponent->addString(buf);
+                    cont->add(new neda::Superscript(exponent));
+                }
+            }
+        }
         else {
             Matrix *mat = static_cast<Matrix *>(t);
+            // Matrices too big for the editor are only shown by their size
+            if (mat->m > 0xFF || mat->n > 0xFF) {
+                char buf[8];
+                cont->add(new neda::Character('['));
+                util::dtoa(mat->m, buf);
+                cont->addString(buf);
+                cont->add(new neda::Character(LCD_CHAR_MUL));
+                util::dtoa(mat->n, buf);
+                cont->addString(buf);
+                cont->add(new neda::Character(']'));
+                return;
+            }
             neda::Matrix *nMat = new neda::Matrix(mat->m, mat->n);
 
-            for (uint8_t i = 0; i < mat->m; i++) {
-                for (uint8_t j = 0; j < mat->n; j++) {
+            for (uint16_t i = 0; i < mat->m; i++) {
+                for (uint16_t j = 0; j < mat->n; j++) {
                     neda::Container *c = new neda::Container();
                     Numerical n(mat->getEntry(i, j));
 
@@ -1073,17 +3218,20 @@ namespace eval {
                     nMat->setEntry(i, j, c);
                 }
             }
-            nMat->computeDimensions();
             cont->add(nMat);
         }
     }
     Token *copyToken(Token *t) {
+        // Matrix copies share the entries of the original (see MatrixBuffer), so this is cheap even for large matrices
         if (t->getType() == TokenType::NUMERICAL) {
             return new Numerical(static_cast<Numerical *>(t)->value);
         }
         else if (t->getType() == TokenType::MATRIX) {
             return new Matrix(*static_cast<Matrix *>(t));
         }
+        else if (t->getType() == TokenType::POLYNOMIAL) {
+            return new Polynomial(*static_cast<Polynomial *>(t));
+        }
         else if (t->getType() == TokenType::FUNCTION) {
             return new Function(static_cast<Function *>(t)->type);
         }
@@ -1180,17 +3328,19 @@ namespace eval {
     /*
      * Tests to see if a value is "truthy".
      *
-     * "Truthy" values are nonzero numbers or fractions, or any matrix/vector.
+     * "Truthy" values are nonzero numbers or fractions, or any matrix/vector or polynomial.
      * NaNs and infinities are undefined.
      *
      * Returns 1 if truthy, 0 if not, -1 if undefined.
      */
     int8_t isTruthy(const Token *token) {
-        if (token->getType() == TokenType::MATRIX) {
+        if (token->getType() == TokenType::MATRIX || token->getType() == TokenType::POLYNOMIAL) {
             return 1;
         }
-
-        double v = static_cast<const Numerical *>(token)->value.asDouble();
+        return isTruthy(static_cast<const Numerical *>(token)->value);
+    }
+    int8_t isTruthy(const util::Numerical &value) {
+        double v = value.asDouble();
 
         // Infinite or NaN
         if (!isfinite(v)) {
@@ -1235,6 +3385,17 @@ namespace eval {
         }
         return end;
     }
+    // Finds the end of a unit, which can be several units separated by multiplication and division signs (e.g. km/h)
+    uint16_t findUnitEnd(const util::DynamicArray<neda::NEDAObj *> &arr, uint16_t start) {
+        uint16_t end = start;
+        for (; end < arr.length(); end++) {
+            char ch = extractChar(arr[end]);
+            if (!isNameChar(ch) && !isDigit(ch) && ch != LCD_CHAR_MUL && ch != LCD_CHAR_DIV && ch != '*' && ch != '/') {
+                break;
+            }
+        }
+        return end;
+    }
     /*
      * Evaluates a function arguments list, which starts with a left bracket, ends with a right bracket and is separated
      * by commas.
@@ -1356,6 +3517,49 @@ namespace eval {
         return result;
     }
     
+    /*
+     * Evaluates a polynomial called like a function, e.g. p(2).
+     * Numbers and every entry of a matrix are substituted into the polynomial, and a polynomial argument gives the
+     * composition. argStart and endOut are the same as for evaluateArgs().
+     */
+    Token *callPolynomial(const Polynomial &p, const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env,
+            uint16_t argStart, uint16_t &endOut) {
+        bool err = false;
+        auto args = evaluateArgs(expr, env, argStart, endOut, err);
+        if (err || args.length() != 1) {
+            freeTokens(args);
+            return nullptr;
+        }
+        Token *arg = args[0];
+        Token *result;
+        if (arg->getType() == TokenType::NUMERICAL) {
+            result = new Numerical(p(static_cast<Numerical *>(arg)->value.asDouble()));
+        }
+        else if (arg->getType() == TokenType::MATRIX) {
+            const Matrix *mat = static_cast<Matrix *>(arg);
+            Matrix *values = new Matrix(mat->m, mat->n);
+            const matkern::View v = values->view();
+            for (uint16_t i = 0; i < mat->m; i++) {
+                for (uint16_t j = 0; j < mat->n; j++) {
+                    v(i, j) = p(mat->getEntry(i, j).asDouble());
+                }
+            }
+            result = values;
+        }
+        else {
+            // Horner's scheme with polynomial arithmetic
+            result = new Numerical(p.coeffs[p.count - 1]);
+            for (uint16_t i = p.count - 1; i-- > 0 && result;) {
+                result = applyPolynomial(Operator::Type::MULTIPLY, result, copyToken(arg));
+                if (result) {
+                    result = applyPolynomial(Operator::Type::PLUS, result, new Numerical(p.coeffs[i]));
+                }
+            }
+        }
+        freeTokens(args);
+        return result;
+    }
+
     Token *logSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
         if(start + 1 < expr.length()) {
             // Custom base
@@ -1417,36 +3621,169 @@ namespace eval {
         }
     }
 
-    Token *linRegSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
-        if(start + 1 >= expr.length() || expr[start]->getType() != neda::ObjType::L_BRACKET) {
-            return nullptr;
+    /*
+     * Checks whether a name in a linReg model term is x, a constant, a number variable or a scalar function.
+     */
+    bool isElementwiseSafeName(const util::DynamicArray<neda::NEDAObj *> &expr, uint16_t start, uint16_t end,
+            const Environment &env) {
+        char *str = new char[end - start + 1];
+        for (uint16_t i = start; i < end; i++) {
+            str[i - start] = extractChar(expr[i]);
         }
+        str[end - start] = '\0';
 
-        uint16_t nesting = 0;
-        uint16_t argStart = start + 1;
-        util::DynamicArray<Token *> args;
-        util::DynamicArray<uint32_t> model;
-        for(endOut = start; endOut < expr.length(); endOut ++) {
-            // left bracket - increase nesting
-            if(expr[endOut]->getType() == neda::ObjType::L_BRACKET) {
-                ++nesting;
+        bool safe = false;
+        // Functions are looked up first, the same as in evaluate()
+        const Function *func = Function::fromString(str);
+        if (func) {
+            safe = func->isScalar();
+            delete func;
+        }
+        else if (strcmp(str, "x") == 0) {
+            safe = true;
+        }
+        else {
+            const Numerical *n = Numerical::constFromString(str);
+            if (n) {
+                safe = true;
+                delete n;
             }
-            // right bracket - decrease nesting
-            else if(expr[endOut]->getType() == neda::ObjType::R_BRACKET) {
-                --nesting;
-                // All brackets finished
-                if(!nesting) {
-                    // Try evaluating the last argument
-                    if(args.length() < 2) {
-                        Token *result = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + argStart, expr.begin() + endOut),
-                                env);
-                        if(!result) {
-                            freeTokens(args);
-                            return nullptr;
-                        }
-
-                        args.add(result);
-                    }
+            else {
+                const Variable *found = nullptr;
+                for (const auto &var : env.args) {
+                    if (strcmp(str, var.name) == 0) {
+                        found = &var;
+                        break;
+                    }
+                }
+                if (!found) {
+                    for (const auto &var : env.vars) {
+                        if (strcmp(str, var.name) == 0) {
+                            found = &var;
+                            break;
+                        }
+                    }
+                }
+                safe = found && found->value->getType() == TokenType::NUMERICAL;
+            }
+        }
+        delete[] str;
+        return safe;
+    }
+    /*
+     * Checks whether a linReg model term gives the same result when it is evaluated elementwise with x bound to all
+     * the data points, as when it is evaluated separately for each data point.
+     *
+     * Only arithmetic, fractions, powers, radicals, constants, number variables and scalar functions are allowed.
+     * Anything else has to be evaluated per data point; e.g. the absolute value of a matrix is its norm, and piecewise
+     * functions test whether the whole matrix is truthy.
+     */
+    bool isElementwiseSafe(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env) {
+        for (uint16_t index = 0; index < expr.length();) {
+            switch (expr[index]->getType()) {
+            case neda::ObjType::L_BRACKET:
+            case neda::ObjType::R_BRACKET:
+                ++index;
+                break;
+
+            case neda::ObjType::FRACTION: {
+                const neda::Fraction *frac = static_cast<neda::Fraction *>(expr[index]);
+                if (!isElementwiseSafe(static_cast<neda::Container *>(frac->numerator)->contents, env) ||
+                        !isElementwiseSafe(static_cast<neda::Container *>(frac->denominator)->contents, env)) {
+                    return false;
+                }
+                ++index;
+                break;
+            }
+
+            case neda::ObjType::SUPERSCRIPT: {
+                const auto &c =
+                        static_cast<neda::Container *>(static_cast<neda::Superscript *>(expr[index])->contents)->contents;
+                // After a matrix these are a transpose and an inverse
+                if ((c.length() == 1 && extractChar(c[0]) == 'T') ||
+                        (c.length() == 2 && extractChar(c[0]) == '-' && extractChar(c[1]) == '1')) {
+                    return false;
+                }
+                if (!isElementwiseSafe(c, env)) {
+                    return false;
+                }
+                ++index;
+                break;
+            }
+
+            case neda::ObjType::RADICAL: {
+                const neda::Radical *radical = static_cast<neda::Radical *>(expr[index]);
+                if ((radical->n && !isElementwiseSafe(static_cast<neda::Container *>(radical->n)->contents, env)) ||
+                        !isElementwiseSafe(static_cast<neda::Container *>(radical->contents)->contents, env)) {
+                    return false;
+                }
+                ++index;
+                break;
+            }
+
+            case neda::ObjType::CHAR_TYPE: {
+                const char ch = extractChar(expr[index]);
+                if (ch == ' ' || ch == ',' || ch == '+' || ch == '-' || ch == '*' || ch == '/' || ch == '^' ||
+                        ch == LCD_CHAR_MUL || ch == LCD_CHAR_DIV) {
+                    ++index;
+                    break;
+                }
+                if (!isNameChar(ch) && !isDigit(ch)) {
+                    return false;
+                }
+                bool isNum;
+                const uint16_t end = findTokenEnd(expr, index, 1, isNum);
+                if (!isNum && !isElementwiseSafeName(expr, index, end, env)) {
+                    return false;
+                }
+                index = end;
+                break;
+            }
+
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /*
+     * linReg(x, y, model...) fits y to a linear combination of the model terms, which are expressions in x.
+     * The result is the column vector of coefficients, in the order of the model terms. It is exact if the data and
+     * the model terms are.
+     * linRegStats(x, y, model...) does the same fit and gives the residual sum of squares and R^2 instead.
+     */
+    Token *linearRegression(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start,
+            uint16_t &endOut, bool stats) {
+        if(start + 1 >= expr.length() || expr[start]->getType() != neda::ObjType::L_BRACKET) {
+            return nullptr;
+        }
+
+        uint16_t nesting = 0;
+        uint16_t argStart = start + 1;
+        util::DynamicArray<Token *> args;
+        util::DynamicArray<uint32_t> model;
+        for(endOut = start; endOut < expr.length(); endOut ++) {
+            // left bracket - increase nesting
+            if(expr[endOut]->getType() == neda::ObjType::L_BRACKET) {
+                ++nesting;
+            }
+            // right bracket - decrease nesting
+            else if(expr[endOut]->getType() == neda::ObjType::R_BRACKET) {
+                --nesting;
+                // All brackets finished
+                if(!nesting) {
+                    // Try evaluating the last argument
+                    if(args.length() < 2) {
+                        Token *result = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + argStart, expr.begin() + endOut),
+                                env);
+                        if(!result) {
+                            freeTokens(args);
+                            return nullptr;
+                        }
+
+                        args.add(result);
+                    }
                     else {
                         // put into model
                         model.add(argStart << 16 | endOut);
@@ -1482,8 +3819,7 @@ namespace eval {
         if(nesting != 0 || args.length() != 2 || model.length() == 0 
                 || args[0]->getType() != TokenType::MATRIX || args[1]->getType() != TokenType::MATRIX
                 || static_cast<Matrix *>(args[0])->n != 1 || static_cast<Matrix *>(args[1])->n != 1
-                || static_cast<Matrix *>(args[0])->m != static_cast<Matrix *>(args[1])->m
-                || static_cast<Matrix *>(args[0])->m > 0xFF || model.length() > 0xFF) {
+                || static_cast<Matrix *>(args[0])->m != static_cast<Matrix *>(args[1])->m) {
             freeTokens(args);
             return nullptr;
         }
@@ -1491,215 +3827,870 @@ namespace eval {
         Matrix *x = static_cast<Matrix *>(args[0]);
         Matrix *y = static_cast<Matrix *>(args[1]);
 
-        Matrix a(x->m, model.length());
+        const uint16_t rows = x->m;
+        Matrix a(rows, model.length());
 
+        // Evaluate each model term only once for all the data points where possible, by binding x to the entire
+        // vector and evaluating elementwise
+        env.args.insert(Variable("x", x), 0);
         Numerical xn(0);
-        env.args.add(Variable("x", &xn));
+        const bool prevElementwise = elementwise;
+        for(uint16_t col = 0; col < model.length(); col ++) {
+            const util::DynamicArray<neda::NEDAObj *> term = util::DynamicArray<neda::NEDAObj *>::createConstRef(
+                    expr.begin() + (model[col] >> 16), expr.begin() + (model[col] & 0xFFFF));
+            if(isElementwiseSafe(term, env)) {
+                elementwise = true;
+                Token *t = evaluate(term, env);
+                elementwise = prevElementwise;
+
+                // Terms that don't depend on x (e.g. 1) don't give a matrix, so they are evaluated per data point too
+                if(t && t->getType() == TokenType::MATRIX && static_cast<Matrix *>(t)->m == rows
+                        && static_cast<Matrix *>(t)->n == 1) {
+                    for(uint16_t row = 0; row < rows; row ++) {
+                        a.setEntry(row, col, (*static_cast<Matrix *>(t))[row]);
+                    }
+                    delete t;
+                    continue;
+                }
+                delete t;
+            }
+
+            // Everything else has to be evaluated separately for every data point
+            env.args[0].value = &xn;
+            for(uint16_t row = 0; row < rows; row ++) {
+                xn.value = (*x)[row];
+                Token *t = evaluate(term, env);
+
+                if(!t || t->getType() != TokenType::NUMERICAL) {
+                    delete t;
+                    env.args.removeAt(0);
+                    freeTokens(args);
+                    return nullptr;
+                }
+
+                a.setEntry(row, col, static_cast<Numerical *>(t)->value);
+                delete t;
+            }
+            env.args[0].value = x;
+        }
+        env.args.removeAt(0);
+
+        if(!stats) {
+            // This keeps exact data exact, and uses QR for floating-point data since polynomial models are often
+            // ill-conditioned
+            Token *result = Matrix::leastSquares(a, *y);
+            freeTokens(args);
+            return result ? result : new Numerical(NAN);
+        }
+
+        double rss;
+        Matrix *coefficients = Matrix::leastSquaresQR(a, *y, &rss);
+        if(!coefficients) {
+            freeTokens(args);
+            return new Numerical(NAN);
+        }
+        delete coefficients;
+        // The total sum of squares is needed for R^2
+        double mean = 0;
+        for(uint16_t row = 0; row < rows; row ++) {
+            mean += (*y)[row].asDouble();
+        }
+        mean /= rows;
+        double tss = 0;
+        for(uint16_t row = 0; row < rows; row ++) {
+            double deviation = (*y)[row].asDouble() - mean;
+            tss += deviation * deviation;
+        }
+
+        Matrix *result = new Matrix(2, 1);
+        result->set(0, rss);
+        result->set(1, 1 - rss / tss);
+        freeTokens(args);
+        return result;
+    }
+    Token *linRegSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
+        return linearRegression(expr, env, start, endOut, false);
+    }
+    Token *linRegStatsSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
+        return linearRegression(expr, env, start, endOut, true);
+    }
+
+    constexpr uint16_t BISECTION_MAX_ITERATIONS = 255;
+
+    Token *solveSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
+        if(start + 1 >= expr.length() || expr[start]->getType() != neda::ObjType::L_BRACKET) {
+            return nullptr;
+        }
+
+        uint16_t nesting = 0;
+        uint16_t argStart = start + 1;
+        uint16_t argn = 0;
+        
+        uint16_t eqnEnd;
+        // Since this is a numerical solver anyways keeping fractions is not a concern
+        double min = 0, max = 0, err = 0;
+
+        for(endOut = start; endOut < expr.length(); endOut ++) {
+            // left bracket - increase nesting
+            if(expr[endOut]->getType() == neda::ObjType::L_BRACKET) {
+                ++nesting;
+            }
+            // right bracket - decrease nesting
+            else if(expr[endOut]->getType() == neda::ObjType::R_BRACKET) {
+                --nesting;
+                // All brackets finished
+                if(!nesting) {
+                    // Try evaluating the last argument
+                    if(argn > 3) {
+                        // Too many arguments!
+                        return nullptr;
+                    }
+                    
+                    // Save the equation if it's the first arg
+                    if(argn == 0) {
+                        eqnEnd = endOut;
+                    }
+                    // Try evaluate
+                    else {
+                        Token *result = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + argStart, expr.begin() + endOut), env);
+                        /// Syntax error or non-number
+                        if(!result || !result->getType() == TokenType::NUMERICAL) {
+                            delete result;
+                            return nullptr;
+                        }
+                        (argn == 1 ? min : (argn == 2 ? max : err)) = static_cast<Numerical *>(result)->value.asDouble();
+                        delete result;
+                    }
+                    argn ++;
+                    break;
+                }
+            }
+            // comma - handle arguments
+            // Only do this if nesting level is 1, so commas inside inner brackets are not counted by mistake
+            else if(expr[endOut]->getType() == neda::ObjType::CHAR_TYPE && extractChar(expr[endOut]) == ',' && nesting == 1) {
+                if(argn > 3) {
+                    // Too many arguments!
+                    return nullptr;
+                }
+                
+                // Save the equation if it's the first arg
+                if(argn == 0) {
+                    eqnEnd = endOut;
+                }
+                // Try evaluate
+                else {
+                    Token *result = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + argStart, expr.begin() + endOut), env);
+                    /// Syntax error or non-number
+                    if(!result || !result->getType() == TokenType::NUMERICAL) {
+                        delete result;
+                        return nullptr;
+                    }
+                    (argn == 1 ? min : (argn == 2 ? max : err)) = static_cast<Numerical *>(result)->value.asDouble();
+                    delete result;
+                }
+                argn ++;
+                // Skip the comma
+                argStart = endOut + 1;
+            }
+        }
+        ++endOut;
+
+        // Wrong bounds or wrong number of args
+        // Note 3 arguments is also acceptable, in which case the accepted error is 0
+        if(argn < 3 || max < min) {
+            return nullptr;
+        }
+
+        // Set up equation
+        const util::DynamicArray<neda::NEDAObj *> eqn = util::DynamicArray<neda::NEDAObj *>::createConstRef(
+                expr.begin() + start + 1, expr.begin() + eqnEnd);
+        Numerical arg(min);
+        Variable varg("x", &arg);
+        env.args.insert(varg, 0);
+
+        // Evaluate on bounds of interval
+        Token *t = evaluate(eqn, env);
+        double minVal;
+        if(!t || t->getType() != TokenType::NUMERICAL) {
+            delete t;
+            return nullptr;
+        }
+        minVal = static_cast<Numerical *>(t)->value.asDouble();
+        delete t;
+
+        arg.value = max;
+        t = evaluate(eqn, env);
+        double maxVal;
+        if(!t || t->getType() != TokenType::NUMERICAL) {
+            delete t;
+            return nullptr;
+        }
+        maxVal = static_cast<Numerical *>(t)->value.asDouble();
+        delete t;
+
+        // Test for zeros
+        if(minVal == 0) {
+            env.args.removeAt(0);
+            return new Numerical(minVal);
+        }
+        if(maxVal == 0) {
+            env.args.removeAt(0);
+            return new Numerical(maxVal);
+        }
+        // Test for same sign or infinite or NaN
+        if((minVal > 0 && maxVal > 0) || (minVal < 0 && maxVal < 0) || !isfinite(minVal) || !isfinite(maxVal) || err < 0) {
+            env.args.removeAt(0);
+            return new Numerical(NAN);
+        }
+
+        // Start bisection
+        for(uint16_t iterations = 0; iterations < BISECTION_MAX_ITERATIONS; iterations ++) {
+            double x = min + (max - min) / 2;
+            // Evaluate on middle
+            arg.value = x;
+            t = evaluate(eqn, env);
+            if(!t || t->getType() != TokenType::NUMERICAL) {
+                delete t;
+                return nullptr;
+            }
+            double val = static_cast<Numerical *>(t)->value.asDouble();
+            delete t;
+            // Value within range
+            if(util::abs(val) <= err) {
+                env.args.removeAt(0);
+                return new Numerical(x);
+            }
+
+            // Iterate again
+            if((minVal < 0 && val > 0) || (minVal > 0 && val < 0)) {
+                max = x;
+                maxVal = val;
+            }
+            else {
+                min = x;
+                minVal = val;
+            }
+        }
+
+        return new Numerical(min + (max - min) / 2);
+
+        env.args.removeAt(0);
+    }
+
+    /*
+     * Splits the arguments of a special expression whose first argument is an expression to be evaluated repeatedly
+     * by a numerical solver (e.g. ode()). The other arguments are evaluated and added to args, and the first one is
+     * only located, with its end written to eqnEnd. start and endOut are the same as for the special expression.
+     * Returns false on a syntax error, in which case args is left empty.
+     */
+    bool evaluateSolverArgs(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start,
+            uint16_t &endOut, uint16_t &eqnEnd, util::DynamicArray<Token *> &args) {
+        if(start + 1 >= expr.length() || expr[start]->getType() != neda::ObjType::L_BRACKET) {
+            return false;
+        }
+
+        uint16_t nesting = 0;
+        uint16_t argStart = start + 1;
+        eqnEnd = 0;
+        for(endOut = start; endOut < expr.length(); endOut ++) {
+            const bool rBracket = expr[endOut]->getType() == neda::ObjType::R_BRACKET;
+            // left bracket - increase nesting
+            if(expr[endOut]->getType() == neda::ObjType::L_BRACKET) {
+                ++nesting;
+                continue;
+            }
+            // right bracket - decrease nesting
+            if(rBracket) {
+                --nesting;
+            }
+            // Arguments end at commas at nesting level 1 or at the last bracket
+            if((rBracket && !nesting) || (nesting == 1 && expr[endOut]->getType() == neda::ObjType::CHAR_TYPE
+                    && extractChar(expr[endOut]) == ',')) {
+                // The equation is only saved, since it has to be evaluated with the solver's variables
+                if(!eqnEnd) {
+                    eqnEnd = endOut;
+                }
+                else {
+                    Token *result = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + argStart, expr.begin() + endOut),
+                            env);
+                    if(!result) {
+                        freeTokens(args);
+                        args.empty();
+                        return false;
+                    }
+                    args.add(result);
+                }
+                // Skip the comma
+                argStart = endOut + 1;
+                if(!nesting) {
+                    break;
+                }
+            }
+        }
+        ++endOut;
+
+        if(nesting != 0) {
+            freeTokens(args);
+            args.empty();
+            return false;
+        }
+        return true;
+    }
 
-        for(uint8_t row = 0; row < x->m; row ++) {
-            for(uint8_t col = 0; col < model.length(); col ++) {
-                xn.value = x->contents[row];
-                Token *t = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + (model[col] >> 16), 
-                        expr.begin() + (model[col] & 0xFFFF)), env);
+    /*
+     * An expression that is evaluated repeatedly by a numerical solver, with a variable bound to the solver's state.
+     * The variable is a number for a single unknown, and a matrix the same shape as the initial value otherwise. Its
+     * entries are stored as packed doubles so that they can be written directly before each evaluation.
+     */
+    class BoundExpression {
+    public:
+        BoundExpression(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, const char *name,
+                const Token *initial) : expr(expr), env(env) {
+            if(initial->getType() == TokenType::MATRIX) {
+                var = new Matrix(static_cast<const Matrix *>(initial)->m, static_cast<const Matrix *>(initial)->n);
+            }
+            else {
+                var = new Numerical(0);
+            }
+            env.args.insert(Variable(name, var), 0);
+        }
+        ~BoundExpression() {
+            env.args.removeAt(0);
+            delete var;
+        }
+
+        // The number of entries in the variable
+        inline uint16_t size() const {
+            return var->getType() == TokenType::MATRIX ? static_cast<Matrix *>(var)->size() : 1;
+        }
+
+        // Copies the entries of a token with the same shape as the variable (e.g. the initial value) into x
+        void read(const Token *t, double *x) const {
+            if(t->getType() == TokenType::MATRIX) {
+                for(uint16_t i = 0; i < size(); i ++) {
+                    x[i] = (*static_cast<const Matrix *>(t))[i].asDouble();
+                }
+            }
+            else {
+                x[0] = static_cast<const Numerical *>(t)->value.asDouble();
+            }
+        }
+        // Creates a token with the same shape as the variable, with entries from x
+        Token *make(const double *x) const {
+            if(var->getType() == TokenType::MATRIX) {
+                const Matrix *mat = static_cast<Matrix *>(var);
+                Matrix *result = new Matrix(mat->m, mat->n);
+                const matkern::View v = result->view();
+                for(uint16_t i = 0; i < mat->size(); i ++) {
+                    v(i / mat->n, i % mat->n) = x[i];
+                }
+                return result;
+            }
+            return new Numerical(x[0]);
+        }
+
+        /*
+         * Evaluates the expression with the variable set to x, writing its n entries to out. A number counts as a
+         * single entry, and matrices can have any shape as long as the number of entries is right.
+         * Returns false if the expression can't be evaluated or has the wrong size.
+         */
+        bool operator()(const double *x, double *out, uint16_t n) {
+            if(var->getType() == TokenType::MATRIX) {
+                Matrix *mat = static_cast<Matrix *>(var);
+                // The copies made while evaluating were freed afterwards, so this shouldn't need to copy anything
+                mat->makeWritable();
+                const matkern::View v = mat->view();
+                for(uint16_t i = 0; i < mat->size(); i ++) {
+                    v(i / mat->n, i % mat->n) = x[i];
+                }
+                mat->setStructure(Matrix::Structure::UNKNOWN);
+            }
+            else {
+                static_cast<Numerical *>(var)->value = x[0];
+            }
+
+            Token *result = evaluate(expr, env);
+            if(!result) {
+                return false;
+            }
+            bool ok = true;
+            if(result->getType() == TokenType::NUMERICAL && n == 1) {
+                out[0] = static_cast<Numerical *>(result)->value.asDouble();
+            }
+            else if(result->getType() == TokenType::MATRIX && static_cast<Matrix *>(result)->size() == n) {
+                const Matrix *mat = static_cast<Matrix *>(result);
+                for(uint16_t i = 0; i < n; i ++) {
+                    out[i] = (*mat)[i].asDouble();
+                }
+            }
+            else {
+                ok = false;
+            }
+            delete result;
+            return ok;
+        }
+
+    protected:
+        const util::DynamicArray<neda::NEDAObj *> &expr;
+        const Environment &env;
+        Token *var;
+    };
+
+    /*
+     * The right-hand side of an ode() call, evaluated with t and y bound as arguments.
+     * It must give a result with as many entries as y.
+     */
+    class ExpressionSystem : public ode::System {
+    public:
+        ExpressionSystem(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, const Token *y0)
+                : y(expr, env, "y", y0), env(env), t(0) {
+            env.args.insert(Variable("t", &t), 0);
+        }
+        ~ExpressionSystem() {
+            env.args.removeAt(0);
+        }
+
+        virtual bool operator()(double tVal, const double *yVal, double *dydt) override {
+            t.value = tVal;
+            return y(yVal, dydt, y.size());
+        }
+
+        BoundExpression y;
+
+    protected:
+        const Environment &env;
+        Numerical t;
+    };
+
+    constexpr double ODE_DEFAULT_TOLERANCE = 1e-6;
+
+    /*
+     * ode(f, t0, y0, t1[, tol]) solves y' = f(t, y), y(t0) = y0.
+     * If t1 is a number, the result is y(t1). If t1 is a vector of times, the result is the trajectory, with one row
+     * [t, y] for each time, which can be graphed as-is.
+     */
+    Token *odeSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
+        uint16_t eqnEnd;
+        util::DynamicArray<Token *> args;
+        if(!evaluateSolverArgs(expr, env, start, endOut, eqnEnd, args)) {
+            return nullptr;
+        }
+
+        // Handle errors: t0 and tol must be numbers, y0 a number or a matrix, and t1 a number or a vector
+        if(args.length() < 3 || args.length() > 4 || args[0]->getType() != TokenType::NUMERICAL
+                || (args[2]->getType() == TokenType::MATRIX && static_cast<Matrix *>(args[2])->m != 1
+                        && static_cast<Matrix *>(args[2])->n != 1)
+                || (args.length() == 4 && args[3]->getType() != TokenType::NUMERICAL)
+                || (args[1]->getType() != TokenType::NUMERICAL && args[1]->getType() != TokenType::MATRIX)
+                || (args[2]->getType() != TokenType::NUMERICAL && args[2]->getType() != TokenType::MATRIX)) {
+            freeTokens(args);
+            return nullptr;
+        }
+
+        double t = static_cast<Numerical *>(args[0])->value.asDouble();
+        const double tol = args.length() == 4 ? static_cast<Numerical *>(args[3])->value.asDouble() : ODE_DEFAULT_TOLERANCE;
+        const Matrix *times = args[2]->getType() == TokenType::MATRIX ? static_cast<Matrix *>(args[2]) : nullptr;
+        const uint16_t timeCount = times ? times->size() : 1;
+
+        const util::DynamicArray<neda::NEDAObj *> eqn = util::DynamicArray<neda::NEDAObj *>::createConstRef(
+                expr.begin() + start + 1, expr.begin() + eqnEnd);
+        ExpressionSystem f(eqn, env, args[1]);
+        const uint16_t n = f.y.size();
+        double *y = new (std::nothrow) double[n];
+        if(!y) {
+            freeTokens(args);
+            return new Numerical(NAN);
+        }
+        f.y.read(args[1], y);
+
+        Matrix *trajectory = times ? new Matrix(timeCount, n + 1) : nullptr;
+        // Invalid tolerances and times are math errors, as are problems the solver can't handle (e.g. the solution
+        // blowing up), but a right-hand side that can't be evaluated is a syntax error
+        bool valid = tol > 0 && isfinite(t);
+        ode::Status status = ode::Status::OK;
+        // The step size carries over from one output time to the next
+        double h = 0;
+        for(uint16_t i = 0; i < timeCount && valid && status == ode::Status::OK; i ++) {
+            const double tEnd = times ? (*times)[i].asDouble() : static_cast<Numerical *>(args[2])->value.asDouble();
+            valid = isfinite(tEnd);
+            status = ode::integrate(f, n, t, valid ? tEnd : t, y, tol, h);
+            if(trajectory) {
+                const matkern::View v = trajectory->view();
+                v(i, 0) = tEnd;
+                for(uint16_t j = 0; j < n; j ++) {
+                    v(i, j + 1) = y[j];
+                }
+            }
+        }
+
+        Token *result;
+        if(status == ode::Status::ERROR) {
+            delete trajectory;
+            result = nullptr;
+        }
+        else if(!valid || status != ode::Status::OK) {
+            delete trajectory;
+            result = new Numerical(NAN);
+        }
+        else if(trajectory) {
+            result = trajectory;
+        }
+        else {
+            result = f.y.make(y);
+        }
+        delete[] y;
+        freeTokens(args);
+        return result;
+    }
+
+    /*
+     * The objective of an fmin() or fmax() call, evaluated with x bound as an argument.
+     * Maximization minimizes -f instead.
+     */
+    class ExpressionObjective : public optim::Objective {
+    public:
+        ExpressionObjective(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, const Token *x0,
+                bool maximize) : x(expr, env, "x", x0), maximize(maximize) {
+        }
+
+        virtual bool operator()(const double *xVal, double &fx) override {
+            if(!x(xVal, &fx, 1)) {
+                return false;
+            }
+            if(maximize) {
+                fx = -fx;
+            }
+            return true;
+        }
+
+        BoundExpression x;
+
+    protected:
+        bool maximize;
+    };
+
+    constexpr double NELDER_MEAD_DEFAULT_TOLERANCE = 1e-6;
+
+    /*
+     * fmin(f, a, b[, tol]) and fmax(f, a, b[, tol]) find an extremum of f(x) for x in [a, b].
+     * fmin(f, x0[, tol]) and fmax(f, x0[, tol]) find one near x0, which can be a vector for functions of several
+     * variables.
+     * The result is a column vector of x, f(x) and the number of times f was evaluated.
+     */
+    Token *optimize(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut,
+            bool maximize) {
+        uint16_t eqnEnd;
+        util::DynamicArray<Token *> args;
+        if(!evaluateSolverArgs(expr, env, start, endOut, eqnEnd, args)) {
+            return nullptr;
+        }
+        // The interval form takes two numbers for the bounds, while a starting point can also be a matrix
+        const bool interval = args.length() >= 2 && args[0]->getType() == TokenType::NUMERICAL
+                && args[1]->getType() == TokenType::NUMERICAL;
+        const uint16_t tolIndex = interval ? 2 : 1;
+        if(args.length() < 1 || args.length() > tolIndex + 1
+                || (args[0]->getType() != TokenType::NUMERICAL && args[0]->getType() != TokenType::MATRIX)
+                || (args.length() == tolIndex + 1 && args[tolIndex]->getType() != TokenType::NUMERICAL)) {
+            freeTokens(args);
+            return nullptr;
+        }
+
+        const util::DynamicArray<neda::NEDAObj *> eqn = util::DynamicArray<neda::NEDAObj *>::createConstRef(
+                expr.begin() + start + 1, expr.begin() + eqnEnd);
+        ExpressionObjective f(eqn, env, args[0], maximize);
+        const uint16_t n = f.x.size();
+        double *x = new (std::nothrow) double[n];
+        if(!x) {
+            freeTokens(args);
+            return new Numerical(NAN);
+        }
 
-                if(!t || t->getType() != TokenType::NUMERICAL) {
-                    freeTokens(args);
-                    return nullptr;
-                }
+        double fx = NAN;
+        uint16_t evaluations = 0;
+        optim::Status status;
+        if(interval) {
+            const double tol = args.length() == 3 ? static_cast<Numerical *>(args[2])->value.asDouble()
+                    : optim::BRENT_DEFAULT_TOLERANCE;
+            const double a = static_cast<Numerical *>(args[0])->value.asDouble();
+            const double b = static_cast<Numerical *>(args[1])->value.asDouble();
+            status = tol > 0 && isfinite(a) && isfinite(b) ? optim::brent(f, a, b, tol, x[0], fx, evaluations)
+                    : optim::Status::NOT_CONVERGED;
+        }
+        else {
+            const double tol = args.length() == 2 ? static_cast<Numerical *>(args[1])->value.asDouble()
+                    : NELDER_MEAD_DEFAULT_TOLERANCE;
+            f.x.read(args[0], x);
+            status = tol > 0 ? optim::nelderMead(f, n, x, tol, fx, evaluations) : optim::Status::NOT_CONVERGED;
+        }
 
-                a.setEntry(row, col, static_cast<Numerical *>(t)->value);
-                delete t;
+        Token *result;
+        if(status == optim::Status::ERROR) {
+            result = nullptr;
+        }
+        else if(status != optim::Status::OK || !isfinite(fx)) {
+            result = new Numerical(NAN);
+        }
+        else {
+            Matrix *mat = new Matrix(n + 2, 1);
+            const matkern::View v = mat->view();
+            for(uint16_t i = 0; i < n; i ++) {
+                v(i, 0) = x[i];
             }
+            v(n, 0) = maximize ? -fx : fx;
+            v(n + 1, 0) = evaluations;
+            result = mat;
         }
-
-        env.args.removeAt(0);
-        Token *result = Matrix::leastSquares(a, *y);
+        delete[] x;
         freeTokens(args);
-        return result ? result : new Numerical(NAN);
+        return result;
     }
 
-    constexpr uint16_t BISECTION_MAX_ITERATIONS = 255;
+    Token *fminSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
+        return optimize(expr, env, start, endOut, false);
+    }
+    Token *fmaxSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
+        return optimize(expr, env, start, endOut, true);
+    }
 
-    Token *solveSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
-        if(start + 1 >= expr.length() || expr[start]->getType() != neda::ObjType::L_BRACKET) {
-            return nullptr;
+    constexpr double NSOLVE_DEFAULT_TOLERANCE = 1e-10;
+    constexpr uint8_t NSOLVE_MAX_ITERATIONS = 100;
+    // The most times the Newton step is halved before giving up on it
+    constexpr uint8_t NSOLVE_MAX_BACKTRACKS = 10;
+
+    // The Euclidean norm, with NaN treated as infinity so that it never looks like an improvement
+    double residualNorm(const double *f, uint16_t n) {
+        const double norm = matkern::dot(n, f, 1, f, 1);
+        return isnan(norm) ? INFINITY : sqrt(norm);
+    }
+
+    // sqrt(DBL_EPSILON), the relative step for finite differences that balances truncation and rounding errors
+    constexpr double FINITE_DIFFERENCE_STEP = 1.4901161193847656e-8;
+
+    // Computes the Jacobian of F at x with forward differences, given fx = F(x)
+    // x is restored afterwards, and work must have space for n values
+    bool jacobian(BoundExpression &F, double *x, const double *fx, uint16_t n, Matrix &jac, double *work) {
+        const matkern::View v = jac.view();
+        for(uint16_t j = 0; j < n; j ++) {
+            const double xj = x[j];
+            x[j] += FINITE_DIFFERENCE_STEP * fmax(fabs(xj), 1);
+            // The step that was actually taken, after rounding
+            const double h = x[j] - xj;
+            const bool ok = F(x, work, n);
+            x[j] = xj;
+            if(!ok) {
+                return false;
+            }
+            for(uint16_t i = 0; i < n; i ++) {
+                v(i, j) = (work[i] - fx[i]) / h;
+            }
         }
+        jac.setStructure(Matrix::Structure::UNKNOWN);
+        return true;
+    }
 
-        uint16_t nesting = 0;
-        uint16_t argStart = start + 1;
-        uint16_t argn = 0;
-        
-        uint16_t eqnEnd;
-        // Since this is a numerical solver anyways keeping fractions is not a concern
-        double min = 0, max = 0, err = 0;
+    /*
+     * Solves the system F(x) = 0 of n equations with damped Newton iterations, starting from x and updating it in
+     * place. Stops once every entry of F(x) is within tol of 0, or the steps become too small to change x.
+     *
+     * The Jacobian is found with finite differences at the start, and afterwards kept up to date with Broyden's rank-1
+     * updates, so each iteration only evaluates F once. It is recomputed whenever the updated one stops giving a
+     * usable step. Each step is halved until it reduces the norm of F, which keeps the iteration from diverging
+     * when the starting point is far from the solution.
+     */
+    optim::Status newtonSolve(BoundExpression &F, uint16_t n, double *x, double tol) {
+        // F(x), F at the trial point, the trial point, and space for the Jacobian
+        double *work = new (std::nothrow) double[4 * n];
+        if(!work) {
+            return optim::Status::ERROR;
+        }
+        double *f = work;
+        double *fNew = f + n;
+        double *xNew = fNew + n;
+        double *tmp = xNew + n;
+        Matrix jac(n, n);
+        Matrix rhs(n, 1);
+        jac.makeWritable();
+        rhs.makeWritable();
+        const matkern::View j = jac.view();
+        const matkern::View b = rhs.view();
+
+        optim::Status status = optim::Status::NOT_CONVERGED;
+        bool fresh = false;
+        bool needJacobian = true;
+        if(!F(x, f, n)) {
+            status = optim::Status::ERROR;
+            goto done;
+        }
+        for(uint8_t iter = 0; iter < NSOLVE_MAX_ITERATIONS; iter ++) {
+            bool small = true;
+            for(uint16_t i = 0; i < n && small; i ++) {
+                small = fabs(f[i]) <= tol;
+            }
+            if(small) {
+                status = optim::Status::OK;
+                break;
+            }
 
-        for(endOut = start; endOut < expr.length(); endOut ++) {
-            // left bracket - increase nesting
-            if(expr[endOut]->getType() == neda::ObjType::L_BRACKET) {
-                ++nesting;
+            if(needJacobian) {
+                if(!jacobian(F, x, f, n, jac, tmp)) {
+                    status = optim::Status::ERROR;
+                    goto done;
+                }
+                fresh = true;
+                needJacobian = false;
             }
-            // right bracket - decrease nesting
-            else if(expr[endOut]->getType() == neda::ObjType::R_BRACKET) {
-                --nesting;
-                // All brackets finished
-                if(!nesting) {
-                    // Try evaluating the last argument
-                    if(argn > 3) {
-                        // Too many arguments!
-                        return nullptr;
-                    }
-                    
-                    // Save the equation if it's the first arg
-                    if(argn == 0) {
-                        eqnEnd = endOut;
-                    }
-                    // Try evaluate
-                    else {
-                        Token *result = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + argStart, expr.begin() + endOut), env);
-                        /// Syntax error or non-number
-                        if(!result || !result->getType() == TokenType::NUMERICAL) {
-                            delete result;
-                            return nullptr;
-                        }
-                        (argn == 1 ? min : (argn == 2 ? max : err)) = static_cast<Numerical *>(result)->value.asDouble();
-                        delete result;
-                    }
-                    argn ++;
+
+            // The Newton step solves J step = -F
+            for(uint16_t i = 0; i < n; i ++) {
+                b(i, 0) = -f[i];
+            }
+            rhs.setStructure(Matrix::Structure::UNKNOWN);
+            Matrix *step = LUDecomposition(jac, true).solve(rhs);
+            if(!step) {
+                // A singular Broyden approximation can still be fixed by starting over, but a singular Jacobian can't
+                if(fresh) {
                     break;
                 }
+                needJacobian = true;
+                continue;
             }
-            // comma - handle arguments
-            // Only do this if nesting level is 1, so commas inside inner brackets are not counted by mistake
-            else if(expr[endOut]->getType() == neda::ObjType::CHAR_TYPE && extractChar(expr[endOut]) == ',' && nesting == 1) {
-                if(argn > 3) {
-                    // Too many arguments!
-                    return nullptr;
+
+            // Halve the step until the norm of F decreases enough
+            const double norm = residualNorm(f, n);
+            double lambda = 1;
+            bool accepted = false;
+            for(uint8_t k = 0; k < NSOLVE_MAX_BACKTRACKS && !accepted; k ++, lambda /= 2) {
+                for(uint16_t i = 0; i < n; i ++) {
+                    xNew[i] = x[i] + lambda * (*step)[i].asDouble();
                 }
-                
-                // Save the equation if it's the first arg
-                if(argn == 0) {
-                    eqnEnd = endOut;
+                if(!F(xNew, fNew, n)) {
+                    delete step;
+                    status = optim::Status::ERROR;
+                    goto done;
                 }
-                // Try evaluate
-                else {
-                    Token *result = evaluate(util::DynamicArray<neda::NEDAObj *>::createConstRef(expr.begin() + argStart, expr.begin() + endOut), env);
-                    /// Syntax error or non-number
-                    if(!result || !result->getType() == TokenType::NUMERICAL) {
-                        delete result;
-                        return nullptr;
-                    }
-                    (argn == 1 ? min : (argn == 2 ? max : err)) = static_cast<Numerical *>(result)->value.asDouble();
-                    delete result;
+                accepted = residualNorm(fNew, n) <= (1 - 1e-4 * lambda) * norm;
+            }
+            delete step;
+            if(!accepted) {
+                if(fresh) {
+                    break;
                 }
-                argn ++;
-                // Skip the comma
-                argStart = endOut + 1;
+                needJacobian = true;
+                continue;
             }
-        }
-        ++endOut;
 
-        // Wrong bounds or wrong number of args
-        // Note 3 arguments is also acceptable, in which case the accepted error is 0
-        if(argn < 3 || max < min) {
-            return nullptr;
+            // Broyden's update: J += (dF - J dx) dx^T / (dx^T dx), where dx is the step that was taken
+            // This makes J consistent with the change in F along dx, without evaluating F anywhere else
+            double dxNorm = 0;
+            bool stalled = true;
+            for(uint16_t i = 0; i < n; i ++) {
+                const double dx = xNew[i] - x[i];
+                dxNorm += dx * dx;
+                stalled = stalled && fabs(dx) <= 4 * DBL_EPSILON * fmax(fabs(x[i]), 1);
+            }
+            for(uint16_t i = 0; i < n; i ++) {
+                double r = fNew[i] - f[i];
+                for(uint16_t c = 0; c < n; c ++) {
+                    r -= j(i, c) * (xNew[c] - x[c]);
+                }
+                tmp[i] = r / dxNorm;
+            }
+            for(uint16_t i = 0; i < n; i ++) {
+                for(uint16_t c = 0; c < n; c ++) {
+                    j(i, c) += tmp[i] * (xNew[c] - x[c]);
+                }
+            }
+            jac.setStructure(Matrix::Structure::UNKNOWN);
+            fresh = false;
+
+            for(uint16_t i = 0; i < n; i ++) {
+                x[i] = xNew[i];
+                f[i] = fNew[i];
+            }
+            // Nothing more can be gained once the steps are down to rounding errors
+            if(stalled) {
+                status = optim::Status::OK;
+                break;
+            }
         }
 
-        // Set up equation
-        const util::DynamicArray<neda::NEDAObj *> eqn = util::DynamicArray<neda::NEDAObj *>::createConstRef(
-                expr.begin() + start + 1, expr.begin() + eqnEnd);
-        Numerical arg(min);
-        Variable varg("x", &arg);
-        env.args.insert(varg, 0);
+    done:
+        delete[] work;
+        return status;
+    }
 
-        // Evaluate on bounds of interval
-        Token *t = evaluate(eqn, env);
-        double minVal;
-        if(!t || t->getType() != TokenType::NUMERICAL) {
-            delete t;
+    /*
+     * nsolve(F, x0[, tol]) solves the system F(x) = 0, starting from x0.
+     * x has the same shape as x0, and F must have as many entries as x.
+     */
+    Token *nsolveSEP(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut) {
+        uint16_t eqnEnd;
+        util::DynamicArray<Token *> args;
+        if(!evaluateSolverArgs(expr, env, start, endOut, eqnEnd, args)) {
             return nullptr;
         }
-        minVal = static_cast<Numerical *>(t)->value.asDouble();
-        delete t;
-
-        arg.value = max;
-        t = evaluate(eqn, env);
-        double maxVal;
-        if(!t || t->getType() != TokenType::NUMERICAL) {
-            delete t;
+        if(args.length() < 1 || args.length() > 2
+                || (args[0]->getType() != TokenType::NUMERICAL && args[0]->getType() != TokenType::MATRIX)
+                || (args.length() == 2 && args[1]->getType() != TokenType::NUMERICAL)) {
+            freeTokens(args);
             return nullptr;
         }
-        maxVal = static_cast<Numerical *>(t)->value.asDouble();
-        delete t;
+        const double tol = args.length() == 2 ? static_cast<Numerical *>(args[1])->value.asDouble() : NSOLVE_DEFAULT_TOLERANCE;
 
-        // Test for zeros
-        if(minVal == 0) {
-            env.args.removeAt(0);
-            return new Numerical(minVal);
-        }
-        if(maxVal == 0) {
-            env.args.removeAt(0);
-            return new Numerical(maxVal);
-        }
-        // Test for same sign or infinite or NaN
-        if((minVal > 0 && maxVal > 0) || (minVal < 0 && maxVal < 0) || !isfinite(minVal) || !isfinite(maxVal) || err < 0) {
-            env.args.removeAt(0);
+        const util::DynamicArray<neda::NEDAObj *> eqn = util::DynamicArray<neda::NEDAObj *>::createConstRef(
+                expr.begin() + start + 1, expr.begin() + eqnEnd);
+        BoundExpression F(eqn, env, "x", args[0]);
+        const uint16_t n = F.size();
+        double *x = new (std::nothrow) double[n];
+        if(!x) {
+            freeTokens(args);
             return new Numerical(NAN);
         }
+        F.read(args[0], x);
 
-        // Start bisection
-        for(uint16_t iterations = 0; iterations < BISECTION_MAX_ITERATIONS; iterations ++) {
-            double x = min + (max - min) / 2;
-            // Evaluate on middle
-            arg.value = x;
-            t = evaluate(eqn, env);
-            if(!t || t->getType() != TokenType::NUMERICAL) {
-                delete t;
-                return nullptr;
-            }
-            double val = static_cast<Numerical *>(t)->value.asDouble();
-            delete t;
-            // Value within range
-            if(util::abs(val) <= err) {
-                env.args.removeAt(0);
-                return new Numerical(x);
-            }
-
-            // Iterate again
-            if((minVal < 0 && val > 0) || (minVal > 0 && val < 0)) {
-                max = x;
-                maxVal = val;
-            }
-            else {
-                min = x;
-                minVal = val;
-            }
-        }
-
-        return new Numerical(min + (max - min) / 2);
-
-        env.args.removeAt(0);
+        const optim::Status status = tol > 0 ? newtonSolve(F, n, x, tol) : optim::Status::NOT_CONVERGED;
+        Token *result = status == optim::Status::ERROR ? nullptr
+                : status == optim::Status::OK ? F.make(x) : new Numerical(NAN);
+        delete[] x;
+        freeTokens(args);
+        return result;
     }
 
     typedef Token *(*const SpecialExpressionParser)(const util::DynamicArray<neda::NEDAObj *> &expr, const Environment &env, uint16_t start, uint16_t &endOut);
-    const char * const SPECIAL_EXPRESSION_NAMES[] = {
+    constexpr const char *const SPECIAL_EXPRESSION_NAMES[] = {
         "log",
         "linReg",
+        "linRegStats",
         "solve",
+        "ode",
+        "fmin",
+        "fmax",
+        "nsolve",
     };
     constexpr auto SPECIAL_EXPRESSION_LEN = sizeof(SPECIAL_EXPRESSION_NAMES) / sizeof(const char *const);
+    constexpr lookup::PerfectHash<SPECIAL_EXPRESSION_LEN, 32> SPECIAL_EXPRESSION_TABLE(SPECIAL_EXPRESSION_NAMES);
+    static_assert(SPECIAL_EXPRESSION_TABLE.isValid(), "No perfect hash found for the special expression names");
     const SpecialExpressionParser SPECIAL_EXPRESSION_PARSERS[SPECIAL_EXPRESSION_LEN] = {
         &logSEP,
         &linRegSEP,
+        &linRegStatsSEP,
         &solveSEP,
+        &odeSEP,
+        &fminSEP,
+        &fmaxSEP,
+        &nsolveSEP,
     };
 
+    // These overloads evaluate a whole calculation, so the LU cache is cleared afterwards
+    // Otherwise it would keep the last factored matrix and its factors on the heap
     Token *evaluate(const neda::Container *expr, const util::DynamicArray<Variable> &vars, const util::DynamicArray<UserDefinedFunction> &funcs) {
-        util::DynamicArray<eval::Variable> args;
-        return evaluate(expr->contents, Environment(vars, funcs, args));
+        return evaluate(expr->contents, vars, funcs);
     }
     Token *evaluate(const util::DynamicArray<neda::NEDAObj *> &exprs, const util::DynamicArray<Variable> &vars, const util::DynamicArray<UserDefinedFunction> &funcs) {
         util::DynamicArray<eval::Variable> args;
-        return evaluate(exprs, Environment(vars, funcs, args));
+        Token *result = evaluate(exprs, Environment(vars, funcs, args));
+        LUDecomposition::clearCache();
+        return result;
     }
     Token *evaluate(const neda::Container *expr, const Environment &env) {
         return evaluate(expr->contents, env);
@@ -1725,7 +4716,7 @@ namespace eval {
         // And finally evaluates it and returns the result
 
         // First, perform a stack pointer check to make sure we don't overflow when evaluating recursive functions
-        if (__current_sp() + STACK_DANGER_LIMIT <= reinterpret_cast<uint32_t>(&__stack_limit)) {
+        if (__current_sp() + STACK_DANGER_LIMIT <= reinterpret_cast<uintptr_t>(&__stack_limit)) {
             return nullptr;
         }
 
@@ -1858,14 +4849,8 @@ namespace eval {
                     freeTokens(arr);
                     return nullptr;
                 }
-                // If the exponent is a matrix, return NaN
-                // We really don't want to do the Taylor series of exp(A)
-                if (exponent->getType() == TokenType::MATRIX) {
-                    delete exponent;
-                    freeTokens(arr);
-                    return new Numerical(NAN);
-                }
-                // Otherwise, turn it into an exponentiation operator and the value of the exponent
+                // Turn it into an exponentiation operator and the value of the exponent
+                // Matrix exponents give the matrix exponential (see Matrix::exp())
                 arr.add(new Operator(Operator::Type::EXPONENT));
                 arr.add(exponent);
                 // Move on to the next token
@@ -1894,7 +4879,7 @@ namespace eval {
                 Token *contents = evaluate(
                         (neda::Container *) ((neda::Radical *) exprs[index])->contents, env);
                 // If an error occurs, clean up and return null
-                if (!n || !contents || n->getType() == TokenType::MATRIX) {
+                if (!n || !contents || n->getType() != TokenType::NUMERICAL) {
                     // nullptr deletion allowed; no need for checking
                     delete n;
                     delete contents;
@@ -1974,7 +4959,7 @@ namespace eval {
                     // Check for syntax errors, noninteger result, and out of bounds
                     double n;
                     if (!res || res->getType() == TokenType::MATRIX || (n = extractDouble(res), !util::isInt(n)) ||
-                            n <= 0 || n > 255) {
+                            n <= 0 || n > 0xFFFF) {
                         delete res;
                         delete[] str;
                         freeTokens(arr);
@@ -1982,13 +4967,14 @@ namespace eval {
                     }
                     delete res;
 
-                    Matrix *mat = new Matrix(static_cast<uint8_t>(n), static_cast<uint8_t>(n));
+                    Matrix *mat = new Matrix(static_cast<uint16_t>(n), static_cast<uint16_t>(n));
                     // If identity matrix, fill it in
                     if (str[0] == 'I') {
-                        for (uint8_t i = 0; i < mat->m; i++) {
+                        for (uint16_t i = 0; i < mat->m; i++) {
                             mat->setEntry(i, i, 1);
                         }
                     }
+                    mat->setStructure(str[0] == 'I' ? Matrix::Structure::IDENTITY : Matrix::Structure::ZERO);
 
                     arr.add(mat);
                     delete[] str;
@@ -1998,10 +4984,20 @@ namespace eval {
                 }
 
                 // Special processing for unit conversions
-                if (end < exprs.length() && extractChar(exprs[end]) == LCD_CHAR_RARW) {
+                // Compound units (e.g. km/h) continue past the end of the token
+                uint16_t unitEnd = isNum ? end : findUnitEnd(exprs, index);
+                if (unitEnd < exprs.length() && extractChar(exprs[unitEnd]) == LCD_CHAR_RARW) {
+                    if (unitEnd != end) {
+                        delete[] str;
+                        str = new char[unitEnd - index + 1];
+                        for (uint16_t i = index; i < unitEnd; i++) {
+                            str[i - index] = extractChar(exprs[i]);
+                        }
+                        str[unitEnd - index] = '\0';
+                    }
                     // Find the other unit
-                    index = end + 1;
-                    end = findTokenEnd(exprs, index, 1, isNum);
+                    index = unitEnd + 1;
+                    end = findUnitEnd(exprs, index);
 
                     // Copy the other unit
                     char *unit = new char[end - index + 1];
@@ -2043,29 +5039,23 @@ namespace eval {
                 }
 
                 // Special expressions
-                bool isSpecialExpression = false;
-                for(uint16_t i = 0; i < SPECIAL_EXPRESSION_LEN; i ++) {
-                    if(strcmp(str, SPECIAL_EXPRESSION_NAMES[i]) == 0) {
-                        // Implied multiplication
-                        if (!lastTokenOperator) {
-                            arr.add(new Operator(Operator::Type::MULTIPLY));
-                        }
-                        // Evaluate
-                        Token *result = SPECIAL_EXPRESSION_PARSERS[i](exprs, env, end, end);
-                        
-                        delete[] str;
-                        if(!result) {
-                            freeTokens(arr);
-                            return nullptr;
-                        }
-                        arr.add(result);
-                        lastTokenOperator = false;
-                        index = end;
-                        isSpecialExpression = true;
-                        break;
+                const int16_t specialExpression = SPECIAL_EXPRESSION_TABLE.find(str);
+                if(specialExpression >= 0) {
+                    // Implied multiplication
+                    if (!lastTokenOperator) {
+                        arr.add(new Operator(Operator::Type::MULTIPLY));
                     }
-                }
-                if(isSpecialExpression) {
+                    // Evaluate
+                    Token *result = SPECIAL_EXPRESSION_PARSERS[specialExpression](exprs, env, end, end);
+
+                    delete[] str;
+                    if(!result) {
+                        freeTokens(arr);
+                        return nullptr;
+                    }
+                    arr.add(result);
+                    lastTokenOperator = false;
+                    index = end;
                     break;
                 }
 
@@ -2124,41 +5114,50 @@ namespace eval {
                             arr.add(n);
                         }
                         else {
+                            const Variable *found = nullptr;
                             // Check arguments
                             for(auto &var : env.args) {
                                 // Compare with each variable name
                                 if (strcmp(str, var.name) == 0) {
-                                    // We found a match!
-                                    if (var.value->getType() == TokenType::NUMERICAL) {
-                                        arr.add(new Numerical(static_cast<Numerical *>(var.value)->value));
-                                    }
-                                    else {
-                                        arr.add(new Matrix(*static_cast<Matrix *>(var.value)));
-                                    }
-                                    lastTokenOperator = false;
-                                    goto charParseEnd;
+                                    found = &var;
+                                    break;
                                 }
                             }
                             // Otherwise check if it's a valid variable
                             // Loop through all variables
-                            for(auto &var : env.vars) {
-                                // Compare with each variable name
-                                if (strcmp(str, var.name) == 0) {
-                                    // We found a match!
-                                    if (var.value->getType() == TokenType::NUMERICAL) {
-                                        arr.add(new Numerical(static_cast<Numerical *>(var.value)->value));
+                            if (!found) {
+                                for(auto &var : env.vars) {
+                                    // Compare with each variable name
+                                    if (strcmp(str, var.name) == 0) {
+                                        found = &var;
+                                        break;
                                     }
-                                    else {
-                                        arr.add(new Matrix(*static_cast<Matrix *>(var.value)));
-                                    }
-                                    lastTokenOperator = false;
-                                    goto charParseEnd;
                                 }
                             }
                             // Nothing found
-                            freeTokens(arr);
-                            delete[] str;
-                            return nullptr;
+                            if (!found) {
+                                freeTokens(arr);
+                                delete[] str;
+                                return nullptr;
+                            }
+                            // Polynomials followed by brackets are called like functions
+                            if (found->value->getType() == TokenType::POLYNOMIAL && end < exprs.length() &&
+                                    exprs[end]->getType() == neda::ObjType::L_BRACKET) {
+                                Token *result = callPolynomial(
+                                        *static_cast<Polynomial *>(found->value), exprs, env, end, end);
+                                if (!result) {
+                                    freeTokens(arr);
+                                    delete[] str;
+                                    return nullptr;
+                                }
+                                arr.add(result);
+                                // Skip the ending right bracket
+                                ++end;
+                            }
+                            else {
+                                // Matrices share their entries with the variable until one of them is modified
+                                arr.add(copyToken(found->value));
+                            }
                         }
                         lastTokenOperator = false;
                     }
@@ -2169,7 +5168,6 @@ namespace eval {
                     index = end;
                     lastTokenOperator = false;
                 }
-            charParseEnd:
                 // Clean up the string buffer and move on
                 delete[] str;
                 index = end;
@@ -2207,8 +5205,8 @@ namespace eval {
                     freeTokens(arr);
                     return nullptr;
                 }
-                // Matrices are not allowed as counters
-                if (start->getType() == TokenType::MATRIX || end->getType() == TokenType::MATRIX) {
+                // Only numbers are allowed as counters
+                if (start->getType() != TokenType::NUMERICAL || end->getType() != TokenType::NUMERICAL) {
                     delete end;
                     delete start;
                     freeTokens(arr);
@@ -2319,7 +5317,13 @@ namespace eval {
                             freeTokens(arr);
                             return nullptr;
                         }
-                        mat->contents[i] = static_cast<Numerical *>(n)->value;
+                        if (n->getType() != TokenType::NUMERICAL) {
+                            delete mat;
+                            delete n;
+                            freeTokens(arr);
+                            return nullptr;
+                        }
+                        mat->set(i, static_cast<Numerical *>(n)->value);
                     }
                     else {
                         // Check that the vector only has 1 column and the rows are as expected
@@ -2332,12 +5336,14 @@ namespace eval {
                         }
                     constructMatrixFromVectors:
                         // Fill in the column of the matrix with the entires in this column vector
-                        for (uint8_t row = 0; row < mat->m; row++) {
-                            mat->setEntry(row, i, static_cast<Matrix *>(n)->contents[row]);
+                        for (uint16_t row = 0; row < mat->m; row++) {
+                            mat->setEntry(row, i, (*static_cast<Matrix *>(n))[row]);
                         }
                     }
                     delete n;
                 }
+                // Matrices of only fractions are marked as such, so the exact algorithms don't have to check
+                mat->compact();
                 // Insert value
                 arr.add(mat);
                 // Move on to the next object
@@ -2447,7 +5453,7 @@ namespace eval {
                 }
 
                 // Get the matrix
-                const Matrix *mat = static_cast<const Matrix *>(arr[arr.length() - 1]);
+                Matrix *mat = static_cast<Matrix *>(arr[arr.length() - 1]);
 
                 Token *result = nullptr;
 
@@ -2462,12 +5468,12 @@ namespace eval {
                     }
 
                     double d = extractDouble(t);
-                    if (!util::canCastProperly<double, uint8_t>(d - 1)) {
+                    if (!util::canCastProperly<double, uint16_t>(d - 1)) {
                         freeTokens(arr);
                         delete t;
                         return nullptr;
                     }
-                    uint8_t index = static_cast<uint8_t>(d - 1);
+                    uint16_t index = static_cast<uint16_t>(d - 1);
                     delete t;
 
                     // For vectors, just take the number
@@ -2527,15 +5533,15 @@ namespace eval {
                     // Wildcard on column
                     // Take row vector
                     if (row && !col) {
-                        // Verify cast into uint8_t
+                        // Verify cast into uint16_t
                         double drow = extractDouble(row);
-                        if (!util::canCastProperly<double, uint8_t>(drow - 1)) {
+                        if (!util::canCastProperly<double, uint16_t>(drow - 1)) {
                             delete row;
                             freeTokens(arr);
                             return nullptr;
                         }
 
-                        uint8_t rowInt = static_cast<uint8_t>(drow - 1);
+                        uint16_t rowInt = static_cast<uint16_t>(drow - 1);
                         result = mat->getRowVector(rowInt);
                         // If out of range, syntax error
                         if (!result) {
@@ -2548,13 +5554,13 @@ namespace eval {
                     // Take column vector
                     else if (col && !row) {
                         double dcol = extractDouble(col);
-                        if (!util::canCastProperly<double, uint8_t>(dcol - 1)) {
+                        if (!util::canCastProperly<double, uint16_t>(dcol - 1)) {
                             delete col;
                             freeTokens(arr);
                             return nullptr;
                         }
 
-                        uint8_t colInt = static_cast<uint8_t>(dcol - 1);
+                        uint16_t colInt = static_cast<uint16_t>(dcol - 1);
                         result = mat->getColVector(colInt);
                         if (!result) {
                             delete col;
@@ -2563,24 +5569,24 @@ namespace eval {
                         }
                     }
                     // Wildcard on both indices
-                    // Just copy the matrix itself
+                    // Just take the matrix itself, which is deleted afterwards anyways
                     else if (!col && !row) {
-                        result = new Matrix(*mat);
+                        result = new Matrix(static_cast<Matrix &&>(*mat));
                     }
                     else {
                         double drow = extractDouble(row);
                         double dcol = extractDouble(col);
-                        // Verify that the indices can be properly casted into uint8_ts
-                        if (!util::canCastProperly<double, uint8_t>(drow - 1) ||
-                                !util::canCastProperly<double, uint8_t>(dcol - 1)) {
+                        // Verify that the indices can be properly casted into uint16_ts
+                        if (!util::canCastProperly<double, uint16_t>(drow - 1) ||
+                                !util::canCastProperly<double, uint16_t>(dcol - 1)) {
                             delete row;
                             delete col;
                             freeTokens(arr);
                             return nullptr;
                         }
 
-                        uint8_t rowInt = static_cast<uint8_t>(drow - 1);
-                        uint8_t colInt = static_cast<uint8_t>(dcol - 1);
+                        uint16_t rowInt = static_cast<uint16_t>(drow - 1);
+                        uint16_t colInt = static_cast<uint16_t>(dcol - 1);
                         if (rowInt >= mat->m || colInt >= mat->n) {
                             delete row;
                             delete col;
@@ -2597,6 +5603,10 @@ namespace eval {
 
                 // Delete the matrix
                 delete mat;
+                // Row and column vectors are views that share the entries of the matrix
+                if (result && result->getType() == TokenType::MATRIX) {
+                    static_cast<Matrix *>(result)->trim();
+                }
                 // Replace it with the result
                 arr[arr.length() - 1] = result;
 
@@ -2631,10 +5641,15 @@ namespace eval {
                     }
                     arr.add(t);
                 }
-                else {
+                else if (t->getType() == TokenType::MATRIX) {
                     arr.add(new Numerical(static_cast<Matrix *>(t)->len()));
                     delete t;
                 }
+                else {
+                    delete t;
+                    freeTokens(arr);
+                    return nullptr;
+                }
 
                 lastTokenOperator = false;
                 index++;
@@ -2653,8 +5668,8 @@ namespace eval {
         util::Deque<Token *> stack;
         bool expectOperand = true;
         for (Token *t : arr) {
-            // If token is a number, fraction or matrix, put it in the queue
-            if (t->getType() == TokenType::NUMERICAL || t->getType() == TokenType::MATRIX) {
+            // If token is a number, fraction, matrix or polynomial, put it in the queue
+            if (t->getType() != TokenType::OPERATOR) {
                 if (!expectOperand) {
                     // Syntax error
                     freeTokens(arr);
@@ -2665,6 +5680,21 @@ namespace eval {
             }
             else {
                 if (static_cast<const Operator *>(t)->isUnary()) {
+                    // Postfix operators directly follow their operand
+                    if (static_cast<const Operator *>(t)->isPostfix()) {
+                        if (expectOperand) {
+                            // Syntax error
+                            freeTokens(arr);
+                            return nullptr;
+                        }
+                        // Apply all operators on the stack that have higher precedence first
+                        while (!stack.isEmpty() && static_cast<const Operator *>(stack.peek())->getPrecedence() <=
+                                static_cast<const Operator *>(t)->getPrecedence()) {
+                            output.enqueue(stack.pop());
+                        }
+                        output.enqueue(t);
+                        continue;
+                    }
                     if (!expectOperand) {
                         // Syntax error
                         freeTokens(arr);
@@ -2700,8 +5730,8 @@ namespace eval {
         while (!output.isEmpty()) {
             // Read a token
             Token *t = output.dequeue();
-            // If token is a number, fraction or matrix, push onto stack
-            if (t->getType() == NUMERICAL || t->getType() == TokenType::MATRIX) {
+            // If token is a number, fraction, matrix or polynomial, push onto stack
+            if (t->getType() != TokenType::OPERATOR) {
                 stack.push(t);
             }
             // Operator
@@ -2765,6 +5795,8 @@ namespace eval {
             }
             return nullptr;
         }
-        return stack.pop();
+        Token *result = stack.pop();
+        resolveTranspose(result);
+        return result;
     }
 } // namespace eval
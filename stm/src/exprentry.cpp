@@ -17,6 +17,8 @@ namespace expr {
         for (i = 0; i < variables.length(); ++i) {
             // Update it if found
             if (strcmp(variables[i].name, varName) == 0) {
+                // The LU cache may hold a copy of the old value
+                eval::LUDecomposition::clearCache();
                 // Delete the old value
                 delete variables[i].value;
                 variables[i].value = varVal;
@@ -94,6 +96,7 @@ namespace expr {
         }
     }
     void clearAll() {
+        eval::LUDecomposition::clearCache();
         // Delete all variables
         for (auto var : variables) {
             delete[] var.name;
@@ -132,6 +135,9 @@ namespace expr {
     void ExprEntry::adjustExpr() {
         // Get top-level container to work with
         neda::Expr *top = cursor->expr->getTopLevel();
+        // Bring the dimensions and positions up to date after any edits, without drawing anything
+        top->layout();
+        top->setPosition(top->x, top->y);
         // Get cursor info
         neda::CursorInfo info;
         cursor->getInfo(info);
@@ -499,7 +505,8 @@ namespace expr {
                 neda::Container *container = new neda::Container;
                 container->getCursor(*cursor, neda::CURSORLOCATION_START);
                 // Make sure the cursor's location is updated
-                container->draw(display, 0, 0);
+                container->layout();
+                container->setPosition(0, 0);
                 // Delete old
                 delete original;
                 break;
@@ -532,6 +539,7 @@ namespace expr {
                 prevMode = DisplayMode::NORMAL;
                 selectorIndex = 0;
                 scrollingIndex = 0;
+                editorContents.empty();
                 drawInterfaceFunc();
                 return;
             case KEY_RECALL:
@@ -635,15 +643,14 @@ namespace expr {
     }
 
     void ExprEntry::drawInterfaceNormal(bool drawCursor) {
-        // Call draw once before everything so that the locations are all updated
         neda::Expr *top = cursor->expr->getTopLevel();
-        top->draw(display);
         // First make sure the cursor is visible
+        // This also lays out and positions everything, so it only has to be drawn afterwards
         adjustExpr();
         // Clear the screen
         display.clearDrawingBuffer();
         // Draw everything
-        top->draw(display);
+        top->render(display);
         if (drawCursor) {
             cursor->draw(display);
         }
@@ -804,47 +811,135 @@ namespace expr {
         display.updateDrawing();
     }
 
+    uint16_t ExprEntry::getCatalogFuncCount() const {
+        const char *prefix = editorContents.asArray();
+        const uint16_t len = editorContents.length();
+        uint8_t first;
+        uint16_t count = len != 0 ? eval::Function::FUNC_FULLNAMES_INDEX.search(prefix, len, first)
+                                  : eval::Function::TYPE_COUNT_DISPLAYABLE;
+        for (const auto &f : expr::functions) {
+            if (lookup::comparePrefix(f.fullname, prefix, len) == 0) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    const char *ExprEntry::getCatalogFunc(uint16_t index) const {
+        const char *prefix = editorContents.asArray();
+        const uint16_t len = editorContents.length();
+        // With nothing typed the builtin functions are in their usual order, otherwise in alphabetical order
+        if (len == 0) {
+            if (index < eval::Function::TYPE_COUNT_DISPLAYABLE) {
+                return eval::Function::FUNC_FULLNAMES[index];
+            }
+            index -= eval::Function::TYPE_COUNT_DISPLAYABLE;
+            return index < expr::functions.length() ? expr::functions[index].fullname : nullptr;
+        }
+
+        uint8_t first;
+        const uint8_t count = eval::Function::FUNC_FULLNAMES_INDEX.search(prefix, len, first);
+        if (index < count) {
+            return eval::Function::FUNC_FULLNAMES[eval::Function::FUNC_FULLNAMES_INDEX[first + index]];
+        }
+        index -= count;
+        // User-defined functions go after the builtin ones
+        for (const auto &f : expr::functions) {
+            if (lookup::comparePrefix(f.fullname, prefix, len) == 0 && index-- == 0) {
+                return f.fullname;
+            }
+        }
+        return nullptr;
+    }
+
     void ExprEntry::funcKeyPressHandler(uint16_t key) {
-        const uint16_t funcCount = eval::Function::TYPE_COUNT_DISPLAYABLE + expr::functions.length();
-        if(key == KEY_ENTER || key == KEY_CENTER) {
-            // If the selected item is in the range of builtin functions, insert that
-            if (selectorIndex < eval::Function::TYPE_COUNT_DISPLAYABLE) {
-                // Extract the function name from its full name
-                const char *s = eval::Function::FUNC_FULLNAMES[selectorIndex];
-                // Add until we see the null terminator or the left bracket
-                while (*s != '\0' && *s != '(') {
-                    cursor->add(new neda::Character(*s++));
-                }
+        const uint16_t funcCount = getCatalogFuncCount();
+        switch (key) {
+        case KEY_ENTER:
+        case KEY_CENTER: {
+            const char *s = getCatalogFunc(selectorIndex);
+            if (!s) {
+                return;
             }
-            else {
-                // Otherwise take the name directly from the builtin function struct
-                cursor->addStr(expr::functions[selectorIndex - eval::Function::TYPE_COUNT_DISPLAYABLE].name);
+            // Add the name, which is everything before the left bracket
+            while (*s != '\0' && *s != '(') {
+                cursor->add(new neda::Character(*s++));
             }
             cursor->add(new neda::LeftBracket);
-            
+
+            editorContents.empty();
             key = KEY_DELETE;
+            break;
+        }
+        case KEY_DELETE:
+            // Delete a character from the search before leaving the menu
+            if (editorContents.length() != 0) {
+                editorContents.pop();
+                selectorIndex = 0;
+                scrollingIndex = 0;
+                drawInterfaceFunc();
+                return;
+            }
+            break;
+        case KEY_CAT:
+            editorContents.empty();
+            break;
+        case KEY_UP:
+        case KEY_DOWN:
+            // Nothing to scroll through
+            if (funcCount == 0) {
+                return;
+            }
+            break;
+        default: {
+            // Typing searches for functions starting with what has been typed
+            char ch = keyCodeToChar(key);
+            if (ch != 0xFF && editorContents.length() < 16) {
+                editorContents.add(ch);
+                selectorIndex = 0;
+                scrollingIndex = 0;
+                drawInterfaceFunc();
+            }
+            return;
+        }
         }
         handleMenuKeyPress(key, funcCount, KEY_CAT);
     }
 
     void ExprEntry::drawInterfaceFunc() {
         display.clearDrawingBuffer();
+        // Only 6 rows fit at a time, or 5 if the search bar is shown
+        const uint8_t rows = editorContents.length() != 0 ? 5 : 6;
         int16_t y = 1;
-        // Draw the full names of functions
-        // Only 6 fit at a time, so only draw from the scrolling index to scrolling index + 6
-        for (uint8_t i = scrollingIndex; i < scrollingIndex + 6 && i < eval::Function::TYPE_COUNT_DISPLAYABLE + expr::functions.length(); i++) {
-            if (i < eval::Function::TYPE_COUNT_DISPLAYABLE) {
-                display.drawString(1, y, eval::Function::FUNC_FULLNAMES[i],
-                        selectorIndex == i ? lcd::DrawBuf::FLAG_INVERTED : lcd::DrawBuf::FLAG_NONE);
-            }
-            else {
-                display.drawString(1, y, expr::functions[i - eval::Function::TYPE_COUNT_DISPLAYABLE].fullname,
-                        selectorIndex == i ? lcd::DrawBuf::FLAG_INVERTED : lcd::DrawBuf::FLAG_NONE);
-            }
+        if (editorContents.length() != 0) {
+            // Draw the search bar
+            display.fill(0, 0, lcd::SIZE_WIDTH, 11, true);
+            editorContents.add('\0');
+            display.drawString(1, 1, editorContents.asArray());
+            // Remove the null terminator
+            editorContents.pop();
+            y += 12;
+        }
+
+        const uint16_t funcCount = getCatalogFuncCount();
+        // Keep the selection visible when there are fewer rows
+        if (selectorIndex >= scrollingIndex + rows) {
+            scrollingIndex = selectorIndex - rows + 1;
+        }
+        // Draw the full names of functions from the scrolling index onwards
+        for (uint16_t i = scrollingIndex; i < scrollingIndex + rows && i < funcCount; i++) {
+            display.drawString(1, y, getCatalogFunc(i),
+                    selectorIndex == i ? lcd::DrawBuf::FLAG_INVERTED : lcd::DrawBuf::FLAG_NONE);
             y += 10;
         }
 
-        drawScrollbar(eval::Function::TYPE_COUNT_DISPLAYABLE + expr::functions.length(), 6);
+        if (funcCount != 0) {
+            drawScrollbar(funcCount, rows);
+        }
+        else {
+            // Show error
+            display.drawImage(88, 1, lcd::CHAR_SERR);
+        }
         display.updateDrawing();
     }
 
@@ -973,9 +1068,6 @@ namespace expr {
                     mat->setEntry(i, j, new neda::Container());
                 }
             }
-            // These have to be called manually since setting the entries do not trigger size recalculations
-            mat->computeDimensions();
-
             cursor->add(mat);
             mat->getCursor(*cursor, neda::CURSORLOCATION_START);
         }
@@ -1042,8 +1134,6 @@ namespace expr {
                 p->setCondition(i, new neda::Container());
                 p->setValue(i, new neda::Container());
             }
-            p->computeDimensions();
-
             cursor->add(p);
             p->getCursor(*cursor, neda::CURSORLOCATION_START);
         }
@@ -1519,6 +1609,7 @@ namespace expr {
                         }
                     }
                 functionCheckLoopEnd:
+                    eval::LUDecomposition::clearCache();
                     if (!incremented) {
                         selectorIndex = 0;
                     }
@@ -1835,6 +1926,58 @@ namespace expr {
         return realY;
     }
 
+    template <typename F>
+    void ExprEntry::drawCurve(F f) {
+        // The y value of the previous pixel (in the real coordinate system)
+        double prevResult = NAN;
+        int16_t prevYLCD = 0;
+        // Evaluate for each x coordinate
+        // We intentially also include the pixel at x = 128 and x = -1, which is out of bounds
+        // This is so that if it needs to be connected to the previous pixel, the connection is drawn
+        for (int16_t currentXLCD = -1; currentXLCD <= lcd::SIZE_WIDTH; currentXLCD++) {
+            // Get the x value in real coordinate space
+            double currentXReal = unmapX(currentXLCD);
+            double currentYReal = f(currentXReal);
+
+            // If result is NaN, skip this pixel
+            if (!isnan(currentYReal)) {
+                // Otherwise map the Y value
+                int16_t currentYLCD = mapY(currentYReal);
+                int16_t prevXLCD = currentXLCD - 1;
+
+                // Set the pixel
+                graphBuf.setPixel(currentXLCD, currentYLCD);
+                // Do a bounds check
+                if (currentXLCD >= 0 && prevXLCD < lcd::SIZE_WIDTH && (prevYLCD >= 0 || currentYLCD >= 0) &&
+                        (prevYLCD < lcd::SIZE_HEIGHT || currentYLCD < lcd::SIZE_HEIGHT)
+                        // Make sure previous pixel was not NaN
+                        && !isnan(prevResult)
+                        // Test if connection was necessary
+                        && abs(currentYLCD - prevYLCD) > 1) {
+                    double prevXReal = unmapX(prevXLCD);
+                    double prevYReal = prevResult;
+                    // Will be positive if the current pixel is higher than the previous one
+                    double slope = (currentXReal - prevXReal) / (currentYReal - prevYReal);
+
+                    if (currentYReal > prevYReal) {
+                        for (int16_t dispY = prevYLCD - 1; dispY > currentYLCD; dispY--) {
+                            double realXDiff = (unmapY(dispY) - prevYReal) * slope;
+                            graphBuf.setPixel(mapX(realXDiff + prevXReal), dispY);
+                        }
+                    }
+                    else {
+                        for (int16_t dispY = prevYLCD + 1; dispY < currentYLCD; dispY++) {
+                            double realXDiff = (unmapY(dispY) - prevYReal) * slope;
+                            graphBuf.setPixel(mapX(realXDiff + prevXReal), dispY);
+                        }
+                    }
+                }
+                prevYLCD = currentYLCD;
+            }
+            prevResult = currentYReal;
+        }
+    }
+
     void ExprEntry::redrawGraph() {
         // Display loading message
         display.clearDrawingBuffer();
@@ -1876,22 +2019,25 @@ namespace expr {
             if(gvar.var->value->getType() == eval::TokenType::MATRIX) {
                 eval::Matrix *m = static_cast<eval::Matrix *>(gvar.var->value);
                 // A set of points
-                if(m->n == 2) {
-                    for(uint8_t i = 0; i < m->m; i ++) {
+                // Each column after the first is a separate set of y values (e.g. a trajectory from ode())
+                if(m->n >= 2) {
+                    for(uint16_t i = 0; i < m->m; i ++) {
                         int16_t x = mapX(m->getEntry(i, 0).asDouble());
-                        int16_t y = mapY(m->getEntry(i, 1).asDouble());
-
-                        graphBuf.setPixel(x, y);
-                        graphBuf.setPixel(x, y - 1);
-                        graphBuf.setPixel(x, y + 1);
-                        graphBuf.setPixel(x - 1, y);
-                        graphBuf.setPixel(x + 1, y);
+                        for(uint16_t j = 1; j < m->n; j ++) {
+                            int16_t y = mapY(m->getEntry(i, j).asDouble());
+
+                            graphBuf.setPixel(x, y);
+                            graphBuf.setPixel(x, y - 1);
+                            graphBuf.setPixel(x, y + 1);
+                            graphBuf.setPixel(x - 1, y);
+                            graphBuf.setPixel(x + 1, y);
+                        }
                     }
                 }
                 // A single point (column form)
                 else if(m->m == 2 && m->n == 1) {
-                    int16_t x = mapX(m->contents[0].asDouble());
-                    int16_t y = mapY(m->contents[1].asDouble());
+                    int16_t x = mapX((*m)[0].asDouble());
+                    int16_t y = mapY((*m)[1].asDouble());
 
                     graphBuf.setPixel(x, y);
                     graphBuf.setPixel(x, y - 1);
@@ -1900,76 +2046,39 @@ namespace expr {
                     graphBuf.setPixel(x + 1, y);
                 }
             }
+            // Polynomials (e.g. from polyFit) are evaluated directly, without going through the expression evaluator
+            else if(gvar.var->value->getType() == eval::TokenType::POLYNOMIAL) {
+                const eval::Polynomial &p = *static_cast<eval::Polynomial *>(gvar.var->value);
+                drawCurve([&p](double x) {
+                    return p(x);
+                });
+            }
         }
 
         // Graph each function
-
         util::DynamicArray<eval::Variable> args;
         eval::Numerical arg(0);
         args.add(eval::Variable(nullptr, &arg));
         const eval::Environment env(variables, functions, args);
 
-        // The y value of the previous pixel (in the real coordinate system)
-        double prevResult = NAN;
-        int16_t prevYLCD = 0;
         for (GraphableFunction &gfunc : graphableFunctions) {
             if (gfunc.graph) {
                 const eval::UserDefinedFunction &func = *gfunc.func;
                 args[0].name = func.argn[0];
-
-                // Evaluate for each x coordinate
-                // We intentially also include the pixel at x = 128 and x = -1, which is out of bounds
-                // This is so that if it needs to be connected to the previous pixel, the connection is drawn
-                for (int16_t currentXLCD = -1; currentXLCD <= lcd::SIZE_WIDTH; currentXLCD++) {
-                    // Get the x value in real coordinate space
-                    double currentXReal = unmapX(currentXLCD);
+                drawCurve([&](double x) {
                     // Set the value of the argument
-                    arg.value = currentXReal;
+                    arg.value = x;
                     // Attempt to evaluate
                     eval::Token *t = eval::evaluate(func.expr, env);
                     // Watch out for syntax error
-                    double currentYReal = t ? eval::extractDouble(t) : NAN;
+                    double y = t ? eval::extractDouble(t) : NAN;
                     delete t;
-
-                    // If result is NaN, skip this pixel
-                    if (!isnan(currentYReal)) {
-                        // Otherwise map the Y value
-                        int16_t currentYLCD = mapY(currentYReal);
-                        int16_t prevXLCD = currentXLCD - 1;
-
-                        // Set the pixel
-                        graphBuf.setPixel(currentXLCD, currentYLCD);
-                        // Do a bounds check
-                        if (currentXLCD >= 0 && prevXLCD < lcd::SIZE_WIDTH && (prevYLCD >= 0 || currentYLCD >= 0) &&
-                                (prevYLCD < lcd::SIZE_HEIGHT || currentYLCD < lcd::SIZE_HEIGHT)
-                                // Make sure previous pixel was not NaN
-                                && !isnan(prevResult)
-                                // Test if connection was necessary
-                                && abs(currentYLCD - prevYLCD) > 1) {
-                            double prevXReal = unmapX(prevXLCD);
-                            double prevYReal = prevResult;
-                            // Will be positive if the current pixel is higher than the previous one
-                            double slope = (currentXReal - prevXReal) / (currentYReal - prevYReal);
-
-                            if (currentYReal > prevYReal) {
-                                for (int16_t dispY = prevYLCD - 1; dispY > currentYLCD; dispY--) {
-                                    double realXDiff = (unmapY(dispY) - prevYReal) * slope;
-                                    graphBuf.setPixel(mapX(realXDiff + prevXReal), dispY);
-                                }
-                            }
-                            else {
-                                for (int16_t dispY = prevYLCD + 1; dispY < currentYLCD; dispY++) {
-                                    double realXDiff = (unmapY(dispY) - prevYReal) * slope;
-                                    graphBuf.setPixel(mapX(realXDiff + prevXReal), dispY);
-                                }
-                            }
-                        }
-                        prevYLCD = currentYLCD;
-                    }
-                    prevResult = currentYReal;
-                }
+                    return y;
+                });
             }
         }
+        // The cache is only kept while graphing so that every point doesn't factor the same matrix
+        eval::LUDecomposition::clearCache();
     }
 
     void ExprEntry::drawInterfaceGraphViewer() {
@@ -2181,7 +2290,8 @@ namespace expr {
                     neda::Container *container = new neda::Container;
                     container->getCursor(*cursor, neda::CURSORLOCATION_START);
                     // Make sure the cursor's location is updated
-                    container->draw(display, 0, 0);
+                    container->layout();
+                    container->setPosition(0, 0);
                     // Delete old
                     delete original;
                 }
@@ -2310,6 +2420,8 @@ namespace expr {
         display.clearDrawingBuffer();
 
         bool found = false;
+        // The molar mass if what was typed is a chemical formula instead of an element
+        double formulaMass = NAN;
         if (editorContents.length() != 0) {
             // Search for the element
             // First append null terminator
@@ -2353,6 +2465,11 @@ namespace expr {
                         cursorX = location.x;
                         cursorY = location.y;
                     }
+                    else {
+                        // Finally try it as a formula
+                        formulaMass = pt::molarMass(editorContents.asArray());
+                        found = !isnan(formulaMass);
+                    }
                 }
             }
         }
@@ -2395,6 +2512,13 @@ namespace expr {
             if (!found) {
                 display.drawImage(88, 1, lcd::CHAR_SERR);
             }
+            // Show the molar mass of a formula
+            else if (!isnan(formulaMass)) {
+                char buf[24];
+                uint8_t len = util::ftoa(formulaMass, buf, 7, LCD_CHAR_EE);
+                strcpy(buf + len, "g" LCD_STR_DIV "mol");
+                display.drawString(lcd::SIZE_WIDTH - 1, 1, buf, lcd::DrawBuf::FLAG_HALIGN_RIGHT);
+            }
         }
         display.updateDrawing();
     }
@@ -2525,8 +2649,6 @@ namespace expr {
                 cont->addAt(i, newMat);
                 // Delete old matrix
                 delete mat;
-                // Update matrix dimensions
-                newMat->computeDimensions();
             }
 
             key = KEY_DELETE;
@@ -2557,21 +2679,27 @@ namespace expr {
         util::DynamicArray<GraphableVariable> newGraphableVars;
         
         for(const auto &var : variables) {
+            bool graphable = false;
             if(var.value->getType() == eval::TokenType::MATRIX) {
                 eval::Matrix *mat = static_cast<eval::Matrix*>(var.value);
                 // 2D col vector
-                // Or a set of data points
-                if((mat->m == 2 && mat->n == 1) || mat->n == 2) {
-                    GraphableVariable v(&var, false);
-                    // Look in the old array and see if it existed previously
-                    for (const auto &gvar : graphableVars) {
-                        // If the two variables match, copy its status
-                        if (strcmp(gvar.var->name, var.name) == 0) {
-                            v.graph = gvar.graph;
-                        }
+                // Or a set of data points, possibly with several y values for each x
+                graphable = (mat->m == 2 && mat->n == 1) || mat->n >= 2;
+            }
+            // Polynomials are graphed as curves
+            else if(var.value->getType() == eval::TokenType::POLYNOMIAL) {
+                graphable = true;
+            }
+            if(graphable) {
+                GraphableVariable v(&var, false);
+                // Look in the old array and see if it existed previously
+                for (const auto &gvar : graphableVars) {
+                    // If the two variables match, copy its status
+                    if (strcmp(gvar.var->name, var.name) == 0) {
+                        v.graph = gvar.graph;
                     }
-                    newGraphableVars.add(v);
                 }
+                newGraphableVars.add(v);
             }
         }
 
@@ -0,0 +1,260 @@
+#include "fft.hpp"
+#include <math.h>
+#include <new>
+
+namespace fft {
+
+    // M_PI is not standard C++ and is hidden by newlib in strict mode
+    constexpr double PI = 3.14159265358979323846;
+
+    // sin(2 pi i / TABLE_SIZE) for i = 0 to TABLE_SIZE / 4; the rest of the circle follows from symmetry
+    const double SINE_TABLE[TABLE_SIZE / 4 + 1] = {
+            0.0, 0.006135884649154475, 0.012271538285719925, 0.01840672990580482,
+            0.024541228522912288, 0.030674803176636626, 0.03680722294135883, 0.04293825693494082,
+            0.049067674327418015, 0.055195244349689934, 0.06132073630220858, 0.06744391956366405,
+            0.07356456359966743, 0.07968243797143013, 0.0857973123444399, 0.09190895649713272,
+            0.0980171403295606, 0.10412163387205459, 0.11022220729388306, 0.11631863091190475,
+            0.1224106751992162, 0.12849811079379317, 0.13458070850712617, 0.1406582393328492,
+            0.14673047445536175, 0.15279718525844344, 0.15885814333386145, 0.16491312048996992,
+            0.17096188876030122, 0.17700422041214875, 0.18303988795514095, 0.1890686641498062,
+            0.19509032201612825, 0.2011046348420919, 0.20711137619221856, 0.21311031991609136,
+            0.2191012401568698, 0.22508391135979283, 0.2310581082806711, 0.2370236059943672,
+            0.24298017990326387, 0.24892760574572015, 0.25486565960451457, 0.2607941179152755,
+            0.26671275747489837, 0.272621355449949, 0.27851968938505306, 0.2844075372112719,
+            0.29028467725446233, 0.2961508882436238, 0.3020059493192281, 0.30784964004153487,
+            0.3136817403988915, 0.3195020308160157, 0.3253102921622629, 0.33110630575987643,
+            0.33688985339222005, 0.3426607173119944, 0.34841868024943456, 0.35416352542049034,
+            0.3598950365349881, 0.36561299780477385, 0.37131719395183754, 0.37700741021641826,
+            0.3826834323650898, 0.38834504669882625, 0.3939920400610481, 0.3996241998456468,
+            0.40524131400498986, 0.4108431710579039, 0.41642956009763715, 0.4220002707997997,
+            0.4275550934302821, 0.43309381885315196, 0.43861623853852766, 0.4441221445704292,
+            0.44961132965460654, 0.45508358712634384, 0.46053871095824, 0.4659764957679662,
+            0.47139673682599764, 0.4767992300633221, 0.4821837720791227, 0.487550160148436,
+            0.49289819222978404, 0.49822766697278187, 0.5035383837257176, 0.508830142543107,
+            0.5141027441932217, 0.5193559901655896, 0.524589682678469, 0.5298036246862946,
+            0.5349976198870972, 0.5401714727298929, 0.5453249884220465, 0.5504579729366048,
+            0.5555702330196022, 0.560661576197336, 0.5657318107836131, 0.5707807458869673,
+            0.5758081914178453, 0.5808139580957645, 0.5857978574564389, 0.5907597018588742,
+            0.5956993044924334, 0.600616479383869, 0.6055110414043255, 0.6103828062763095,
+            0.6152315905806268, 0.6200572117632891, 0.6248594881423863, 0.629638238914927,
+            0.6343932841636455, 0.6391244448637757, 0.6438315428897914, 0.6485144010221124,
+            0.6531728429537768, 0.6578066932970786, 0.6624157775901718, 0.6669999223036375,
+            0.6715589548470183, 0.6760927035753159, 0.680600997795453, 0.6850836677727004,
+            0.6895405447370668, 0.693971460889654, 0.6983762494089729, 0.7027547444572253,
+            0.7071067811865475, 0.7114321957452164, 0.7157308252838186, 0.7200025079613817,
+            0.7242470829514669, 0.7284643904482252, 0.7326542716724128, 0.7368165688773698,
+            0.7409511253549591, 0.745057785441466, 0.7491363945234593, 0.7531867990436124,
+            0.7572088465064845, 0.7612023854842618, 0.765167265622459, 0.7691033376455796,
+            0.773010453362737, 0.7768884656732324, 0.7807372285720944, 0.7845565971555752,
+            0.7883464276266062, 0.7921065773002124, 0.7958369046088835, 0.799537269107905,
+            0.8032075314806448, 0.8068475535437992, 0.8104571982525948, 0.8140363297059483,
+            0.8175848131515837, 0.8211025149911046, 0.8245893027850253, 0.8280450452577558,
+            0.8314696123025452, 0.83486287498638, 0.838224705554838, 0.8415549774368983,
+            0.844853565249707, 0.8481203448032971, 0.8513551931052652, 0.8545579883654005,
+            0.8577286100002721, 0.8608669386377673, 0.8639728561215867, 0.8670462455156926,
+            0.8700869911087113, 0.8730949784182901, 0.8760700941954066, 0.8790122264286334,
+            0.8819212643483549, 0.8847970984309378, 0.8876396204028539, 0.8904487232447579,
+            0.8932243011955153, 0.8959662497561851, 0.8986744656939538, 0.901348847046022,
+            0.9039892931234433, 0.9065957045149153, 0.9091679830905223, 0.9117060320054299,
+            0.9142097557035307, 0.9166790599210427, 0.9191138516900578, 0.9215140393420419,
+            0.9238795325112867, 0.9262102421383113, 0.9285060804732155, 0.9307669610789837,
+            0.9329927988347388, 0.9351835099389475, 0.937339011912575, 0.9394592236021899,
+            0.9415440651830208, 0.9435934581619604, 0.9456073253805213, 0.9475855910177411,
+            0.9495281805930367, 0.9514350209690083, 0.9533060403541938, 0.9551411683057707,
+            0.9569403357322089, 0.9587034748958716, 0.9604305194155658, 0.9621214042690416,
+            0.9637760657954398, 0.9653944416976894, 0.9669764710448521, 0.9685220942744173,
+            0.970031253194544, 0.9715038909862518, 0.9729399522055601, 0.9743393827855759,
+            0.9757021300385286, 0.9770281426577544, 0.9783173707196277, 0.9795697656854405,
+            0.9807852804032304, 0.9819638691095552, 0.9831054874312163, 0.984210092386929,
+            0.9852776423889412, 0.9863080972445987, 0.9873014181578584, 0.9882575677307495,
+            0.989176509964781, 0.9900582102622971, 0.99090263542778, 0.9917097536690995,
+            0.99247953459871, 0.9932119492347945, 0.9939069700023561, 0.9945645707342554,
+            0.9951847266721968, 0.9957674144676598, 0.996312612182778, 0.9968202992911657,
+            0.9972904566786902, 0.9977230666441916, 0.9981181129001492, 0.9984755805732948,
+            0.9987954562051724, 0.9990777277526454, 0.9993223845883495, 0.9995294175010931,
+            0.9996988186962042, 0.9998305817958234, 0.9999247018391445, 0.9999811752826011,
+            1.0,
+    };
+
+    // Gets cos and sin of 2 pi i / TABLE_SIZE from the quarter-wave table
+    inline void tableTwiddle(uint32_t i, double &c, double &s) {
+        constexpr uint32_t QUARTER = TABLE_SIZE / 4;
+        const uint32_t r = i % QUARTER;
+        switch (i / QUARTER) {
+        case 0:
+            c = SINE_TABLE[QUARTER - r];
+            s = SINE_TABLE[r];
+            break;
+        case 1:
+            c = -SINE_TABLE[r];
+            s = SINE_TABLE[QUARTER - r];
+            break;
+        case 2:
+            c = -SINE_TABLE[QUARTER - r];
+            s = -SINE_TABLE[r];
+            break;
+        default:
+            c = SINE_TABLE[r];
+            s = -SINE_TABLE[QUARTER - r];
+            break;
+        }
+    }
+
+    void radix2(double *data, uint32_t n, bool inverse) {
+        // Bit-reversal permutation
+        for (uint32_t i = 1, j = 0; i < n; i++) {
+            uint32_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) {
+                j ^= bit;
+            }
+            j |= bit;
+            if (i < j) {
+                double temp = data[2 * i];
+                data[2 * i] = data[2 * j];
+                data[2 * j] = temp;
+                temp = data[2 * i + 1];
+                data[2 * i + 1] = data[2 * j + 1];
+                data[2 * j + 1] = temp;
+            }
+        }
+
+        // Butterflies, with the twiddle factor in the outer loop so each one is only looked up once per pass
+        const double sign = inverse ? 1 : -1;
+        for (uint32_t half = 1; half < n; half <<= 1) {
+            const uint32_t len = half << 1;
+            for (uint32_t k = 0; k < half; k++) {
+                double wr, wi;
+                if (len <= TABLE_SIZE) {
+                    tableTwiddle(k * (TABLE_SIZE / len), wr, wi);
+                }
+                else {
+                    const double angle = 2 * PI * k / len;
+                    wr = cos(angle);
+                    wi = sin(angle);
+                }
+                wi *= sign;
+                for (uint32_t start = k; start < n; start += len) {
+                    double *u = data + 2 * start;
+                    double *v = data + 2 * (start + half);
+                    const double tr = v[0] * wr - v[1] * wi;
+                    const double ti = v[0] * wi + v[1] * wr;
+                    v[0] = u[0] - tr;
+                    v[1] = u[1] - ti;
+                    u[0] += tr;
+                    u[1] += ti;
+                }
+            }
+        }
+
+        if (inverse) {
+            const double scale = 1.0 / n;
+            for (uint32_t i = 0; i < 2 * n; i++) {
+                data[i] *= scale;
+            }
+        }
+    }
+
+    // Gets exp(sign * i pi k^2 / n), the chirp used by Bluestein's algorithm
+    inline void chirp(uint32_t k, uint32_t n, double sign, double &c, double &s) {
+        // k^2 is reduced mod 2n first so the angle stays accurate for large k
+        const double angle = PI * static_cast<double>((static_cast<uint64_t>(k) * k) % (2 * n)) / n;
+        c = cos(angle);
+        s = sign * sin(angle);
+    }
+
+    bool transform(double *data, uint32_t n, bool inverse) {
+        if ((n & (n - 1)) == 0) {
+            radix2(data, n, inverse);
+            return true;
+        }
+
+        // Bluestein's algorithm: with nk = (k^2 + n^2 - (n - k)^2) / 2, the DFT becomes a convolution with a chirp,
+        // which can be done with power-of-2 transforms of length at least 2n - 1
+        uint32_t m = 1;
+        while (m < 2 * n - 1) {
+            m <<= 1;
+        }
+        double *a = new (std::nothrow) double[4 * m];
+        if (!a) {
+            return false;
+        }
+        double *b = a + 2 * m;
+        const double sign = inverse ? 1 : -1;
+        for (uint32_t i = 0; i < 2 * m; i++) {
+            a[i] = b[i] = 0;
+        }
+        for (uint32_t k = 0; k < n; k++) {
+            double c, s;
+            chirp(k, n, sign, c, s);
+            a[2 * k] = data[2 * k] * c - data[2 * k + 1] * s;
+            a[2 * k + 1] = data[2 * k] * s + data[2 * k + 1] * c;
+            // b is the conjugate chirp, wrapped around so that the circular convolution is the linear one
+            b[2 * k] = c;
+            b[2 * k + 1] = -s;
+            if (k) {
+                b[2 * (m - k)] = c;
+                b[2 * (m - k) + 1] = -s;
+            }
+        }
+        radix2(a, m, false);
+        radix2(b, m, false);
+        for (uint32_t i = 0; i < m; i++) {
+            const double re = a[2 * i] * b[2 * i] - a[2 * i + 1] * b[2 * i + 1];
+            const double im = a[2 * i] * b[2 * i + 1] + a[2 * i + 1] * b[2 * i];
+            a[2 * i] = re;
+            a[2 * i + 1] = im;
+        }
+        radix2(a, m, true);
+        const double scale = inverse ? 1.0 / n : 1;
+        for (uint32_t k = 0; k < n; k++) {
+            double c, s;
+            chirp(k, n, sign, c, s);
+            data[2 * k] = (a[2 * k] * c - a[2 * k + 1] * s) * scale;
+            data[2 * k + 1] = (a[2 * k] * s + a[2 * k + 1] * c) * scale;
+        }
+        delete[] a;
+        return true;
+    }
+
+    bool convolve(const double *a, uint16_t na, const double *b, uint16_t nb, double *out) {
+        const uint32_t len = static_cast<uint32_t>(na) + nb - 1;
+        uint32_t m = 1;
+        while (m < len) {
+            m <<= 1;
+        }
+        // Both sequences are real, so they can share one complex transform: a in the real parts, b in the imaginary
+        double *z = new (std::nothrow) double[2 * m];
+        if (!z) {
+            return false;
+        }
+        for (uint32_t i = 0; i < m; i++) {
+            z[2 * i] = i < na ? a[i] : 0;
+            z[2 * i + 1] = i < nb ? b[i] : 0;
+        }
+        radix2(z, m, false);
+        // With Z = A + iB, A_k = (Z_k + conj(Z_m-k)) / 2 and B_k = (Z_k - conj(Z_m-k)) / 2i
+        // so A_k B_k = (Z_k^2 - conj(Z_m-k)^2) / 4i; each pair (k, m - k) is done together
+        for (uint32_t k = 0; k <= m / 2; k++) {
+            const uint32_t j = (m - k) % m;
+            const double zkr = z[2 * k], zki = z[2 * k + 1];
+            const double zjr = z[2 * j], zji = z[2 * j + 1];
+            // Z_k^2 - conj(Z_j)^2
+            const double pRe = zkr * zkr - zki * zki - (zjr * zjr - zji * zji);
+            const double pIm = 2 * zkr * zki + 2 * zjr * zji;
+            // Z_j^2 - conj(Z_k)^2
+            const double qRe = zjr * zjr - zji * zji - (zkr * zkr - zki * zki);
+            const double qIm = 2 * zjr * zji + 2 * zkr * zki;
+            // Dividing by 4i: (x + iy) / 4i = (y - ix) / 4
+            z[2 * k] = pIm / 4;
+            z[2 * k + 1] = -pRe / 4;
+            z[2 * j] = qIm / 4;
+            z[2 * j + 1] = -qRe / 4;
+        }
+        radix2(z, m, true);
+        for (uint32_t i = 0; i < len; i++) {
+            out[i] = z[2 * i];
+        }
+        delete[] z;
+        return true;
+    }
+} // namespace fft
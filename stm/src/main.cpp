@@ -18,6 +18,7 @@
 #include "lcd12864_charset.hpp"
 #include "neda.hpp"
 #include "ntoa.hpp"
+#include "rng.hpp"
 #include "sbdi.hpp"
 #include "snake.hpp"
 #include "tetris.hpp"
@@ -309,6 +310,7 @@ void drawResult(uint8_t id, bool resetLocation = true) {
     // Display the result
     neda::Container *result = new neda::Container();
     eval::toNEDAObjs(result, calcResults[id], mainExprEntry.resultSignificantDigits, asDecimal, asMixedNumber);
+    result->layout();
 
     // Set the location of the result
     if (resetLocation) {
@@ -634,15 +636,8 @@ void evaluateExpr(neda::Container *expr) {
                 // If result is valid, add the variable
                 if (result) {
                     // Create a copy since the result is shared between the history and the variable values
-                    eval::Token *value;
-                    if (result->getType() == eval::TokenType::NUMERICAL) {
-                        value = new eval::Numerical(static_cast<eval::Numerical *>(result)->value);
-                    }
-                    else {
-                        value = new eval::Matrix(*static_cast<eval::Matrix *>(result));
-                    }
-                    // Add it
-                    expr::updateVar(vName, value);
+                    // Matrix copies share their entries until one of them is modified
+                    expr::updateVar(vName, eval::copyToken(result));
                 }
                 else {
                     // Delete the variable name to avoid a memory leak
@@ -781,7 +776,10 @@ int main() {
 
     printf("Generating random seed...\n");
     int randomSeed = getRandomSeed();
-    srand(getRandomSeed());
+    // rand() is still used by the games
+    srand(randomSeed);
+    // Used by the calculator; seed() resets it to a known state
+    rng::seed(randomSeed);
     printf("Random seed: %d\n", randomSeed);
 #ifdef _USE_CONSOLE
     printf("Initializing Console...\n");
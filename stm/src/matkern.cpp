@@ -0,0 +1,150 @@
+#include "matkern.hpp"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define MATKERN_AVX2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define MATKERN_SSE2
+#endif
+
+namespace matkern {
+
+    void axpy(uint16_t len, double alpha, const double *x, uint32_t incX, double *y, uint32_t incY) {
+        uint16_t i = 0;
+        // Unroll by 4 to cut down on loop overhead
+        for (; i + 4 <= len; i += 4) {
+            y[0] += alpha * x[0];
+            y[incY] += alpha * x[incX];
+            y[2 * incY] += alpha * x[2 * incX];
+            y[3 * incY] += alpha * x[3 * incX];
+            x += 4 * incX;
+            y += 4 * incY;
+        }
+        for (; i < len; i++) {
+            *y += alpha * *x;
+            x += incX;
+            y += incY;
+        }
+    }
+
+    void scal(uint16_t len, double alpha, double *x, uint32_t incX) {
+        uint16_t i = 0;
+        for (; i + 4 <= len; i += 4) {
+            x[0] *= alpha;
+            x[incX] *= alpha;
+            x[2 * incX] *= alpha;
+            x[3 * incX] *= alpha;
+            x += 4 * incX;
+        }
+        for (; i < len; i++) {
+            *x *= alpha;
+            x += incX;
+        }
+    }
+
+    double dot(uint16_t len, const double *x, uint32_t incX, const double *y, uint32_t incY) {
+        // Separate accumulators so the additions don't all depend on each other
+        double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        uint16_t i = 0;
+        for (; i + 4 <= len; i += 4) {
+            s0 += x[0] * y[0];
+            s1 += x[incX] * y[incY];
+            s2 += x[2 * incX] * y[2 * incY];
+            s3 += x[3 * incX] * y[3 * incY];
+            x += 4 * incX;
+            y += 4 * incY;
+        }
+        for (; i < len; i++) {
+            s0 += *x * *y;
+            x += incX;
+            y += incY;
+        }
+        return (s0 + s1) + (s2 + s3);
+    }
+
+    // Stores the result of a dot product into C, taking care of alpha and beta
+    inline void store(double &c, double alpha, double sum, double beta) {
+        c = beta == 0 ? alpha * sum : alpha * sum + beta * c;
+    }
+
+#if defined(MATKERN_AVX2) || defined(MATKERN_SSE2)
+    // Block sizes, chosen so that a packed panel of B stays in L1 and the accumulators in L2
+    constexpr uint16_t BLOCK_M = 64;
+    constexpr uint16_t BLOCK_N = 128;
+    constexpr uint16_t BLOCK_K = 32;
+
+    // y[0..len) += alpha * x[0..len), both contiguous
+    inline void axpyContiguous(uint16_t len, double alpha, const double *x, double *y) {
+        uint16_t i = 0;
+#ifdef MATKERN_AVX2
+        __m256d a = _mm256_set1_pd(alpha);
+        for (; i + 4 <= len; i += 4) {
+            _mm256_storeu_pd(y + i, _mm256_fmadd_pd(a, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        }
+#else
+        __m128d a = _mm_set1_pd(alpha);
+        for (; i + 2 <= len; i += 2) {
+            _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, _mm_loadu_pd(x + i))));
+        }
+#endif
+        for (; i < len; i++) {
+            y[i] += alpha * x[i];
+        }
+    }
+
+    void gemm(uint16_t m, uint16_t n, uint16_t k, double alpha, const View &a, const View &b, double beta,
+            const View &c) {
+        // Packed panel of B and the accumulators for a block of C, both contiguous so they can be vectorized
+        const uint16_t nb = n < BLOCK_N ? n : BLOCK_N;
+        const uint16_t mb = m < BLOCK_M ? m : BLOCK_M;
+        double *panel = static_cast<double *>(malloc(sizeof(double) * BLOCK_K * nb));
+        double *acc = static_cast<double *>(malloc(sizeof(double) * mb * nb));
+
+        for (uint16_t jj = 0; jj < n; jj += BLOCK_N) {
+            const uint16_t nc = n - jj < BLOCK_N ? n - jj : BLOCK_N;
+            for (uint16_t ii = 0; ii < m; ii += BLOCK_M) {
+                const uint16_t mc = m - ii < BLOCK_M ? m - ii : BLOCK_M;
+                memset(acc, 0, sizeof(double) * mc * nc);
+
+                for (uint16_t kk = 0; kk < k; kk += BLOCK_K) {
+                    const uint16_t kc = k - kk < BLOCK_K ? k - kk : BLOCK_K;
+                    for (uint16_t p = 0; p < kc; p++) {
+                        for (uint16_t j = 0; j < nc; j++) {
+                            panel[p * nc + j] = b(kk + p, jj + j);
+                        }
+                    }
+                    // Row i of C += A(i, p) * row p of the panel
+                    for (uint16_t i = 0; i < mc; i++) {
+                        for (uint16_t p = 0; p < kc; p++) {
+                            axpyContiguous(nc, a(ii + i, kk + p), panel + p * nc, acc + i * nc);
+                        }
+                    }
+                }
+
+                for (uint16_t i = 0; i < mc; i++) {
+                    for (uint16_t j = 0; j < nc; j++) {
+                        store(c(ii + i, jj + j), alpha, acc[i * nc + j], beta);
+                    }
+                }
+            }
+        }
+
+        free(panel);
+        free(acc);
+    }
+#else
+    void gemm(uint16_t m, uint16_t n, uint16_t k, double alpha, const View &a, const View &b, double beta,
+            const View &c) {
+        // Without a cache there's nothing to gain from blocking; each entry is an unrolled strided dot product
+        for (uint16_t i = 0; i < m; i++) {
+            const double *row = &a(i, 0);
+            for (uint16_t j = 0; j < n; j++) {
+                store(c(i, j), alpha, dot(k, row, a.colStride, &b(0, j), b.rowStride), beta);
+            }
+        }
+    }
+#endif
+} // namespace matkern
@@ -39,6 +39,32 @@ namespace neda {
 	void Expr::draw(lcd::LCD12864 &dest) {
 		draw(dest, x, y);
 	}
+	void Expr::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+		layout();
+		setPosition(x, y);
+		render(dest);
+	}
+	// Default impl: Exprs without children only need their own position
+	void Expr::setPosition(int16_t x, int16_t y) {
+		this->x = x;
+		this->y = y;
+	}
+	void Expr::invalidate() {
+		dirty = true;
+		// Once a parent is dirty, so are all of its parents
+		for(Expr *ex = parent; ex && !ex->dirty; ex = ex->parent) {
+			ex->dirty = true;
+		}
+	}
+	void Expr::layout() {
+		if(!dirty) {
+			return;
+		}
+		// Children first, since the dimensions are computed from theirs
+		layoutChildren();
+		computeDimensions();
+		dirty = false;
+	}
 	// Default impl: Call the parent's cursor method, if it has one
 	void Expr::left(Expr *ex, Cursor &cursor) {
 		SAFE_EXEC(parent, left, this, cursor);
@@ -69,7 +95,7 @@ namespace neda {
 	}
 	
 	// *************************** Container ***************************************
-    void Container::computeDimensions(bool recurseParent) {
+    void Container::computeDimensions() {
 		recomputeHeights();
         // If this expression is empty, return the default values
         if(contents.length() == 0) {
@@ -122,14 +148,41 @@ namespace neda {
                 exprHeight = util::max(height, exprHeight);
             }
         }
-		
-		if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void Container::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+	void Container::layoutChildren() {
+		for(NEDAObj *ex : contents) {
+			if(ex->getType() != ObjType::CHAR_TYPE) {
+				static_cast<Expr*>(ex)->layout();
+			}
+		}
+	}
+	void Container::setPosition(int16_t x, int16_t y) {
 		this->x = x;
 		this->y = y;
+
+		for(auto it = contents.begin(); it != contents.end(); it ++) {
+			NEDAObj *ex = *it;
+			// Skip the expression if it's null
+			if(!ex) {
+				continue;
+			}
+			// Characters don't store their position, so they only take up space here
+			if(ex->getType() == ObjType::CHAR_TYPE) {
+				x += ((Character*) ex)->getWidth() + EXPR_SPACING;
+			}
+			else {
+				Expr *expr = (Expr*) ex;
+				// For each expression, its top padding is the difference between the util::max top spacing and its top spacing.
+				// E.g. A tall expression like 1^2 would have a higher top spacing than 3, so the util::max top spacing would be its top spacing;
+				// So when drawing the 1^2, there is no difference between the util::max top spacing and the top spacing, and therefore it has
+				// no top padding. But when drawing the 3, the difference between its top spacing and the util::max creates a top padding.
+				expr->setPosition(x, y + (topSpacing - expr->topSpacing));
+				// Increase x so nothing overlaps
+				x += expr->exprWidth + EXPR_SPACING;
+			}
+		}
+	}
+	void Container::render(lcd::LCD12864 &dest) {
 		VERIFY_INBOUNDS(x, y);
 
 		if(contents.length() == 0) {
@@ -145,26 +198,22 @@ namespace neda {
 			return;
 		}
 
+		// Characters are placed the same way as in setPosition()
+		int16_t charX = x;
 		for(auto it = contents.begin(); it != contents.end(); it ++) {
 			NEDAObj *ex = *it;
-			// Skip the expression if it's null
 			if(!ex) {
 				continue;
 			}
-			// For each expression, its top padding is the difference between the util::max top spacing and its top spacing.
-			// E.g. A tall expression like 1^2 would have a higher top spacing than 3, so the util::max top spacing would be its top spacing;
-			// So when drawing the 1^2, there is no difference between the util::max top spacing and the top spacing, and therefore it has
-			// no top padding. But when drawing the 3, the difference between its top spacing and the util::max creates a top padding.
 			if(ex->getType() == ObjType::CHAR_TYPE) {
 				Character *ch = (Character*) ex;
-				ch->draw(dest, x, y + (topSpacing - ch->getHeight() / 2));
-				x += ch->getWidth() + EXPR_SPACING;
+				ch->draw(dest, charX, y + (topSpacing - ch->getHeight() / 2));
+				charX += ch->getWidth() + EXPR_SPACING;
 			}
 			else {
 				Expr *expr = (Expr*) ex;
-				expr->draw(dest, x, y + (topSpacing - expr->topSpacing));
-				// Increase x so nothing overlaps
-				x += expr->exprWidth + EXPR_SPACING;
+				expr->render(dest);
+				charX += expr->exprWidth + EXPR_SPACING;
 			}
 		}
 	}
@@ -179,7 +228,7 @@ namespace neda {
             // Handle lone right brackets as well
             if(elem->getType() == ObjType::SUPERSCRIPT || elem->getType() == ObjType::SUBSCRIPT || elem->getType() == ObjType::R_BRACKET) {
                 // Make sure to not recurse on the parent as that would cause an infinite loop
-				static_cast<neda::Expr*>(elem)->computeDimensions(false);
+				static_cast<neda::Expr*>(elem)->computeDimensions();
             }
             // For left brackets, first recurse on its contents, and then call computeDimensions for the brackets
             else if(elem->getType() == ObjType::L_BRACKET) {
@@ -205,10 +254,10 @@ namespace neda {
                 // Recurse
                 recomputeHeights(start + 1, it);
                 // Compute dimensions for the brackets themselves
-                static_cast<Expr*>(elem)->computeDimensions(false);
+                static_cast<Expr*>(elem)->computeDimensions();
                 // If nesting is 0, then it landed on a right bracket
                 if(nesting == 0) {
-                    static_cast<Expr*>(*it)->computeDimensions(false);
+                    static_cast<Expr*>(*it)->computeDimensions();
                     // The for loop will increment start, thereby skipping the right bracket
                     start = it;
                 }
@@ -227,7 +276,7 @@ namespace neda {
     }
 	void Container::add(NEDAObj *expr) {
 		_add(expr);
-        computeDimensions();
+        invalidate();
 	}
 	uint16_t Container::indexOf(NEDAObj *expr) {
 		for(uint16_t i = 0; i < contents.length(); i ++) {
@@ -240,7 +289,7 @@ namespace neda {
 	NEDAObj* Container::remove(uint16_t index) {
 		NEDAObj *obj = contents[index];
 		contents.removeAt(index);
-		computeDimensions();
+		invalidate();
 		return obj;
 	}
 	void Container::addAt(uint16_t index, NEDAObj *exprToAdd) {
@@ -248,7 +297,7 @@ namespace neda {
 		if(exprToAdd->getType() != ObjType::CHAR_TYPE) {
 			((Expr*) exprToAdd)->parent = this;
 		}
-		computeDimensions();
+		invalidate();
 	}
 	Container::~Container() {
 		for(NEDAObj *ex : contents) {
@@ -439,14 +488,14 @@ namespace neda {
     }
 	void Container::addAtCursor(NEDAObj *expr, Cursor &cursor) {
 		_addAtCursor(expr, cursor);
-		computeDimensions();
+		invalidate();
 	}
 	// Returns the expression removed for deletion
 	NEDAObj* Container::removeAtCursor(Cursor &cursor) {
 		if(cursor.index != 0) {
 			NEDAObj *obj = contents[--cursor.index];
 			contents.removeAt(cursor.index);
-			computeDimensions();
+			invalidate();
 			return obj;
 		}
 		return nullptr;
@@ -473,11 +522,11 @@ namespace neda {
 		while(*str != '\0') {
 			_add(new Character(*(str++)));
 		}
-        computeDimensions();
+        invalidate();
 	}
 
 	// *************************** Fraction ***************************************
-    void Fraction::computeDimensions(bool recurseParent) {
+    void Fraction::computeDimensions() {
         // The top spacing of a fraction is equal to the height of its numerator, plus a pixel of spacing between the numerator and
 		// the fraction line.
         topSpacing = SAFE_ACCESS_0(numerator, exprHeight) + 1;
@@ -489,28 +538,34 @@ namespace neda {
         uint16_t numeratorHeight = SAFE_ACCESS_0(numerator, exprHeight);
 		uint16_t denominatorHeight = SAFE_ACCESS_0(denominator, exprHeight);
 		exprHeight = numeratorHeight + denominatorHeight + 3;
-		
-		if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void Fraction::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+	void Fraction::layoutChildren() {
+		SAFE_EXEC(numerator, layout);
+		SAFE_EXEC(denominator, layout);
+	}
+	void Fraction::setPosition(int16_t x, int16_t y) {
 		this->x = x;
 		this->y = y;
-		VERIFY_INBOUNDS(x, y);
 		// Watch out for null pointers
 		ASSERT_NONNULL(numerator);
 		ASSERT_NONNULL(denominator);
-		
-		uint16_t width = exprWidth;
+
 		// Center horizontally
-		numerator->draw(dest, x + (width - numerator->exprWidth) / 2, y);
+		numerator->setPosition(x + (exprWidth - numerator->exprWidth) / 2, y);
+		denominator->setPosition(x + (exprWidth - denominator->exprWidth) / 2, y + numerator->exprHeight + 3);
+	}
+	void Fraction::render(lcd::LCD12864 &dest) {
+		VERIFY_INBOUNDS(x, y);
+		ASSERT_NONNULL(numerator);
+		ASSERT_NONNULL(denominator);
+
+		numerator->render(dest);
 		uint16_t numHeight = numerator->exprHeight;
-		for(uint16_t i = 0; i < width; i ++) {
+		for(uint16_t i = 0; i < exprWidth; i ++) {
 			// Draw the fraction line
 			dest.setPixel(x + i, y + numHeight + 1, true);
 		}
-		denominator->draw(dest, x + (width - denominator->exprWidth) / 2, y + numHeight + 3);
+		denominator->render(dest);
 	}
 	Expr* Fraction::getNumerator() {
 		return numerator;
@@ -521,12 +576,12 @@ namespace neda {
 	void Fraction::setNumerator(Expr *numerator) {
 		this->numerator = numerator;
 		numerator->parent = this;
-		computeDimensions();
+		invalidate();
 	}
 	void Fraction::setDenominator(Expr *denominator) {
 		this->denominator = denominator;
 		denominator->parent = this;
-		computeDimensions();
+		invalidate();
 	}
 	Fraction::~Fraction() {
 		DESTROY_IF_NONNULL(numerator);
@@ -567,7 +622,7 @@ namespace neda {
 	}
 	
 	// *************************** LeftBracket ***************************************
-    void LeftBracket::computeDimensions(bool recurseParent) {
+    void LeftBracket::computeDimensions() {
         // Constant width
         exprWidth = 3;
 
@@ -650,14 +705,8 @@ namespace neda {
             exprHeight = Container::EMPTY_EXPR_HEIGHT;
         }
 
-
-		if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void LeftBracket::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
-		this->x = x;
-		this->y = y;
+	void LeftBracket::render(lcd::LCD12864 &dest) {
 		VERIFY_INBOUNDS(x, y);
 		uint16_t segmentHeight = (exprHeight - 2) / 5;
 		dest.setPixel(x + 2, y);
@@ -679,7 +728,7 @@ namespace neda {
 	}
 
 	// *************************** RightBracket ***************************************
-    void RightBracket::computeDimensions(bool recurseParent) {
+    void RightBracket::computeDimensions() {
         // Constant width
         exprWidth = 3;
 
@@ -763,14 +812,8 @@ namespace neda {
         if(exprHeight == 0) {
             exprHeight = Container::EMPTY_EXPR_HEIGHT;
         }
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void RightBracket::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
-		this->x = x;
-		this->y = y;
+	void RightBracket::render(lcd::LCD12864 &dest) {
 		VERIFY_INBOUNDS(x, y);
 
 		uint16_t segmentHeight = (exprHeight - 2) / 5;
@@ -793,7 +836,7 @@ namespace neda {
 	}
 	
 	// *************************** Radical ***************************************
-    void Radical::computeDimensions(bool recurseParent) {
+    void Radical::computeDimensions() {
         // No base
         if(!n) {
             if(contents) {
@@ -815,14 +858,26 @@ namespace neda {
             // The width is also the contents width plus the width of the base
             exprWidth =  SAFE_ACCESS_0(contents, exprWidth) + 8 + util::max(0, n->exprWidth - SIGN_N_OVERLAP);
         }
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void Radical::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+	void Radical::layoutChildren() {
+		SAFE_EXEC(contents, layout);
+		SAFE_EXEC(n, layout);
+	}
+	void Radical::setPosition(int16_t x, int16_t y) {
 		this->x = x;
 		this->y = y;
+		if(!n) {
+			ASSERT_NONNULL(contents);
+			contents->setPosition(x + 7, y + 2);
+		}
+		else {
+			n->setPosition(x, y);
+			uint16_t xoffset = util::max(0, n->exprWidth - SIGN_N_OVERLAP);
+			uint16_t yoffset = util::max(0, n->exprHeight - CONTENTS_N_OVERLAP);
+			contents->setPosition(x + 7 + xoffset, y + 2 + yoffset);
+		}
+	}
+	void Radical::render(lcd::LCD12864 &dest) {
 		VERIFY_INBOUNDS(x, y);
 		if(!n) {
 			ASSERT_NONNULL(contents);
@@ -830,28 +885,28 @@ namespace neda {
 			dest.drawLine(x + 2, y + exprHeight - 1, x + 6, y);
 			dest.drawLine(x + 6, y, x + exprWidth - 1, y);
 			
-			contents->draw(dest, x + 7, y + 2);
+			contents->render(dest);
 		}
 		else {
-			n->draw(dest, x, y);
+			n->render(dest);
 			uint16_t xoffset = util::max(0, n->exprWidth - SIGN_N_OVERLAP);
 			uint16_t yoffset = util::max(0, n->exprHeight - CONTENTS_N_OVERLAP);
 			dest.drawLine(x + xoffset, y + exprHeight - 1 - 2, x + 2 + xoffset, y + exprHeight - 1);
 			dest.drawLine(x + 2 + xoffset, y + exprHeight - 1, x + 6 + xoffset, y + yoffset);
 			dest.drawLine(x + 6 + xoffset, y + yoffset, x + exprWidth - 1, y + yoffset);
 			
-			contents->draw(dest, x + 7 + xoffset, y + 2 + yoffset);
+			contents->render(dest);
 		}
 	}
 	void Radical::setContents(Expr *contents) {
 		this->contents = contents;
 		contents->parent = this;
-		computeDimensions();
+		invalidate();
 	}
 	void Radical::setN(Expr *n) {
 		this->n = n;
 		n->parent = this;
-		computeDimensions();
+		invalidate();
 	}
 	Radical::~Radical() {
 		DESTROY_IF_NONNULL(contents);
@@ -898,7 +953,7 @@ namespace neda {
 	}
 
 	// *************************** Superscript ***************************************
-    void Superscript::computeDimensions(bool recurseParent) {
+    void Superscript::computeDimensions() {
         // Width is the same as the contents
         exprWidth = SAFE_ACCESS_0(contents, exprWidth);
         // There must be a parent container
@@ -930,20 +985,22 @@ namespace neda {
                 exprHeight = SAFE_ACCESS_0(ex, exprHeight) + SAFE_ACCESS_0(contents, exprHeight) - OVERLAP;
             }
         }
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void Superscript::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+	void Superscript::layoutChildren() {
+		SAFE_EXEC(contents, layout);
+	}
+	void Superscript::setPosition(int16_t x, int16_t y) {
 		this->x = x;
 		this->y = y;
+		SAFE_EXEC(contents, setPosition, x, y);
+	}
+	void Superscript::render(lcd::LCD12864 &dest) {
 		VERIFY_INBOUNDS(x, y);
-		SAFE_EXEC(contents, draw, dest, x, y);
+		SAFE_EXEC(contents, render, dest);
 	}
 	void Superscript::setContents(Expr *contents) {
 		this->contents = contents;
-		computeDimensions();
+		invalidate();
 	}
 	Superscript::~Superscript() {
 		DESTROY_IF_NONNULL(contents);
@@ -961,7 +1018,7 @@ namespace neda {
 	}
 	
 	// *************************** Subscript ***************************************
-    void Subscript::computeDimensions(bool recurseParent) {
+    void Subscript::computeDimensions() {
         // Width is the same as the contents
         exprWidth = SAFE_ACCESS_0(contents, exprWidth);
         // There must be a parent container
@@ -995,24 +1052,26 @@ namespace neda {
                 exprHeight = SAFE_ACCESS_0(ex, exprHeight) + SAFE_ACCESS_0(contents, exprHeight) - OVERLAP;
             }
         }
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void Subscript::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+	void Subscript::layoutChildren() {
+		SAFE_EXEC(contents, layout);
+	}
+	void Subscript::setPosition(int16_t x, int16_t y) {
 		this->x = x;
 		this->y = y;
-		VERIFY_INBOUNDS(x, y);
 		if (!contents) {
 			return;
 		}
-		contents->draw(dest, x, y + exprHeight - contents->exprHeight);
+		contents->setPosition(x, y + exprHeight - contents->exprHeight);
+	}
+	void Subscript::render(lcd::LCD12864 &dest) {
+		VERIFY_INBOUNDS(x, y);
+		SAFE_EXEC(contents, render, dest);
 	}
 	void Subscript::setContents(Expr *contents) {
 		this->contents = contents;
 		contents->parent = this;
-		computeDimensions();
+		invalidate();
 	}
 	Subscript::~Subscript() {
 		DESTROY_IF_NONNULL(contents);
@@ -1035,7 +1094,7 @@ namespace neda {
 	}
 	
 	// *************************** SigmaPi ***************************************
-    void SigmaPi::computeDimensions(bool recurseParent) {
+    void SigmaPi::computeDimensions() {
         // The top spacing of this expr can be split into two cases: when the contents are tall and when the contents are short.
 		// When the contents are tall enough, the result is simply the top spacing of the contents (b)
 		// Otherwise, it is the distance from the top to the middle of the base of the contents.
@@ -1060,15 +1119,15 @@ namespace neda {
 				+ topSpacing - a;
 		uint16_t bodyHeight = SAFE_ACCESS_0(contents, exprHeight) + topSpacing - b;
 		exprHeight = util::max(symbolHeight, bodyHeight);
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void SigmaPi::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+	void SigmaPi::layoutChildren() {
+		SAFE_EXEC(start, layout);
+		SAFE_EXEC(finish, layout);
+		SAFE_EXEC(contents, layout);
+	}
+	void SigmaPi::setPosition(int16_t x, int16_t y) {
 		this->x = x;
 		this->y = y;
-		VERIFY_INBOUNDS(x, y);
 		ASSERT_NONNULL(start);
 		ASSERT_NONNULL(finish);
 		ASSERT_NONNULL(contents);
@@ -1078,36 +1137,49 @@ namespace neda {
 				- (Container::EMPTY_EXPR_HEIGHT / 2);
 		uint16_t b = SAFE_ACCESS_0(contents, topSpacing);
 
-		// Logic same as neda::Container::draw()
+		// Logic same as neda::Container::setPosition()
 		uint16_t symbolYOffset = topSpacing - a;
 
 		uint16_t contentsYOffset = topSpacing - b;
 
 		// Center the top, the bottom and the symbol
 		uint16_t widest = util::max(start->exprWidth, util::max(finish->exprWidth, symbol.width));
-		finish->draw(dest, x + (widest - finish->exprWidth) / 2, y + symbolYOffset);
-		dest.drawImage(x + (widest - symbol.width) / 2, y + finish->exprHeight + 2 + symbolYOffset, symbol);
-		start->draw(dest, x + (widest - start->exprWidth) / 2, y + finish->exprHeight + 2 + symbol.height + 2 + symbolYOffset);
+		finish->setPosition(x + (widest - finish->exprWidth) / 2, y + symbolYOffset);
+		start->setPosition(x + (widest - start->exprWidth) / 2, y + finish->exprHeight + 2 + symbol.height + 2 + symbolYOffset);
+
+		contents->setPosition(x + widest + 3, y + contentsYOffset);
+	}
+	void SigmaPi::render(lcd::LCD12864 &dest) {
+		VERIFY_INBOUNDS(x, y);
+		ASSERT_NONNULL(start);
+		ASSERT_NONNULL(finish);
+		ASSERT_NONNULL(contents);
+
+		uint16_t widest = util::max(start->exprWidth, util::max(finish->exprWidth, symbol.width));
+		finish->render(dest);
+		// The symbol goes right below the finish
+		dest.drawImage(x + (widest - symbol.width) / 2, finish->y + finish->exprHeight + 2, symbol);
+		start->render(dest);
 
-		contents->draw(dest, x + widest + 3, y + contentsYOffset);
+		contents->render(dest);
 	}
 	void SigmaPi::setStart(Expr *start) {
 		this->start = start;
 		start->parent = this;
 		
-        computeDimensions();
+        invalidate();
 	}
 	void SigmaPi::setFinish(Expr *finish) {
 		this->finish = finish;
 		finish->parent = this;
 		
-        computeDimensions();
+        invalidate();
 	}
 	void SigmaPi::setContents(Expr *contents) {
 		this->contents = contents;
 		contents->parent = this;
 		
-        computeDimensions();
+        invalidate();
 	}
 	SigmaPi::~SigmaPi() {
 		DESTROY_IF_NONNULL(start);
@@ -1189,7 +1261,7 @@ namespace neda {
 		}
 		return colMax;
 	}
-    void Matrix::computeDimensions(bool recurseParent) {
+    void Matrix::computeDimensions() {
         // Go through every row in the top half
 		topSpacing = 0;
 		for(uint8_t i = 0; i < m / 2; i ++) {
@@ -1228,17 +1300,19 @@ namespace neda {
 		}
 		exprWidth += (n - 1) * ENTRY_SPACING;
 		exprWidth += 2 * SIDE_SPACING;
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-	void Matrix::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+	void Matrix::layoutChildren() {
+		for(uint16_t i = 0; i < m * n; i ++) {
+			SAFE_EXEC(contents[i], layout);
+		}
+	}
+	void Matrix::setPosition(int16_t x, int16_t y) {
 		this->x = x;
 		this->y = y;
-		VERIFY_INBOUNDS(x, y);
+		if(!contents) {
+			return;
+		}
 
-		// Draw contents first
 		// Cache column widths
 		uint16_t *colWidths = new uint16_t[n];
 		for(uint8_t i = 0; i < n; i ++) {
@@ -1252,18 +1326,28 @@ namespace neda {
 			uint16_t topSpacing = rowTopSpacing_0(row);
 			
 			for(uint8_t col = 0; col < n; col ++) {
-                if(contents) {
-                    uint16_t index = index_0(col, row);
-                    // Centre the expression
-                    uint16_t offset = (colWidths[col] - contents[index]->exprWidth) / 2;
-                    contents[index]->draw(dest, exprX + offset, exprY + (topSpacing - contents[index]->topSpacing));
-                }
+                uint16_t index = index_0(col, row);
+                // Centre the expression
+                uint16_t offset = (colWidths[col] - contents[index]->exprWidth) / 2;
+                contents[index]->setPosition(exprX + offset, exprY + (topSpacing - contents[index]->topSpacing));
 				exprX += colWidths[col] + ENTRY_SPACING;
 			}
 			
 			exprY += rowHeight_0(row) + ENTRY_SPACING;
 		}
 
+		delete[] colWidths;
+	}
+	void Matrix::render(lcd::LCD12864 &dest) {
+		VERIFY_INBOUNDS(x, y);
+
+		// Draw contents first
+		if(contents) {
+			for(uint16_t i = 0; i < m * n; i ++) {
+				contents[i]->render(dest);
+			}
+		}
+
 		// Draw square brackets
 		for(uint16_t i = 0; i < exprHeight; i ++) {
 			dest.setPixel(x, y + i, true);
@@ -1273,8 +1357,6 @@ namespace neda {
 		dest.setPixel(x + 1, y + exprHeight - 1, true);
 		dest.setPixel(x + exprWidth - 2, y, true);
 		dest.setPixel(x + exprWidth - 2, y + exprHeight - 1, true);
-
-		delete[] colWidths;
 	}
 	void Matrix::getCursor(Cursor &cursor, CursorLocation location) {
 		if(location == CURSORLOCATION_START) {
@@ -1357,6 +1439,7 @@ namespace neda {
 		mat->exprWidth = exprWidth;
 		mat->exprHeight = exprHeight;
         mat->topSpacing = topSpacing;
+        mat->dirty = dirty;
 		return mat;
 	}
 
@@ -1372,7 +1455,7 @@ namespace neda {
         delete[] values;
         delete[] conditions;
     }
-    void Piecewise::computeDimensions(bool recurseParent) {
+    void Piecewise::computeDimensions() {
         // Go through every row in the top half
 		topSpacing = 0;
 		for(uint8_t i = 0; i < pieces / 2; i ++) {
@@ -1409,36 +1492,47 @@ namespace neda {
         for(uint8_t i = 0; i < pieces; i ++) {
             exprHeight += util::max(SAFE_ACCESS_0(values[i], exprHeight), SAFE_ACCESS_0(conditions[i], exprHeight));
         }
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-    void Piecewise::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+    void Piecewise::layoutChildren() {
+        for(uint8_t i = 0; i < pieces; i ++) {
+            SAFE_EXEC(values[i], layout);
+            SAFE_EXEC(conditions[i], layout);
+        }
+    }
+    void Piecewise::setPosition(int16_t x, int16_t y) {
         this->x = x;
-		this->y = y;
-		VERIFY_INBOUNDS(x, y);
+        this->y = y;
 
-		// Draw contents first
-		uint16_t maxValueWidth = 0;
+        uint16_t maxValueWidth = 0;
         for(uint8_t i = 0; i < pieces; i ++) {
             maxValueWidth = util::max(maxValueWidth, static_cast<uint16_t>(SAFE_ACCESS_0(values[i], exprWidth)));
         }
 
-		// Go row-by-row
-		uint16_t exprY = y + TOP_SPACING;
-		for(uint16_t i = 0; i < pieces; i ++) {
+        // Go row-by-row
+        uint16_t exprY = y + TOP_SPACING;
+        for(uint16_t i = 0; i < pieces; i ++) {
             if(values[i] && conditions[i]) {
                 uint16_t valueTopSpacing = values[i]->topSpacing;
                 uint16_t conditionTopSpacing = conditions[i]->topSpacing;
                 uint16_t maxTopSpacing = util::max(valueTopSpacing, conditionTopSpacing);
 
-                values[i]->draw(dest, x + LEFT_SPACING, exprY + (maxTopSpacing - valueTopSpacing));
-                conditions[i]->draw(dest, x + LEFT_SPACING + maxValueWidth + VALUE_CONDITION_SPACING, exprY + (maxTopSpacing - conditionTopSpacing));
+                values[i]->setPosition(x + LEFT_SPACING, exprY + (maxTopSpacing - valueTopSpacing));
+                conditions[i]->setPosition(x + LEFT_SPACING + maxValueWidth + VALUE_CONDITION_SPACING, exprY + (maxTopSpacing - conditionTopSpacing));
 
                 exprY += util::max(values[i]->exprHeight, conditions[i]->exprHeight) + ROW_SPACING;
             }
-		}
+        }
+    }
+    void Piecewise::render(lcd::LCD12864 &dest) {
+        VERIFY_INBOUNDS(x, y);
+
+        // Draw contents first
+        for(uint16_t i = 0; i < pieces; i ++) {
+            if(values[i] && conditions[i]) {
+                values[i]->render(dest);
+                conditions[i]->render(dest);
+            }
+        }
 
         // Draw curly bracket
         // Top curl
@@ -1567,6 +1661,7 @@ namespace neda {
         other->exprWidth = exprWidth;
         other->exprHeight = exprHeight;
         other->topSpacing = topSpacing;
+        other->dirty = dirty;
         return other;
     }
 
@@ -1577,23 +1672,25 @@ namespace neda {
     Abs::~Abs() {
         DESTROY_IF_NONNULL(contents);
     }
-    void Abs::computeDimensions(bool recurseParent) {
+    void Abs::computeDimensions() {
 
         topSpacing = SAFE_ACCESS_0(contents, topSpacing) + 1;
         exprWidth = SAFE_ACCESS_0(contents, exprWidth) + 4;
         exprHeight = SAFE_ACCESS_0(contents, exprHeight) + 2;
-
-        if (recurseParent) {
-        	SAFE_EXEC(parent, computeDimensions, true);
-		}
     }
-    void Abs::draw(lcd::LCD12864 &dest, int16_t x, int16_t y) {
+    void Abs::layoutChildren() {
+        SAFE_EXEC(contents, layout);
+    }
+    void Abs::setPosition(int16_t x, int16_t y) {
         this->x = x;
         this->y = y;
+        SAFE_EXEC(contents, setPosition, x + 2, y + 1);
+    }
+    void Abs::render(lcd::LCD12864 &dest) {
         VERIFY_INBOUNDS(x, y);
 
         // Draw contents
-        SAFE_EXEC(contents, draw, dest, x + 2, y + 1);
+        SAFE_EXEC(contents, render, dest);
 
         // Draw vertical bars
         for(uint16_t i = 0; i < exprHeight; i ++) {
@@ -1648,7 +1745,7 @@ namespace neda {
         while(*str != '\0') {
             expr->_addAtCursor(new neda::Character(*str++), *this);
         }
-        expr->computeDimensions();
+        expr->invalidate();
     }
 
 	// *************************** Misc ***************************************
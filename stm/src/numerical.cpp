@@ -86,7 +86,7 @@ namespace util {
 
     Numerical &Numerical::operator=(const Fraction &frac) {
         num.i = frac.num;
-        denom.i = frac.num;
+        denom.i = frac.denom;
         _reduce();
 
         return *this;
@@ -0,0 +1,389 @@
+#include "numtheory.hpp"
+#include "sort.hpp"
+#include "util.hpp"
+#include <math.h>
+
+namespace numtheory {
+
+    // Primes used for trial division and as the Miller-Rabin bases
+    // Testing with the first 12 primes is enough for every n < 3.3 * 10^24
+    const uint8_t SMALL_PRIMES[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+    // Factors below this are found with trial division before Pollard's rho is used
+    constexpr uint16_t TRIAL_DIVISION_LIMIT = 1024;
+
+    void mul128(uint64_t a, uint64_t b, uint64_t &hi, uint64_t &lo) {
+        // Schoolbook multiplication of the 32-bit halves; each of these is a single UMULL on the M3
+        const uint64_t aLo = static_cast<uint32_t>(a), aHi = a >> 32;
+        const uint64_t bLo = static_cast<uint32_t>(b), bHi = b >> 32;
+        const uint64_t ll = aLo * bLo;
+        const uint64_t lh = aLo * bHi;
+        const uint64_t hl = aHi * bLo;
+        const uint64_t hh = aHi * bHi;
+        const uint64_t mid = (ll >> 32) + static_cast<uint32_t>(lh) + static_cast<uint32_t>(hl);
+        lo = (mid << 32) | static_cast<uint32_t>(ll);
+        hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+    }
+
+    Montgomery::Montgomery(uint64_t n) : n(n) {
+        // Newton's iteration for n^-1 mod 2^64; each step doubles the number of correct bits, starting with 3
+        uint64_t inv = n;
+        for (uint8_t i = 0; i < 5; i++) {
+            inv *= 2 - n * inv;
+        }
+        nPrime = -inv;
+        // 2^64 mod n = (2^64 - n) mod n
+        one = -n % n;
+        // Double R 64 times to get R^2
+        r2 = one;
+        for (uint8_t i = 0; i < 64; i++) {
+            r2 = addmod(r2, r2, n);
+        }
+    }
+    uint64_t Montgomery::reduce(uint64_t hi, uint64_t lo) const {
+        // m is chosen so that T + mn is divisible by R
+        const uint64_t m = lo * nPrime;
+        uint64_t mnHi, mnLo;
+        mul128(m, n, mnHi, mnLo);
+        // The low halves add up to exactly 0 or R, so only the carry is needed
+        uint64_t t = hi + mnHi;
+        bool overflow = t < hi;
+        if (lo) {
+            t++;
+            overflow |= t == 0;
+        }
+        return overflow || t >= n ? t - n : t;
+    }
+    uint64_t Montgomery::to(uint64_t a) const {
+        return mul(a % n, r2);
+    }
+    uint64_t Montgomery::from(uint64_t a) const {
+        return reduce(0, a);
+    }
+    uint64_t Montgomery::mul(uint64_t a, uint64_t b) const {
+        uint64_t hi, lo;
+        mul128(a, b, hi, lo);
+        return reduce(hi, lo);
+    }
+    uint64_t Montgomery::pow(uint64_t a, uint64_t e) const {
+        uint64_t result = one;
+        while (e) {
+            if (e & 1) {
+                result = mul(result, a);
+            }
+            a = mul(a, a);
+            e >>= 1;
+        }
+        return result;
+    }
+
+    uint64_t mulmod(uint64_t a, uint64_t b, uint64_t n) {
+        // Double-and-add, for even moduli where Montgomery multiplication doesn't work
+        uint64_t result = 0;
+        a %= n;
+        while (b) {
+            if (b & 1) {
+                result = addmod(result, a, n);
+            }
+            a = addmod(a, a, n);
+            b >>= 1;
+        }
+        return result;
+    }
+    uint64_t powmod(uint64_t a, uint64_t e, uint64_t n) {
+        if (n == 1) {
+            return 0;
+        }
+        if (n & 1) {
+            const Montgomery mont(n);
+            return mont.from(mont.pow(mont.to(a), e));
+        }
+        uint64_t result = 1;
+        a %= n;
+        while (e) {
+            if (e & 1) {
+                result = mulmod(result, a, n);
+            }
+            a = mulmod(a, a, n);
+            e >>= 1;
+        }
+        return result;
+    }
+    int64_t modinv(int64_t a, int64_t n) {
+        // Extended Euclidean algorithm, keeping only the coefficient of a
+        int64_t r0 = util::positiveMod(a, n), r1 = n;
+        int64_t s0 = 1, s1 = 0;
+        while (r1) {
+            const int64_t q = r0 / r1;
+            int64_t temp = r0 - q * r1;
+            r0 = r1;
+            r1 = temp;
+            temp = s0 - q * s1;
+            s0 = s1;
+            s1 = temp;
+        }
+        if (r0 != 1) {
+            return 0;
+        }
+        return util::positiveMod(s0, n);
+    }
+
+    bool isPrime(uint64_t n) {
+        if (n < 2) {
+            return false;
+        }
+        for (uint8_t p : SMALL_PRIMES) {
+            if (n % p == 0) {
+                return n == p;
+            }
+        }
+        // n - 1 = d * 2^s
+        uint64_t d = n - 1;
+        uint8_t s = 0;
+        while (!(d & 1)) {
+            d >>= 1;
+            s++;
+        }
+        const Montgomery mont(n);
+        const uint64_t minusOne = n - mont.one;
+        for (uint8_t p : SMALL_PRIMES) {
+            uint64_t x = mont.pow(mont.to(p), d);
+            if (x == mont.one || x == minusOne) {
+                continue;
+            }
+            bool witness = true;
+            for (uint8_t i = 1; i < s && witness; i++) {
+                x = mont.mul(x, x);
+                witness = x != minusOne;
+            }
+            if (witness) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t gcd(uint64_t a, uint64_t b) {
+        while (b) {
+            const uint64_t temp = a % b;
+            a = b;
+            b = temp;
+        }
+        return a;
+    }
+
+    /*
+     * Pollard's rho with Brent's cycle detection, for an odd composite n.
+     * The differences are multiplied together in batches so that only one gcd is needed per batch. Returns a
+     * nontrivial factor of n.
+     */
+    uint64_t pollardRho(uint64_t n) {
+        constexpr uint16_t BATCH_SIZE = 128;
+        const Montgomery mont(n);
+        // Everything stays in Montgomery form; the gcds are unaffected since R is coprime to n
+        for (uint64_t c = mont.one;; c = addmod(c, mont.one, n)) {
+            uint64_t y = c, x = y, ys = y;
+            uint64_t q = mont.one;
+            uint64_t g = 1;
+            for (uint64_t r = 1; g == 1; r <<= 1) {
+                x = y;
+                for (uint64_t i = 0; i < r; i++) {
+                    y = addmod(mont.mul(y, y), c, n);
+                }
+                for (uint64_t k = 0; k < r && g == 1; k += BATCH_SIZE) {
+                    ys = y;
+                    for (uint64_t i = 0; i < BATCH_SIZE && i < r - k; i++) {
+                        y = addmod(mont.mul(y, y), c, n);
+                        q = mont.mul(q, x > y ? x - y : y - x);
+                    }
+                    g = gcd(q, n);
+                }
+            }
+            // The batch overshot, so go back through it one step at a time
+            if (g == n) {
+                do {
+                    ys = addmod(mont.mul(ys, ys), c, n);
+                    g = gcd(x > ys ? x - ys : ys - x, n);
+                } while (g == 1);
+            }
+            if (g != n) {
+                return g;
+            }
+            // The cycle closed without finding a factor; try again with a different polynomial
+        }
+    }
+
+    // Adds the prime factors of n to factors
+    void factorInto(uint64_t n, uint64_t *factors, uint8_t &count) {
+        if (n == 1) {
+            return;
+        }
+        if (isPrime(n)) {
+            factors[count++] = n;
+            return;
+        }
+        const uint64_t d = pollardRho(n);
+        factorInto(d, factors, count);
+        factorInto(n / d, factors, count);
+    }
+
+    uint8_t factor(uint64_t n, uint64_t *factors) {
+        uint8_t count = 0;
+        if (n < 2) {
+            return 0;
+        }
+        // Small factors are quicker to find by trial division
+        while (!(n & 1)) {
+            factors[count++] = 2;
+            n >>= 1;
+        }
+        for (uint16_t p = 3; p < TRIAL_DIVISION_LIMIT && static_cast<uint64_t>(p) * p <= n; p += 2) {
+            while (n % p == 0) {
+                factors[count++] = p;
+                n /= p;
+            }
+        }
+        factorInto(n, factors, count);
+        util::insertionSort(factors, count, [](uint64_t a, uint64_t b) {
+            return a < b;
+        });
+        return count;
+    }
+
+    int64_t factorial(uint8_t n) {
+        int64_t result = 1;
+        for (uint8_t i = 2; i <= n; i++) {
+            result *= i;
+        }
+        return result;
+    }
+
+    /*
+     * A fixed-size unsigned integer, big enough for the odd part of 170!.
+     * The words are little-endian.
+     */
+    struct BigOdd {
+        static constexpr uint8_t WORDS = 32;
+
+        uint32_t words[WORDS] = {1};
+        uint8_t length = 1;
+
+        void multiply(uint32_t x) {
+            uint32_t carry = 0;
+            for (uint8_t i = 0; i < length; i++) {
+                const uint64_t product = static_cast<uint64_t>(words[i]) * x + carry;
+                words[i] = static_cast<uint32_t>(product);
+                carry = product >> 32;
+            }
+            if (carry) {
+                words[length++] = carry;
+            }
+        }
+
+        // Rounds to the nearest double, ties to even, and multiplies by 2^exp
+        double toDouble(int32_t exp) const {
+            const auto bit = [this](uint32_t i) {
+                return words[i / 32] >> (i % 32) & 1;
+            };
+            uint32_t bits = 32 * (length - 1);
+            for (uint32_t w = words[length - 1]; w; w >>= 1) {
+                bits++;
+            }
+            // Keep the top 53 bits, then round based on the bit below them and whether anything under that is set
+            const uint32_t low = bits > 53 ? bits - 53 : 0;
+            uint64_t mantissa = 0;
+            for (uint32_t i = bits; i-- > low;) {
+                mantissa = mantissa << 1 | bit(i);
+            }
+            if (low && bit(low - 1)) {
+                bool sticky = mantissa & 1;
+                for (uint32_t i = 0; i + 1 < low && !sticky; i++) {
+                    sticky = bit(i);
+                }
+                if (sticky) {
+                    mantissa++;
+                }
+            }
+            return ldexp(static_cast<double>(mantissa), exp + low);
+        }
+    };
+
+    double factorialDouble(uint32_t n) {
+        if (n > MAX_FACTORIAL) {
+            return INFINITY;
+        }
+        // The powers of 2 go straight into the exponent, and the odd parts are multiplied together exactly, a few at
+        // a time in a single word to save passes over the big number
+        BigOdd odd;
+        int32_t twos = 0;
+        uint32_t batch = 1;
+        for (uint32_t i = 3; i <= n; i++) {
+            uint32_t x = i;
+            while (!(x & 1)) {
+                x >>= 1;
+                twos++;
+            }
+            if (static_cast<uint64_t>(batch) * x > UINT32_MAX) {
+                odd.multiply(batch);
+                batch = 1;
+            }
+            batch *= x;
+        }
+        if (n >= 2) {
+            twos++;
+        }
+        odd.multiply(batch);
+        return odd.toDouble(twos);
+    }
+
+    bool binomial(int64_t n, int64_t k, int64_t &out) {
+        // Use the smaller of the two equivalent ks, so that every partial result is at most the final one
+        k = util::min(k, n - k);
+        // After step i, result = (n-k+i) C i
+        int64_t result = 1;
+        for (int64_t i = 1; i <= k; i++) {
+            // result * (n-k+i) is always divisible by i, so cancel the common factors first to keep things small
+            const int64_t g = util::gcd(result, i);
+            const int64_t num = (n - k + i) / (i / g);
+            result /= g;
+            if (result > INT64_MAX / num) {
+                return false;
+            }
+            result *= num;
+        }
+        out = result;
+        return true;
+    }
+
+    bool permutations(int64_t n, int64_t k, int64_t &out) {
+        int64_t result = 1;
+        for (int64_t i = n - k + 1; i <= n; i++) {
+            if (result > INT64_MAX / i) {
+                return false;
+            }
+            result *= i;
+        }
+        out = result;
+        return true;
+    }
+
+    // n! / (n-k)! / (k! if divideK), as a double
+    double factorialRatio(int64_t n, int64_t k, bool divideK) {
+        // Within the range of the exact factorials the result is good to a few ulps
+        if (n <= MAX_FACTORIAL) {
+            const double result = factorialDouble(n) / factorialDouble(n - k);
+            return divideK ? result / factorialDouble(k) : result;
+        }
+        // Beyond it, work with logarithms so that nothing overflows before the division
+        double ln = lgamma(n + 1.0) - lgamma(n - k + 1.0);
+        if (divideK) {
+            ln -= lgamma(k + 1.0);
+        }
+        return exp(ln);
+    }
+    double binomialDouble(int64_t n, int64_t k) {
+        return factorialRatio(n, k, true);
+    }
+    double permutationsDouble(int64_t n, int64_t k) {
+        return factorialRatio(n, k, false);
+    }
+} // namespace numtheory
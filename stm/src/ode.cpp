@@ -0,0 +1,146 @@
+#include "ode.hpp"
+#include <float.h>
+#include <math.h>
+#include <new>
+
+namespace ode {
+
+    constexpr uint8_t STAGES = 7;
+    // The Butcher tableau of the Dormand-Prince method
+    // Nodes
+    const double C[STAGES] = {0, 1.0 / 5, 3.0 / 10, 4.0 / 5, 8.0 / 9, 1, 1};
+    // The lower triangle of the coefficient matrix, one row for each stage after the first
+    // The last row is also the 5th order solution, which is why the last stage is at the new point
+    const double A[STAGES * (STAGES - 1) / 2] = {
+            1.0 / 5,
+            3.0 / 40, 9.0 / 40,
+            44.0 / 45, -56.0 / 15, 32.0 / 9,
+            19372.0 / 6561, -25360.0 / 2187, 64448.0 / 6561, -212.0 / 729,
+            9017.0 / 3168, -355.0 / 33, 46732.0 / 5247, 49.0 / 176, -5103.0 / 18656,
+            35.0 / 384, 0, 500.0 / 1113, 125.0 / 192, -2187.0 / 6784, 11.0 / 84,
+    };
+    // The difference between the 5th and 4th order weights, which gives the error estimate
+    const double E[STAGES] = {
+            71.0 / 57600, 0, -71.0 / 16695, 71.0 / 1920, -17253.0 / 339200, 22.0 / 525, -1.0 / 40,
+    };
+
+    // Limits on how much the step size can change at once
+    constexpr double MIN_FACTOR = 0.2;
+    constexpr double MAX_FACTOR = 5;
+    // Kept a bit below the predicted optimum so that fewer steps are rejected
+    constexpr double SAFETY = 0.9;
+
+    // The root mean square of v scaled by the tolerance for each component
+    double scaledNorm(const double *v, const double *y, uint16_t n, double tol) {
+        double sum = 0;
+        for (uint16_t i = 0; i < n; i++) {
+            const double scaled = v[i] / (tol + tol * fabs(y[i]));
+            sum += scaled * scaled;
+        }
+        return sqrt(sum / n);
+    }
+
+    Status integrate(System &f, uint16_t n, double &t, double tEnd, double *y, double tol, double &h) {
+        if (t == tEnd) {
+            return Status::OK;
+        }
+        // The stages, the new solution and the stage input
+        double *work = new (std::nothrow) double[(STAGES + 2) * n];
+        if (!work) {
+            return Status::ERROR;
+        }
+        double *k[STAGES];
+        for (uint8_t s = 0; s < STAGES; s++) {
+            k[s] = work + s * n;
+        }
+        double *yNew = work + STAGES * n;
+        double *yStage = yNew + n;
+
+        Status status = Status::TOO_MANY_STEPS;
+        const double dir = tEnd > t ? 1 : -1;
+        if (!f(t, y, k[0])) {
+            status = Status::ERROR;
+            goto done;
+        }
+        // Initial step size: roughly 1% of the time it takes for y to change by its own size
+        if (h == 0 || !isfinite(h)) {
+            const double d0 = scaledNorm(y, y, n, tol);
+            const double d1 = scaledNorm(k[0], y, n, tol);
+            h = d0 < 1e-5 || d1 < 1e-5 ? 1e-6 : 0.01 * d0 / d1;
+        }
+        h = dir * fabs(h);
+
+        for (uint16_t step = 0; step < MAX_STEPS; step++) {
+            // Don't step past the end
+            const bool last = fabs(h) >= fabs(tEnd - t);
+            const double hStep = last ? tEnd - t : h;
+            if (!last && fabs(hStep) <= 16 * DBL_EPSILON * fabs(t) + DBL_MIN) {
+                status = Status::STEP_TOO_SMALL;
+                break;
+            }
+
+            const double *a = A;
+            for (uint8_t s = 1; s < STAGES; s++) {
+                double *out = s == STAGES - 1 ? yNew : yStage;
+                for (uint16_t i = 0; i < n; i++) {
+                    double sum = 0;
+                    for (uint8_t j = 0; j < s; j++) {
+                        sum += a[j] * k[j][i];
+                    }
+                    out[i] = y[i] + hStep * sum;
+                }
+                a += s;
+                if (!f(t + C[s] * hStep, out, k[s])) {
+                    status = Status::ERROR;
+                    goto done;
+                }
+            }
+
+            // Estimate the local error, scaled by the larger of the old and new solution for each component
+            double errSum = 0;
+            for (uint16_t i = 0; i < n; i++) {
+                double err = 0;
+                for (uint8_t s = 0; s < STAGES; s++) {
+                    err += E[s] * k[s][i];
+                }
+                const double scaled = hStep * err / (tol + tol * fmax(fabs(y[i]), fabs(yNew[i])));
+                errSum += scaled * scaled;
+            }
+            const double errNorm = sqrt(errSum / n);
+            // The error is O(h^5), so this is the step size that would have just met the tolerance
+            // A NaN error (e.g. f blew up somewhere in the step) is treated like a very large one
+            double factor = errNorm == 0 ? MAX_FACTOR : SAFETY * pow(errNorm, -0.2);
+            factor = !(factor > MIN_FACTOR) ? MIN_FACTOR : factor > MAX_FACTOR ? MAX_FACTOR : factor;
+
+            if (errNorm <= 1) {
+                // Accept the step
+                t = last ? tEnd : t + hStep;
+                for (uint16_t i = 0; i < n; i++) {
+                    y[i] = yNew[i];
+                }
+                // The last stage is f at the new point
+                double *tmp = k[0];
+                k[0] = k[STAGES - 1];
+                k[STAGES - 1] = tmp;
+
+                if (last) {
+                    // A shortened last step doesn't say anything about whether the full step would have grown
+                    if (fabs(hStep * factor) < fabs(h)) {
+                        h = hStep * factor;
+                    }
+                    status = Status::OK;
+                    break;
+                }
+                h = hStep * factor;
+            }
+            else {
+                // Reject the step and try again with a smaller one
+                h = hStep * factor;
+            }
+        }
+
+    done:
+        delete[] work;
+        return status;
+    }
+} // namespace ode
@@ -0,0 +1,292 @@
+#include "optim.hpp"
+#include <math.h>
+#include <new>
+
+namespace optim {
+
+    // (3 - sqrt(5)) / 2, the fraction of the interval golden section search steps into
+    constexpr double GOLDEN_SECTION = 0.3819660112501051;
+
+    // Evaluates f, counting the evaluation
+    // NaNs are treated as infinity so that they always compare as worse than any other value
+    inline bool evaluate(Objective &f, const double *x, double &fx, uint16_t &evaluations) {
+        ++evaluations;
+        if (!f(x, fx)) {
+            return false;
+        }
+        if (isnan(fx)) {
+            fx = INFINITY;
+        }
+        return true;
+    }
+
+    Status brent(Objective &f, double a, double b, double tol, double &x, double &fx, uint16_t &evaluations) {
+        if (a > b) {
+            const double tmp = a;
+            a = b;
+            b = tmp;
+        }
+        evaluations = 0;
+        // x is the best point so far, w the second best, and v the previous value of w
+        x = a + GOLDEN_SECTION * (b - a);
+        if (!evaluate(f, &x, fx, evaluations)) {
+            return Status::ERROR;
+        }
+        double w = x, v = x;
+        double fw = fx, fv = fx;
+        // The size of the last step, and of the one before it
+        double d = 0, e = 0;
+
+        for (uint16_t iter = 0; iter < BRENT_MAX_ITERATIONS; iter++) {
+            const double mid = (a + b) / 2;
+            const double tol1 = tol * (fabs(x) + 1);
+            const double tol2 = 2 * tol1;
+            if (fabs(x - mid) <= tol2 - (b - a) / 2) {
+                return Status::OK;
+            }
+
+            bool golden = true;
+            if (fabs(e) > tol1) {
+                // Fit a parabola through x, w and v, and step to its minimum
+                const double r = (x - w) * (fx - fv);
+                double q = (x - v) * (fx - fw);
+                double p = (x - v) * q - (x - w) * r;
+                q = 2 * (q - r);
+                if (q > 0) {
+                    p = -p;
+                }
+                q = fabs(q);
+                const double prevE = e;
+                e = d;
+                // Only take the step if it is in the interval and smaller than half the step before last
+                // Otherwise the parabola is not a good fit, and the iteration could stall
+                if (fabs(p) < fabs(q * prevE / 2) && p > q * (a - x) && p < q * (b - x)) {
+                    d = p / q;
+                    const double u = x + d;
+                    // Don't evaluate too close to the ends
+                    if (u - a < tol2 || b - u < tol2) {
+                        d = mid > x ? tol1 : -tol1;
+                    }
+                    golden = false;
+                }
+            }
+            if (golden) {
+                // Golden section step into the larger of the two parts of the interval
+                e = x >= mid ? a - x : b - x;
+                d = GOLDEN_SECTION * e;
+            }
+
+            // Never take a step smaller than the tolerance, since f wouldn't be able to tell the points apart
+            const double u = fabs(d) >= tol1 ? x + d : x + (d > 0 ? tol1 : -tol1);
+            double fu;
+            if (!evaluate(f, &u, fu, evaluations)) {
+                return Status::ERROR;
+            }
+
+            // Narrow the interval and update the points
+            if (fu <= fx) {
+                if (u >= x) {
+                    a = x;
+                }
+                else {
+                    b = x;
+                }
+                v = w;
+                fv = fw;
+                w = x;
+                fw = fx;
+                x = u;
+                fx = fu;
+            }
+            else {
+                if (u < x) {
+                    a = u;
+                }
+                else {
+                    b = u;
+                }
+                if (fu <= fw || w == x) {
+                    v = w;
+                    fv = fw;
+                    w = u;
+                    fw = fu;
+                }
+                else if (fu <= fv || v == x || v == w) {
+                    v = u;
+                    fv = fu;
+                }
+            }
+        }
+        return Status::NOT_CONVERGED;
+    }
+
+    Status nelderMead(Objective &f, uint16_t n, double *x, double tol, double &fx, uint16_t &evaluations) {
+        // The n + 1 vertices of the simplex and their values, the centroid, and two trial points
+        double *work = new (std::nothrow) double[(n + 1) * (n + 1) + 3 * n];
+        if (!work) {
+            return Status::ERROR;
+        }
+        double *simplex = work;
+        double *values = simplex + (n + 1) * n;
+        double *centroid = values + n + 1;
+        double *trial = centroid + n;
+        double *trial2 = trial + n;
+        const uint32_t maxEvaluations = static_cast<uint32_t>(NELDER_MEAD_MAX_EVALUATIONS) * n;
+
+        evaluations = 0;
+        Status status = Status::NOT_CONVERGED;
+        // Start with x and a step of 5% along each axis
+        for (uint16_t i = 0; i <= n; i++) {
+            double *vertex = simplex + i * n;
+            for (uint16_t j = 0; j < n; j++) {
+                vertex[j] = x[j];
+            }
+            if (i) {
+                vertex[i - 1] += x[i - 1] != 0 ? 0.05 * x[i - 1] : 0.00025;
+            }
+            if (!evaluate(f, vertex, values[i], evaluations)) {
+                status = Status::ERROR;
+                goto done;
+            }
+        }
+
+        while (evaluations < maxEvaluations && evaluations < 0xFFFF - n) {
+            // Find the best, worst and second worst vertices
+            uint16_t best = 0, worst = 0, second = 0;
+            for (uint16_t i = 1; i <= n; i++) {
+                if (values[i] < values[best]) {
+                    best = i;
+                }
+                if (values[i] > values[worst]) {
+                    worst = i;
+                }
+            }
+            // If every value is the same, any other vertex can be the worst
+            if (worst == best) {
+                worst = best ? 0 : 1;
+            }
+            second = best;
+            for (uint16_t i = 0; i <= n; i++) {
+                if (i != worst && values[i] > values[second]) {
+                    second = i;
+                }
+            }
+
+            // Check if the simplex is small enough, both in size and in the spread of the values
+            const double *bestVertex = simplex + best * n;
+            bool converged = true;
+            for (uint16_t i = 0; i <= n && converged; i++) {
+                if (fabs(values[i] - values[best]) > tol) {
+                    converged = false;
+                }
+                for (uint16_t j = 0; j < n && converged; j++) {
+                    if (fabs(simplex[i * n + j] - bestVertex[j]) > tol * fmax(1, fabs(bestVertex[j]))) {
+                        converged = false;
+                    }
+                }
+            }
+            if (converged) {
+                status = Status::OK;
+                break;
+            }
+
+            // Reflect the worst vertex through the centroid of the others
+            double *worstVertex = simplex + worst * n;
+            for (uint16_t j = 0; j < n; j++) {
+                double sum = 0;
+                for (uint16_t i = 0; i <= n; i++) {
+                    if (i != worst) {
+                        sum += simplex[i * n + j];
+                    }
+                }
+                centroid[j] = sum / n;
+                trial[j] = 2 * centroid[j] - worstVertex[j];
+            }
+            double fTrial;
+            if (!evaluate(f, trial, fTrial, evaluations)) {
+                status = Status::ERROR;
+                goto done;
+            }
+
+            bool accept = true;
+            if (fTrial < values[best]) {
+                // The reflection is the new best, so try going twice as far
+                for (uint16_t j = 0; j < n; j++) {
+                    trial2[j] = 3 * centroid[j] - 2 * worstVertex[j];
+                }
+                double fTrial2;
+                if (!evaluate(f, trial2, fTrial2, evaluations)) {
+                    status = Status::ERROR;
+                    goto done;
+                }
+                if (fTrial2 < fTrial) {
+                    double *tmp = trial;
+                    trial = trial2;
+                    trial2 = tmp;
+                    fTrial = fTrial2;
+                }
+            }
+            else if (fTrial >= values[second]) {
+                // The reflection would still be the worst, so contract towards the centroid instead
+                // Contract on the side of the reflection if it improved on the worst vertex, otherwise on the inside
+                const bool outside = fTrial < values[worst];
+                for (uint16_t j = 0; j < n; j++) {
+                    trial2[j] = (centroid[j] + (outside ? trial[j] : worstVertex[j])) / 2;
+                }
+                double fTrial2;
+                if (!evaluate(f, trial2, fTrial2, evaluations)) {
+                    status = Status::ERROR;
+                    goto done;
+                }
+                if (fTrial2 < (outside ? fTrial : values[worst])) {
+                    double *tmp = trial;
+                    trial = trial2;
+                    trial2 = tmp;
+                    fTrial = fTrial2;
+                }
+                else {
+                    // Nothing worked, so shrink the whole simplex towards the best vertex
+                    accept = false;
+                    for (uint16_t i = 0; i <= n; i++) {
+                        if (i == best) {
+                            continue;
+                        }
+                        double *vertex = simplex + i * n;
+                        for (uint16_t j = 0; j < n; j++) {
+                            vertex[j] = (vertex[j] + bestVertex[j]) / 2;
+                        }
+                        if (!evaluate(f, vertex, values[i], evaluations)) {
+                            status = Status::ERROR;
+                            goto done;
+                        }
+                    }
+                }
+            }
+
+            if (accept) {
+                for (uint16_t j = 0; j < n; j++) {
+                    worstVertex[j] = trial[j];
+                }
+                values[worst] = fTrial;
+            }
+        }
+
+        // Return the best vertex, even if the iteration didn't converge
+        {
+            uint16_t best = 0;
+            for (uint16_t i = 1; i <= n; i++) {
+                if (values[i] < values[best]) {
+                    best = i;
+                }
+            }
+            for (uint16_t j = 0; j < n; j++) {
+                x[j] = simplex[best * n + j];
+            }
+            fx = values[best];
+        }
+
+    done:
+        delete[] work;
+        return status;
+    }
+} // namespace optim
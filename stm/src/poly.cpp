@@ -0,0 +1,136 @@
+#include "poly.hpp"
+#include "sort.hpp"
+#include <float.h>
+#include <math.h>
+
+namespace poly {
+
+    constexpr double PI = 3.14159265358979323846;
+
+    constexpr uint8_t ROOTS_MAX_ITERATIONS = 128;
+
+    double evaluate(const double *c, uint16_t n, double x) {
+        if (!n) {
+            return 0;
+        }
+        double result = c[n - 1];
+        for (uint16_t i = n - 1; i-- > 0;) {
+            result = result * x + c[i];
+        }
+        return result;
+    }
+
+    void derivative(const double *c, uint16_t n, double *out) {
+        for (uint16_t i = 1; i < n; i++) {
+            out[i - 1] = c[i] * i;
+        }
+    }
+
+    void multiply(const double *a, uint16_t na, const double *b, uint16_t nb, double *out) {
+        for (uint16_t i = 0; i < na + nb - 1; i++) {
+            out[i] = 0;
+        }
+        for (uint16_t i = 0; i < na; i++) {
+            for (uint16_t j = 0; j < nb; j++) {
+                out[i + j] += a[i] * b[j];
+            }
+        }
+    }
+
+    inline Complex operator-(const Complex &a, const Complex &b) {
+        return {a.re - b.re, a.im - b.im};
+    }
+    inline Complex operator*(const Complex &a, const Complex &b) {
+        return {a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+    }
+    inline Complex operator/(const Complex &a, const Complex &b) {
+        const double denom = b.re * b.re + b.im * b.im;
+        return {(a.re * b.re + a.im * b.im) / denom, (a.im * b.re - a.re * b.im) / denom};
+    }
+    inline double abs(const Complex &z) {
+        return hypot(z.re, z.im);
+    }
+
+    bool roots(const double *c, uint16_t n, Complex *out) {
+        Complex *const all = out;
+        const uint16_t count = n - 1;
+        // Zero constant terms are factors of x, which are roots at exactly 0
+        while (n > 1 && c[0] == 0) {
+            *out++ = {0, 0};
+            c++;
+            n--;
+        }
+        const uint16_t degree = n - 1;
+        if (!degree) {
+            return true;
+        }
+
+        // Start evenly spaced on a circle with the radius of the geometric mean of the roots
+        // The offset keeps the starting points off the real axis, where they would stay for a real polynomial
+        const double radius = pow(fabs(c[0] / c[degree]), 1.0 / degree);
+        for (uint16_t k = 0; k < degree; k++) {
+            const double angle = 2 * PI * k / degree + 0.4;
+            out[k] = {radius * cos(angle), radius * sin(angle)};
+        }
+
+        // The iteration is done in place (Gauss-Seidel style), and roots stop being updated once they have converged
+        bool converged = false;
+        for (uint8_t iter = 0; iter < ROOTS_MAX_ITERATIONS && !converged; iter++) {
+            converged = true;
+            for (uint16_t k = 0; k < degree; k++) {
+                Complex &z = out[k];
+                // p(z) and p'(z) together with Horner's scheme, along with a bound on the rounding error of p(z)
+                const double absZ = abs(z);
+                Complex p = {c[degree], 0};
+                Complex dp = {0, 0};
+                double bound = fabs(c[degree]);
+                for (uint16_t i = degree; i-- > 0;) {
+                    dp = dp * z;
+                    dp.re += p.re;
+                    dp.im += p.im;
+                    p = p * z;
+                    p.re += c[i];
+                    bound = bound * absZ + fabs(c[i]);
+                }
+                // Once p(z) is within rounding error of 0, the root is as good as it can get
+                if (abs(p) <= 8 * DBL_EPSILON * bound) {
+                    continue;
+                }
+
+                // The Newton step, corrected by the pull of all the other roots
+                const Complex ratio = p / dp;
+                Complex sum = {0, 0};
+                for (uint16_t j = 0; j < degree; j++) {
+                    if (j != k) {
+                        const Complex term = Complex{1, 0} / (z - out[j]);
+                        sum.re += term.re;
+                        sum.im += term.im;
+                    }
+                }
+                const Complex w = ratio / (Complex{1, 0} - ratio * sum);
+                if (!isfinite(w.re) || !isfinite(w.im)) {
+                    return false;
+                }
+                z = z - w;
+                if (abs(w) > DBL_EPSILON * abs(z)) {
+                    converged = false;
+                }
+            }
+        }
+
+        // Clean up parts that are only rounding errors, so that real roots come out as exactly real
+        for (uint16_t k = 0; k < degree; k++) {
+            const double absZ = abs(out[k]);
+            if (fabs(out[k].im) <= 8 * DBL_EPSILON * absZ) {
+                out[k].im = 0;
+            }
+            if (fabs(out[k].re) <= 8 * DBL_EPSILON * absZ) {
+                out[k].re = 0;
+            }
+        }
+        util::insertionSort(all, count, [](const Complex &a, const Complex &b) {
+            return a.re < b.re || (a.re == b.re && a.im < b.im);
+        });
+        return converged;
+    }
+} // namespace poly
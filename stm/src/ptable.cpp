@@ -1,6 +1,9 @@
 #include "ptable.hpp"
+#include "lookup.hpp"
 #include "ntoa.hpp"
 #include <ctype.h>
+#include <math.h>
+#include <string.h>
 
 namespace pt {
 
@@ -236,72 +239,165 @@ namespace pt {
         }
     }
 
+    const Element *elemWithIndex(const ElementIndex &index) {
+        return &ELEMENTS[index.period][index.index];
+    }
+
     const Element *searchElemByNumber(Location &locationOut, uint8_t atomicNumber) {
-        if (atomicNumber == 0) {
+        if (atomicNumber == 0 || atomicNumber > ELEMENT_COUNT) {
             return nullptr;
         }
-        for (uint8_t i = 0; i < PERIOD_COUNT; i++) {
-            // See how many elements are at the end of this period
-            // Check if that exceeds the number we're looking for
-            const Element &lastElem = ELEMENTS[i][ELEMENTS_LENGTHS[i] - 1];
-            if (lastElem.protons >= atomicNumber) {
-                const Element *result = &ELEMENTS[i][ELEMENTS_LENGTHS[i] - 1 - (lastElem.protons - atomicNumber)];
-                locationOut.x = result->group;
-                locationOut.y = i + 1;
-                return result;
+        const ElementIndex &index = ELEMENTS_BY_NUMBER[atomicNumber - 1];
+        const Element *result = elemWithIndex(index);
+        locationOut.x = result->group;
+        locationOut.y = index.period + 1;
+        return result;
+    }
+
+    // Finds the first entry in the index whose field compares greater than or equal to the prefix,
+    // or only greater if after is true
+    uint8_t lowerBound(const ElementIndex *index, const char *(*field)(const Element *), const char *str, uint16_t len,
+            bool after) {
+        uint8_t lo = 0, hi = ELEMENT_COUNT;
+        while (lo < hi) {
+            const uint8_t mid = (lo + hi) / 2;
+            const int cmp = lookup::comparePrefix(field(elemWithIndex(index[mid])), str, len);
+            if (cmp < 0 || (after && cmp == 0)) {
+                lo = mid + 1;
+            }
+            else {
+                hi = mid;
             }
         }
-        // Nothing found
-        return nullptr;
+        return lo;
     }
 
-    const Element *searchElemByString(
-            Location &locationOut, const char *(*field)(const Element *), const char *str, uint16_t len) {
-        // Keep track of the element we found
-        const Element *elemFound = nullptr;
-        for (uint8_t i = 0; i < PERIOD_COUNT; i++) {
-            for (uint8_t j = 0; j < ELEMENTS_LENGTHS[i]; j++) {
-                const Element *elem = &ELEMENTS[i][j];
-                // Compare char by char
-                bool match = true;
-                uint8_t k;
-                for (k = 0; k < len && str[k] != '\0' && field(elem)[k] != '\0'; k++) {
-                    // Case insensitive search
-                    if (tolower(str[k]) != tolower(field(elem)[k])) {
-                        match = false;
-                        break;
-                    }
-                }
-
-                // If matching - check if perfect match
-                if (match) {
-                    // Check that the two strings both ended
-                    if (field(elem)[k] == '\0' && (k == len || str[k] == '\0')) {
-                        // If perfect match, return the match
-                        locationOut.x = elem->group;
-                        locationOut.y = i + 1;
-                        return elem;
-                    }
-                    else if (k == len || str[k] == '\0') {
-                        // If only partial match, set the element found if it's not already set
-                        if (!elemFound) {
-                            elemFound = elem;
-                            locationOut.x = elem->group;
-                            locationOut.y = i + 1;
-                        }
-                    }
+    const Element *searchElemByString(Location &locationOut, const ElementIndex *index,
+            const char *(*field)(const Element *), const char *str, uint16_t len) {
+        // The string can end before len
+        uint16_t strLen = 0;
+        while (strLen < len && str[strLen] != '\0') {
+            ++strLen;
+        }
+        len = strLen;
+        // All the matches are together in the index
+        const uint8_t first = lowerBound(index, field, str, len, false);
+        const uint8_t last = lowerBound(index, field, str, len, true);
+        if (first == last) {
+            return nullptr;
+        }
+        // A perfect match would be the shortest, so it would come first
+        uint8_t found = first;
+        if (field(elemWithIndex(index[first]))[len] != '\0') {
+            // Otherwise use the lowest numbered partial match
+            for (uint8_t i = first + 1; i < last; i++) {
+                if (elemWithIndex(index[i])->protons < elemWithIndex(index[found])->protons) {
+                    found = i;
                 }
             }
         }
-        // Return the element we found or nullptr if not even a partial match was found
-        return elemFound;
+        const Element *elem = elemWithIndex(index[found]);
+        locationOut.x = elem->group;
+        locationOut.y = index[found].period + 1;
+        return elem;
     }
 
     const Element *searchElemBySymbol(Location &locationOut, const char *str, uint16_t len) {
-        return searchElemByString(locationOut, [](const Element *x) { return x->symbol; }, str, len);
+        return searchElemByString(locationOut, ELEMENTS_BY_SYMBOL, [](const Element *x) { return x->symbol; }, str, len);
     }
 
     const Element *searchElemByName(Location &locationOut, const char *str, uint16_t len) {
-        return searchElemByString(locationOut, [](const Element *x) { return x->name; }, str, len);
+        return searchElemByString(locationOut, ELEMENTS_BY_NAME, [](const Element *x) { return x->name; }, str, len);
+    }
+
+    // The most levels of nested brackets in a formula
+    constexpr uint8_t MAX_FORMULA_DEPTH = 8;
+
+    // Reads a count after an element or a bracket, which is 1 if there is none
+    uint16_t parseCount(const char *&str) {
+        if (!isdigit(*str)) {
+            return 1;
+        }
+        uint16_t count = 0;
+        while (isdigit(*str)) {
+            // Too big to be a real formula
+            if (count > 999) {
+                return 0;
+            }
+            count = count * 10 + (*str++ - '0');
+        }
+        return count;
+    }
+
+    double molarMass(const char *formula) {
+        // The mass of each level of brackets so far
+        double mass[MAX_FORMULA_DEPTH + 1] = {0};
+        uint8_t depth = 0;
+        // The mass of the previous parts of an addition compound (e.g. CuSO4*5H2O), and the count of the current part
+        double total = 0;
+        uint16_t partCount = parseCount(formula);
+        if (partCount == 0 || *formula == '\0') {
+            return NAN;
+        }
+
+        while (*formula != '\0') {
+            const char ch = *formula;
+            if (ch == '(' || ch == '[') {
+                if (++depth > MAX_FORMULA_DEPTH) {
+                    return NAN;
+                }
+                mass[depth] = 0;
+                ++formula;
+            }
+            else if (ch == ')' || ch == ']') {
+                if (depth == 0) {
+                    return NAN;
+                }
+                ++formula;
+                const uint16_t count = parseCount(formula);
+                if (count == 0) {
+                    return NAN;
+                }
+                --depth;
+                mass[depth] += mass[depth + 1] * count;
+            }
+            else if (isupper(ch)) {
+                // The symbol is the capital letter and any lowercase letters after it
+                uint8_t len = 1;
+                while (islower(formula[len])) {
+                    ++len;
+                }
+                // Symbols are unique ignoring case, so the exact match is at the start of the range if it exists
+                const uint8_t i = lowerBound(ELEMENTS_BY_SYMBOL, [](const Element *x) { return x->symbol; }, formula,
+                        len, false);
+                const Element *elem = i < ELEMENT_COUNT ? elemWithIndex(ELEMENTS_BY_SYMBOL[i]) : nullptr;
+                if (!elem || strncmp(elem->symbol, formula, len) != 0 || elem->symbol[len] != '\0') {
+                    return NAN;
+                }
+                formula += len;
+                const uint16_t count = parseCount(formula);
+                if (count == 0) {
+                    return NAN;
+                }
+                mass[depth] += elem->mass * count;
+            }
+            else if ((ch == '*' || ch == '.' || ch == LCD_CHAR_MUL) && depth == 0) {
+                // Start of the next part of an addition compound, which can have a count in front
+                ++formula;
+                total += mass[0] * partCount;
+                mass[0] = 0;
+                partCount = parseCount(formula);
+                if (partCount == 0 || *formula == '\0') {
+                    return NAN;
+                }
+            }
+            else {
+                return NAN;
+            }
+        }
+        if (depth != 0) {
+            return NAN;
+        }
+        return total + mass[0] * partCount;
     }
 } // namespace pt
@@ -1915,4 +1915,369 @@ namespace pt {
 			130,
 		},
 	};
+
+	const ElementIndex ELEMENTS_BY_NUMBER[] = {
+		{ 0, 0 }, // H
+		{ 0, 1 }, // He
+		{ 1, 0 }, // Li
+		{ 1, 1 }, // Be
+		{ 1, 2 }, // B
+		{ 1, 3 }, // C
+		{ 1, 4 }, // N
+		{ 1, 5 }, // O
+		{ 1, 6 }, // F
+		{ 1, 7 }, // Ne
+		{ 2, 0 }, // Na
+		{ 2, 1 }, // Mg
+		{ 2, 2 }, // Al
+		{ 2, 3 }, // Si
+		{ 2, 4 }, // P
+		{ 2, 5 }, // S
+		{ 2, 6 }, // Cl
+		{ 2, 7 }, // Ar
+		{ 3, 0 }, // K
+		{ 3, 1 }, // Ca
+		{ 3, 2 }, // Sc
+		{ 3, 3 }, // Ti
+		{ 3, 4 }, // V
+		{ 3, 5 }, // Cr
+		{ 3, 6 }, // Mn
+		{ 3, 7 }, // Fe
+		{ 3, 8 }, // Co
+		{ 3, 9 }, // Ni
+		{ 3, 10 }, // Cu
+		{ 3, 11 }, // Zn
+		{ 3, 12 }, // Ga
+		{ 3, 13 }, // Ge
+		{ 3, 14 }, // As
+		{ 3, 15 }, // Se
+		{ 3, 16 }, // Br
+		{ 3, 17 }, // Kr
+		{ 4, 0 }, // Rb
+		{ 4, 1 }, // Sr
+		{ 4, 2 }, // Y
+		{ 4, 3 }, // Zr
+		{ 4, 4 }, // Nb
+		{ 4, 5 }, // Mo
+		{ 4, 6 }, // Tc
+		{ 4, 7 }, // Ru
+		{ 4, 8 }, // Rh
+		{ 4, 9 }, // Pd
+		{ 4, 10 }, // Ag
+		{ 4, 11 }, // Cd
+		{ 4, 12 }, // In
+		{ 4, 13 }, // Sn
+		{ 4, 14 }, // Sb
+		{ 4, 15 }, // Te
+		{ 4, 16 }, // I
+		{ 4, 17 }, // Xe
+		{ 5, 0 }, // Cs
+		{ 5, 1 }, // Ba
+		{ 8, 0 }, // La
+		{ 8, 1 }, // Ce
+		{ 8, 2 }, // Pr
+		{ 8, 3 }, // Nd
+		{ 8, 4 }, // Pm
+		{ 8, 5 }, // Sm
+		{ 8, 6 }, // Eu
+		{ 8, 7 }, // Gd
+		{ 8, 8 }, // Tb
+		{ 8, 9 }, // Dy
+		{ 8, 10 }, // Ho
+		{ 8, 11 }, // Er
+		{ 8, 12 }, // Tm
+		{ 8, 13 }, // Yb
+		{ 8, 14 }, // Lu
+		{ 5, 2 }, // Hf
+		{ 5, 3 }, // Ta
+		{ 5, 4 }, // W
+		{ 5, 5 }, // Re
+		{ 5, 6 }, // Os
+		{ 5, 7 }, // Ir
+		{ 5, 8 }, // Pt
+		{ 5, 9 }, // Au
+		{ 5, 10 }, // Hg
+		{ 5, 11 }, // Tl
+		{ 5, 12 }, // Pb
+		{ 5, 13 }, // Bi
+		{ 5, 14 }, // Po
+		{ 5, 15 }, // At
+		{ 5, 16 }, // Rn
+		{ 6, 0 }, // Fr
+		{ 6, 1 }, // Ra
+		{ 9, 0 }, // Ac
+		{ 9, 1 }, // Th
+		{ 9, 2 }, // Pa
+		{ 9, 3 }, // U
+		{ 9, 4 }, // Np
+		{ 9, 5 }, // Pu
+		{ 9, 6 }, // Am
+		{ 9, 7 }, // Cm
+		{ 9, 8 }, // Bk
+		{ 9, 9 }, // Cf
+		{ 9, 10 }, // Es
+		{ 9, 11 }, // Fm
+		{ 9, 12 }, // Md
+		{ 9, 13 }, // No
+		{ 9, 14 }, // Lr
+		{ 6, 2 }, // Rf
+		{ 6, 3 }, // Db
+		{ 6, 4 }, // Sg
+		{ 6, 5 }, // Bh
+		{ 6, 6 }, // Hs
+		{ 6, 7 }, // Mt
+		{ 6, 8 }, // Ds
+		{ 6, 9 }, // Rg
+		{ 6, 10 }, // Cn
+		{ 6, 11 }, // Nh
+		{ 6, 12 }, // Fl
+		{ 6, 13 }, // Mc
+		{ 6, 14 }, // Lv
+		{ 6, 15 }, // Ts
+		{ 6, 16 }, // Og
+	};
+
+	const ElementIndex ELEMENTS_BY_SYMBOL[] = {
+		{ 9, 0 }, // Ac
+		{ 4, 10 }, // Ag
+		{ 2, 2 }, // Al
+		{ 9, 6 }, // Am
+		{ 2, 7 }, // Ar
+		{ 3, 14 }, // As
+		{ 5, 15 }, // At
+		{ 5, 9 }, // Au
+		{ 1, 2 }, // B
+		{ 5, 1 }, // Ba
+		{ 1, 1 }, // Be
+		{ 6, 5 }, // Bh
+		{ 5, 13 }, // Bi
+		{ 9, 8 }, // Bk
+		{ 3, 16 }, // Br
+		{ 1, 3 }, // C
+		{ 3, 1 }, // Ca
+		{ 4, 11 }, // Cd
+		{ 8, 1 }, // Ce
+		{ 9, 9 }, // Cf
+		{ 2, 6 }, // Cl
+		{ 9, 7 }, // Cm
+		{ 6, 10 }, // Cn
+		{ 3, 8 }, // Co
+		{ 3, 5 }, // Cr
+		{ 5, 0 }, // Cs
+		{ 3, 10 }, // Cu
+		{ 6, 3 }, // Db
+		{ 6, 8 }, // Ds
+		{ 8, 9 }, // Dy
+		{ 8, 11 }, // Er
+		{ 9, 10 }, // Es
+		{ 8, 6 }, // Eu
+		{ 1, 6 }, // F
+		{ 3, 7 }, // Fe
+		{ 6, 12 }, // Fl
+		{ 9, 11 }, // Fm
+		{ 6, 0 }, // Fr
+		{ 3, 12 }, // Ga
+		{ 8, 7 }, // Gd
+		{ 3, 13 }, // Ge
+		{ 0, 0 }, // H
+		{ 0, 1 }, // He
+		{ 5, 2 }, // Hf
+		{ 5, 10 }, // Hg
+		{ 8, 10 }, // Ho
+		{ 6, 6 }, // Hs
+		{ 4, 16 }, // I
+		{ 4, 12 }, // In
+		{ 5, 7 }, // Ir
+		{ 3, 0 }, // K
+		{ 3, 17 }, // Kr
+		{ 8, 0 }, // La
+		{ 1, 0 }, // Li
+		{ 9, 14 }, // Lr
+		{ 8, 14 }, // Lu
+		{ 6, 14 }, // Lv
+		{ 6, 13 }, // Mc
+		{ 9, 12 }, // Md
+		{ 2, 1 }, // Mg
+		{ 3, 6 }, // Mn
+		{ 4, 5 }, // Mo
+		{ 6, 7 }, // Mt
+		{ 1, 4 }, // N
+		{ 2, 0 }, // Na
+		{ 4, 4 }, // Nb
+		{ 8, 3 }, // Nd
+		{ 1, 7 }, // Ne
+		{ 6, 11 }, // Nh
+		{ 3, 9 }, // Ni
+		{ 9, 13 }, // No
+		{ 9, 4 }, // Np
+		{ 1, 5 }, // O
+		{ 6, 16 }, // Og
+		{ 5, 6 }, // Os
+		{ 2, 4 }, // P
+		{ 9, 2 }, // Pa
+		{ 5, 12 }, // Pb
+		{ 4, 9 }, // Pd
+		{ 8, 4 }, // Pm
+		{ 5, 14 }, // Po
+		{ 8, 2 }, // Pr
+		{ 5, 8 }, // Pt
+		{ 9, 5 }, // Pu
+		{ 6, 1 }, // Ra
+		{ 4, 0 }, // Rb
+		{ 5, 5 }, // Re
+		{ 6, 2 }, // Rf
+		{ 6, 9 }, // Rg
+		{ 4, 8 }, // Rh
+		{ 5, 16 }, // Rn
+		{ 4, 7 }, // Ru
+		{ 2, 5 }, // S
+		{ 4, 14 }, // Sb
+		{ 3, 2 }, // Sc
+		{ 3, 15 }, // Se
+		{ 6, 4 }, // Sg
+		{ 2, 3 }, // Si
+		{ 8, 5 }, // Sm
+		{ 4, 13 }, // Sn
+		{ 4, 1 }, // Sr
+		{ 5, 3 }, // Ta
+		{ 8, 8 }, // Tb
+		{ 4, 6 }, // Tc
+		{ 4, 15 }, // Te
+		{ 9, 1 }, // Th
+		{ 3, 3 }, // Ti
+		{ 5, 11 }, // Tl
+		{ 8, 12 }, // Tm
+		{ 6, 15 }, // Ts
+		{ 9, 3 }, // U
+		{ 3, 4 }, // V
+		{ 5, 4 }, // W
+		{ 4, 17 }, // Xe
+		{ 4, 2 }, // Y
+		{ 8, 13 }, // Yb
+		{ 3, 11 }, // Zn
+		{ 4, 3 }, // Zr
+	};
+
+	const ElementIndex ELEMENTS_BY_NAME[] = {
+		{ 9, 0 }, // Ac
+		{ 2, 2 }, // Al
+		{ 9, 6 }, // Am
+		{ 4, 14 }, // Sb
+		{ 2, 7 }, // Ar
+		{ 3, 14 }, // As
+		{ 5, 15 }, // At
+		{ 5, 1 }, // Ba
+		{ 9, 8 }, // Bk
+		{ 1, 1 }, // Be
+		{ 5, 13 }, // Bi
+		{ 6, 5 }, // Bh
+		{ 1, 2 }, // B
+		{ 3, 16 }, // Br
+		{ 4, 11 }, // Cd
+		{ 3, 1 }, // Ca
+		{ 9, 9 }, // Cf
+		{ 1, 3 }, // C
+		{ 8, 1 }, // Ce
+		{ 5, 0 }, // Cs
+		{ 2, 6 }, // Cl
+		{ 3, 5 }, // Cr
+		{ 3, 8 }, // Co
+		{ 6, 10 }, // Cn
+		{ 3, 10 }, // Cu
+		{ 9, 7 }, // Cm
+		{ 6, 8 }, // Ds
+		{ 6, 3 }, // Db
+		{ 8, 9 }, // Dy
+		{ 9, 10 }, // Es
+		{ 8, 11 }, // Er
+		{ 8, 6 }, // Eu
+		{ 9, 11 }, // Fm
+		{ 6, 12 }, // Fl
+		{ 1, 6 }, // F
+		{ 6, 0 }, // Fr
+		{ 8, 7 }, // Gd
+		{ 3, 12 }, // Ga
+		{ 3, 13 }, // Ge
+		{ 5, 9 }, // Au
+		{ 5, 2 }, // Hf
+		{ 6, 6 }, // Hs
+		{ 0, 1 }, // He
+		{ 8, 10 }, // Ho
+		{ 0, 0 }, // H
+		{ 4, 12 }, // In
+		{ 4, 16 }, // I
+		{ 5, 7 }, // Ir
+		{ 3, 7 }, // Fe
+		{ 3, 17 }, // Kr
+		{ 8, 0 }, // La
+		{ 9, 14 }, // Lr
+		{ 5, 12 }, // Pb
+		{ 1, 0 }, // Li
+		{ 6, 14 }, // Lv
+		{ 8, 14 }, // Lu
+		{ 2, 1 }, // Mg
+		{ 3, 6 }, // Mn
+		{ 6, 7 }, // Mt
+		{ 9, 12 }, // Md
+		{ 5, 10 }, // Hg
+		{ 4, 5 }, // Mo
+		{ 6, 13 }, // Mc
+		{ 8, 3 }, // Nd
+		{ 1, 7 }, // Ne
+		{ 9, 4 }, // Np
+		{ 3, 9 }, // Ni
+		{ 6, 11 }, // Nh
+		{ 4, 4 }, // Nb
+		{ 1, 4 }, // N
+		{ 9, 13 }, // No
+		{ 6, 16 }, // Og
+		{ 5, 6 }, // Os
+		{ 1, 5 }, // O
+		{ 4, 9 }, // Pd
+		{ 2, 4 }, // P
+		{ 5, 8 }, // Pt
+		{ 9, 5 }, // Pu
+		{ 5, 14 }, // Po
+		{ 3, 0 }, // K
+		{ 8, 2 }, // Pr
+		{ 8, 4 }, // Pm
+		{ 9, 2 }, // Pa
+		{ 6, 1 }, // Ra
+		{ 5, 16 }, // Rn
+		{ 5, 5 }, // Re
+		{ 4, 8 }, // Rh
+		{ 6, 9 }, // Rg
+		{ 4, 0 }, // Rb
+		{ 4, 7 }, // Ru
+		{ 6, 2 }, // Rf
+		{ 8, 5 }, // Sm
+		{ 3, 2 }, // Sc
+		{ 6, 4 }, // Sg
+		{ 3, 15 }, // Se
+		{ 2, 3 }, // Si
+		{ 4, 10 }, // Ag
+		{ 2, 0 }, // Na
+		{ 4, 1 }, // Sr
+		{ 2, 5 }, // S
+		{ 5, 3 }, // Ta
+		{ 4, 6 }, // Tc
+		{ 4, 15 }, // Te
+		{ 6, 15 }, // Ts
+		{ 8, 8 }, // Tb
+		{ 5, 11 }, // Tl
+		{ 9, 1 }, // Th
+		{ 8, 12 }, // Tm
+		{ 4, 13 }, // Sn
+		{ 3, 3 }, // Ti
+		{ 5, 4 }, // W
+		{ 9, 3 }, // U
+		{ 3, 4 }, // V
+		{ 4, 17 }, // Xe
+		{ 8, 13 }, // Yb
+		{ 4, 2 }, // Y
+		{ 3, 11 }, // Zn
+		{ 4, 3 }, // Zr
+	};
+
+	const uint8_t ELEMENT_COUNT = 118;
 }
@@ -0,0 +1,222 @@
+#include "rng.hpp"
+#include <math.h>
+
+namespace rng {
+
+    // The state, initially what seed(0) gives
+    uint32_t state[4] = {0x7b1dcdaf, 0xe220a839, 0xa1b965f4, 0x6e789e6a};
+
+    inline uint32_t rotl(uint32_t x, uint8_t k) {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    void seed(uint64_t s) {
+        // Expand the seed with SplitMix64, which never gives an all-zero state
+        for (uint8_t i = 0; i < 4; i += 2) {
+            s += 0x9e3779b97f4a7c15;
+            uint64_t z = s;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+            z ^= z >> 31;
+            state[i] = static_cast<uint32_t>(z);
+            state[i + 1] = static_cast<uint32_t>(z >> 32);
+        }
+    }
+
+    uint32_t next() {
+        const uint32_t result = rotl(state[1] * 5, 7) * 9;
+        const uint32_t t = state[1] << 9;
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 11);
+        return result;
+    }
+
+    double uniform() {
+        // 27 and 26 bits from two outputs make up the 53 bits
+        const uint32_t hi = next() >> 5;
+        const uint32_t lo = next() >> 6;
+        return (hi * 67108864.0 + lo) * (1.0 / 9007199254740992.0);
+    }
+
+    uint64_t below(uint64_t n) {
+        if (n == 0) {
+            return next64();
+        }
+        if (n <= 0xFFFFFFFF) {
+            // Lemire's method: the high half of a 32x64-bit product is in [0, n)
+            // Products whose low half is in the first (2^32 mod n) values are rejected, which removes the bias
+            const uint32_t n32 = static_cast<uint32_t>(n);
+            uint64_t m = static_cast<uint64_t>(next()) * n32;
+            if (static_cast<uint32_t>(m) < n32) {
+                const uint32_t threshold = -n32 % n32;
+                while (static_cast<uint32_t>(m) < threshold) {
+                    m = static_cast<uint64_t>(next()) * n32;
+                }
+            }
+            return m >> 32;
+        }
+        // Ranges this large are rare, so just mask off the unneeded bits and retry until the value is in range
+        uint64_t mask = n - 1;
+        mask |= mask >> 1;
+        mask |= mask >> 2;
+        mask |= mask >> 4;
+        mask |= mask >> 8;
+        mask |= mask >> 16;
+        mask |= mask >> 32;
+        uint64_t x;
+        do {
+            x = next64() & mask;
+        } while (x >= n);
+        return x;
+    }
+
+    /*
+     * The ziggurat covers the normal density with 128 layers of equal area: a base strip that includes the tail, and
+     * 127 rectangles stacked on top of it. A 32-bit random number picks a layer with its low 7 bits and a position in
+     * it with all of its bits. Most of the time the position is inside the part of the layer that is entirely under
+     * the curve, so it can be returned right away.
+     *
+     * These are the tables from Marsaglia and Tsang, "The Ziggurat Method for Generating Random Variables" (2000).
+     */
+    // Where the tail starts
+    constexpr double ZIGGURAT_R = 3.442619855899;
+    // Scaled positions where each layer stops being entirely under the curve
+    const uint32_t ZIGGURAT_K[128] = {
+            0x76ad2212, 0x00000000, 0x600f1b53, 0x6ce447a6, 0x725b46a2, 0x7560051d,
+            0x774921eb, 0x789a25bd, 0x799045c3, 0x7a4bce5d, 0x7adf629f, 0x7b5682a6,
+            0x7bb8a8c6, 0x7c0ae722, 0x7c50cce7, 0x7c8cec5b, 0x7cc12cd6, 0x7ceefed2,
+            0x7d177e0b, 0x7d3b8883, 0x7d5bce6c, 0x7d78dd64, 0x7d932886, 0x7dab0e57,
+            0x7dc0dd30, 0x7dd4d688, 0x7de73185, 0x7df81cea, 0x7e07c0a3, 0x7e163efa,
+            0x7e23b587, 0x7e303dfd, 0x7e3beec2, 0x7e46db77, 0x7e51155d, 0x7e5aabb3,
+            0x7e63abf7, 0x7e6c222c, 0x7e741906, 0x7e7b9a18, 0x7e82adfa, 0x7e895c63,
+            0x7e8fac4b, 0x7e95a3fb, 0x7e9b4924, 0x7ea0a0ef, 0x7ea5b00d, 0x7eaa7ac3,
+            0x7eaf04f3, 0x7eb3522a, 0x7eb765a5, 0x7ebb4259, 0x7ebeeafd, 0x7ec2620a,
+            0x7ec5a9c4, 0x7ec8c441, 0x7ecbb365, 0x7ece78ed, 0x7ed11671, 0x7ed38d62,
+            0x7ed5df12, 0x7ed80cb4, 0x7eda175c, 0x7edc0005, 0x7eddc78e, 0x7edf6ebf,
+            0x7ee0f647, 0x7ee25ebe, 0x7ee3a8a9, 0x7ee4d473, 0x7ee5e276, 0x7ee6d2f5,
+            0x7ee7a620, 0x7ee85c10, 0x7ee8f4cd, 0x7ee97047, 0x7ee9ce59, 0x7eea0eca,
+            0x7eea3147, 0x7eea3568, 0x7eea1aab, 0x7ee9e071, 0x7ee98602, 0x7ee90a88,
+            0x7ee86d08, 0x7ee7ac6a, 0x7ee6c769, 0x7ee5bc9c, 0x7ee48a67, 0x7ee32efc,
+            0x7ee1a857, 0x7edff42f, 0x7ede0ffa, 0x7edbf8d9, 0x7ed9ab94, 0x7ed7248d,
+            0x7ed45fae, 0x7ed1585c, 0x7ece095f, 0x7eca6ccb, 0x7ec67be2, 0x7ec22eee,
+            0x7ebd7d1a, 0x7eb85c35, 0x7eb2c075, 0x7eac9c20, 0x7ea5df27, 0x7e9e769f,
+            0x7e964c16, 0x7e8d44ba, 0x7e834033, 0x7e781728, 0x7e6b9933, 0x7e5d8a1a,
+            0x7e4d9ded, 0x7e3b737a, 0x7e268c2f, 0x7e0e3ff5, 0x7df1aa5d, 0x7dcf8c72,
+            0x7da61a1e, 0x7d72a0fb, 0x7d30e097, 0x7cd9b4ab, 0x7c600f1a, 0x7ba90bdc,
+            0x7a722176, 0x77d664e5,
+    };
+    // Scales a signed 32-bit number to a position in each layer
+    const double ZIGGURAT_W[128] = {
+            1.729040521542798e-09, 1.2680928447002762e-10, 1.689751777318455e-10, 1.9862688442479051e-10,
+            2.2232431792499955e-10, 2.424493612544893e-10, 2.6016131900632064e-10, 2.7611988711703956e-10,
+            2.907396281771598e-10, 3.0429970414376596e-10, 3.1699795213954273e-10, 3.2898020527113064e-10,
+            3.4035738121834064e-10, 3.512160221366471e-10, 3.616250995056517e-10, 3.7164057634959785e-10,
+            3.813085643110598e-10, 3.906675680994882e-10, 3.997501186997691e-10, 4.0858398615984403e-10,
+            4.1719309640160654e-10, 4.2559823534592626e-10, 4.3381759739255105e-10, 4.418672181252886e-10,
+            4.497613196266582e-10, 4.5751258894588287e-10, 4.65132404814001e-10, 4.726310238481176e-10,
+            4.800177347232567e-10, 4.873009867798748e-10, 4.944884980538973e-10, 5.015873466119616e-10,
+            5.08604048242456e-10, 5.15544622919539e-10, 5.224146519706316e-10, 5.292193275006305e-10,
+            5.35963495331289e-10, 5.426516924820619e-10, 5.492881800346021e-10, 5.558769720760773e-10,
+            5.624218612983588e-10, 5.68926441734655e-10, 5.753941290375603e-10, 5.818281786390898e-10,
+            5.88231702081217e-10, 5.946076817624996e-10, 6.009589843108302e-10, 6.072883727627885e-10,
+            6.135985177054135e-10, 6.198920075155922e-10, 6.261713578149429e-10, 6.324390202435402e-10,
+            6.386973906435736e-10, 6.449488167337383e-10, 6.511956053464698e-10, 6.574400292928599e-10,
+            6.636843339139875e-10, 6.699307433723302e-10, 6.761814667327444e-10, 6.824387038791137e-10,
+            6.887046513100733e-10, 6.949815078551667e-10, 7.012714803513155e-10, 7.07576789318556e-10,
+            7.138996746735849e-10, 7.202424015197486e-10, 7.266072660527047e-10, 7.329966016220864e-10,
+            7.394127849911228e-10, 7.458582428383539e-10, 7.523354585483488e-10, 7.588469793417652e-10,
+            7.653954237992263e-10, 7.7198348983844e-10, 7.786139632098381e-10, 7.852897265828997e-10,
+            7.920137693034098e-10, 7.987891979113536e-10, 8.05619247520217e-10, 8.125072941713968e-10,
+            8.194568682925745e-10, 8.264716694066625e-10, 8.335555822587845e-10, 8.407126945532991e-10,
+            8.479473165218372e-10, 8.552640025776094e-10, 8.626675753519363e-10, 8.701631524574424e-10,
+            8.777561763803284e-10, 8.854524479737278e-10, 8.932581641080369e-10, 9.011799601356605e-10,
+            9.092249579511381e-10, 9.174008205786005e-10, 9.257158144040126e-10, 9.341788803988472e-10,
+            9.427997159666314e-10, 9.515888693998883e-10, 9.605578493831253e-10, 9.697192525453944e-10,
+            9.7908691279089e-10, 9.886760770687724e-10, 9.985036134535425e-10, 1.0085882589914473e-09,
+            1.0189509168621382e-09, 1.0296150152006668e-09, 1.0406069436999874e-09, 1.0519565892728039e-09,
+            1.0636979991930871e-09, 1.0758702101645819e-09, 1.0885182960607283e-09, 1.1016947078135044e-09,
+            1.1154610095597163e-09, 1.1298901613493216e-09, 1.1450695700067237e-09, 1.1611052426022348e-09,
+            1.178127560945613e-09, 1.1962995053850756e-09, 1.2158286983295564e-09, 1.2369856290804966e-09,
+            1.2601323300608525e-09, 1.2857696844205153e-09, 1.3146201849677183e-09, 1.3477839562210855e-09,
+            1.3870635315067043e-09, 1.435740319181638e-09, 1.5008659030222993e-09, 1.6030947938091123e-09,
+    };
+    // The density at the top of each layer
+    const double ZIGGURAT_F[128] = {
+            1.0, 0.9635996931270862, 0.9362826816850596, 0.9130436479717402,
+            0.8922816507840261, 0.8732430489100695, 0.8555006078694506, 0.8387836052959896,
+            0.822907211381409, 0.8077382946829605, 0.7931770117713051, 0.7791460859296877,
+            0.7655841738977045, 0.7524415591746114, 0.7396772436726473, 0.7272569183441848,
+            0.7151515074104986, 0.7033360990161581, 0.6917891434366751, 0.6804918409973341,
+            0.6694276673488904, 0.658582000050088, 0.6479418211102225, 0.6374954773350423,
+            0.6272324852499273, 0.6171433708188809, 0.6072195366251203, 0.5974531509445167,
+            0.5878370544347066, 0.5783646811197631, 0.5690299910679509, 0.5598274127040869,
+            0.5507517931146045, 0.5417983550254255, 0.5329626593838361, 0.5242405726729841,
+            0.5156282382440018, 0.507122051075569, 0.4987186354709795, 0.4904148252838441,
+            0.4822076463294852, 0.47409430069301695, 0.4660721526894561, 0.45813871626787206,
+            0.4502916436820392, 0.44252871527546844, 0.4348478302499909, 0.4272469983049961,
+            0.4197243320495744, 0.412278040102661, 0.40490642080722294, 0.3976078564938733,
+            0.3903808082373146, 0.3832238110559012, 0.3761354695105626, 0.3691144536644722,
+            0.3621594953693176, 0.3552693848479171, 0.3484429675463266, 0.3416791412315504,
+            0.3349768533135892, 0.3283350983728503, 0.3217529158759849, 0.3152293880650109,
+            0.3087636380061811, 0.30235482778648354, 0.296002156846933, 0.28970486044295984,
+            0.283462208223233, 0.2772735029191881, 0.2711380791383846, 0.2650553022555892,
+            0.25902456739620483, 0.25304529850732577, 0.2471169475123214, 0.24123899354543982,
+            0.23541094226347908, 0.22963232523211613, 0.22390269938500842, 0.2182216465543054,
+            0.2125887730717303, 0.20700370943992652, 0.20146611007431367, 0.19597565311627774,
+            0.19053204031913715, 0.1851349970089922, 0.17978427212329545, 0.1744796383307895,
+            0.169220892237365, 0.16400785468342038, 0.1588403711394793, 0.15371831220818166,
+            0.14864157424234226, 0.14361008009062776, 0.1386237799845946, 0.13368265258343937,
+            0.1287867061959432, 0.12393598020286782, 0.11913054670765083, 0.11437051244886601,
+            0.10965602101484027, 0.10498725540942132, 0.10036444102865587, 0.09578784912173144,
+            0.09125780082683026, 0.08677467189478018, 0.08233889824223566, 0.0779509825139734,
+            0.0736115018841134, 0.06932111739357791, 0.06508058521306807, 0.060890770348040406,
+            0.05675266348104985, 0.05266740190305101, 0.048636295859867805, 0.044660862200491425,
+            0.040742868074444175, 0.0368843887866562, 0.03308788614622575, 0.02935631744000685,
+            0.02569329193593427, 0.022103304615927098, 0.018592102737011288, 0.015167298010546568,
+            0.011839478657884862, 0.008624484412859885, 0.005548995220771345, 0.002669629083880923,
+    };
+
+    double normal() {
+        while (true) {
+            const int32_t hz = static_cast<int32_t>(next());
+            const uint8_t iz = hz & 127;
+            const uint32_t absHz = hz < 0 ? -static_cast<uint32_t>(hz) : hz;
+            // Inside the part under the curve
+            if (absHz < ZIGGURAT_K[iz]) {
+                return hz * ZIGGURAT_W[iz];
+            }
+            // The base layer's overhang is the tail beyond R, sampled directly (Marsaglia's method)
+            if (iz == 0) {
+                double x, y;
+                do {
+                    // 1 - uniform() is never 0
+                    x = -log(1 - uniform()) / ZIGGURAT_R;
+                    y = -log(1 - uniform());
+                } while (y + y < x * x);
+                return hz > 0 ? ZIGGURAT_R + x : -ZIGGURAT_R - x;
+            }
+            // Otherwise the point is in the wedge of the layer that sticks out of the curve
+            // Accept it if it is under the curve, and otherwise start over
+            const double x = hz * ZIGGURAT_W[iz];
+            if (ZIGGURAT_F[iz] + uniform() * (ZIGGURAT_F[iz - 1] - ZIGGURAT_F[iz]) < exp(-x * x / 2)) {
+                return x;
+            }
+        }
+    }
+
+    void fillUniform(double *out, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = uniform();
+        }
+    }
+
+    void fillNormal(double *out, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = normal();
+        }
+    }
+} // namespace rng
@@ -1,309 +1,363 @@
 #include "unitconv.hpp"
 #include "lcd12864_charset.hpp"
+#include "lookup.hpp"
 #include <string.h>
 #include <math.h>
 
 namespace eval {
 
-    /* 
-     * Distance Units 
-     * Base Unit: m
+    constexpr const char *nameOf(const Unit &unit) {
+        return unit.name;
+    }
+
+    /*
+     * All units, in terms of the SI base units.
+     *
+     * The dimension is the power of m, kg, s, A, K and mol, in that order.
+     * Units that can take an SI prefix are only listed once, e.g. km is k and m.
+     * Temperatures are measured from 0 degrees Celsius instead of absolute zero, so that conversions between Celsius
+     * and Fahrenheit don't pick up rounding errors from the offset of Kelvin, e.g. 32 F is exactly 0 C.
      */
-    const Unit UNIT_DISTANCE[] = {
-        // Kilometer
-        { "km", 1000, 0 },
+    constexpr Unit UNITS[] = {
+        /*
+         * Distance Units
+         */
         // Meter
-        { "m", 1, 0 },
-        // Decimeter
-        { "dm", 0.1, 0 },
-        // Centimeter
-        { "cm", 0.01, 0 },
-        // Millimeter
-        { "mm", 1e-3, 0 },
-        // Micrometer
-        { LCD_STR_MU "m", 1e-6, 0 },
-        // Nanometer
-        { "nm", 1e-9, 0 },
-
+        { "m", 1, 0, { 1 }, true },
         // Inch
-        { "in", 0.0254, 0 },
+        { "in", 0.0254, 0, { 1 }, false },
         // Foot
-        { "ft", 0.3048, 0 },
+        { "ft", 0.3048, 0, { 1 }, false },
         // Yard
-        { "yd", 0.9144, 0 },
+        { "yd", 0.9144, 0, { 1 }, false },
         // Mile
-        { "mi", 1609.344, 0 },
-    };
-    constexpr uint8_t UNIT_DISTANCE_LEN = sizeof(UNIT_DISTANCE) / sizeof(Unit);
+        { "mi", 1609.344, 0, { 1 }, false },
 
-    /*
-     * Area Units
-     * Base Unit: m^2
-     */
-    const Unit UNIT_AREA[] = {
-        // Square kilometer
-        { "km2", 1e6, 0 },
-        // Square meter
-        { "m2", 1, 0 },
-        // Square decimeter
-        { "dm2", 0.01, 0 },
-        // Square centimeter
-        { "cm2", 0.0001, 0 },
-        // Square millimeter
-        { "mm2", 1e-6, 0 },
-        // Square micrometer
-        { LCD_STR_MU "m2", 1e-12, 0 },
-        // Square nanometer
-        { "nm2", 1e-18, 0 },
+        /*
+         * Area Units
+         */
         // Hectare
-        { "ha", 10000, 0 },
-
-        // Square inch
-        { "in2",  0.00064516, 0 },
-        // Square foot
-        { "ft2", 0.09290304, 0 },
-        // Square yard
-        { "yd2",  0.83612736, 0 },
-        // Square mile
-        { "mi2",  2589988.11034, 0 },
+        { "ha", 10000, 0, { 2 }, false },
         // Acre
-        { "ac", 4046.85642, 0 },
-    };
-    constexpr uint8_t UNIT_AREA_LEN = sizeof(UNIT_AREA) / sizeof(Unit);
+        { "ac", 4046.85642, 0, { 2 }, false },
 
-    /* 
-     * Volume Units 
-     * Base Unit: m^3
-     */
-    const Unit UNIT_VOLUME[] = {
-        // Cubic Kilometer
-        { "km3", 1e9, 0 },
-        // Cubic Meter
-        { "m3", 1, 0 },
-        // Cubic Decimeter
-        { "dm3", 0.001, 0 },
-        // Cubic Centimeter
-        { "cm3", 1e-6, 0 },
-        // Cubic Millimeter
-        { "mm3", 1e-9, 0 },
-        // Cubic Micrometer
-        { LCD_STR_MU "m3", 1e-18, 0 },
-        // Cubic Nanometer
-        { "nm3", 1e-27, 0 },
+        /*
+         * Volume Units
+         */
         // Liter
-        { "L", 0.001, 0 },
-        // Milliliter
-        { "mL", 1e-6, 0 },
-
-        // Cubic Inch
-        { "in3", 0.00001638706, 0 },
-        // Cubic Foot
-        { "ft3", 0.02831684659, 0 },
-        // Cubic Yard
-        { "yd3", 0.76455485798, 0 },
-        // Cubic Mile
-        { "mi3", 4168181825.44, 0 },
+        { "L", 0.001, 0, { 3 }, true },
         // Ounce
-        { "oz", 0.00002957352, 0 },
+        { "oz", 0.00002957352, 0, { 3 }, false },
         // US Gallon
-        { "USgal", 0.00378541178, 0 },
+        { "USgal", 0.00378541178, 0, { 3 }, false },
         // UK Gallon
-        { "UKgal", 0.00454609188, 0 },
+        { "UKgal", 0.00454609188, 0, { 3 }, false },
         // Gallon (Imperial)
-        { "gal", 0.00454609188, 0 },
-
+        { "gal", 0.00454609188, 0, { 3 }, false },
         // Cup (Metric)
-        { "cup", 0.00025, 0 },
+        { "cup", 0.00025, 0, { 3 }, false },
         // Tablespoon (Metric)
-        { "tbsp", 1.5e-5, 0 },
+        { "tbsp", 1.5e-5, 0, { 3 }, false },
         // Teaspoon (Metric)
-        { "tsp", 5e-6, 0 },
-    };
-    constexpr uint8_t UNIT_VOLUME_LEN = sizeof(UNIT_VOLUME) / sizeof(Unit);
+        { "tsp", 5e-6, 0, { 3 }, false },
 
-    /*
-     * Mass Units
-     * Base Unit: kg
-     */
-    const Unit UNIT_MASS[] = {
-        // Tonne
-        { "t", 1000, 0 },
-        // Kilogram
-        { "kg", 1, 0 },
+        /*
+         * Mass Units
+         */
         // Gram
-        { "g", 1e-3, 0 },
-        // Milligram
-        { "mg", 1e-6, 0 },
-        // Microgram
-        { LCD_STR_MU "g", 1e-9, 0 },
-        // Nanogram
-        { "ng", 1e-12, 0 },
-
+        { "g", 1e-3, 0, { 0, 1 }, true },
+        // Tonne
+        { "t", 1000, 0, { 0, 1 }, false },
         // Slug
-        { "sl", 14.5939029, 0 },
+        { "sl", 14.5939029, 0, { 0, 1 }, false },
         // Pound
-        { "lb", 0.453592, 0 },
-    };
-    constexpr uint8_t UNIT_MASS_LEN = sizeof(UNIT_MASS) / sizeof(Unit);
+        { "lb", 0.453592, 0, { 0, 1 }, false },
 
-    /*
-     * Pressure Units
-     * Base Unit: Pa
-     */
-    const Unit UNIT_PRESSURE[] = {
-        // Kilopascal
-        { "kPa", 1000, 0 },
+        /*
+         * Time Units
+         */
+        // Second
+        { "s", 1, 0, { 0, 0, 1 }, true },
+        // Minute
+        // This used to be m; see LEGACY_UNITS
+        { "min", 60, 0, { 0, 0, 1 }, false },
+        // Hour
+        { "h", 3600, 0, { 0, 0, 1 }, false },
+        // Day
+        { "day", 86400, 0, { 0, 0, 1 }, false },
+        // Week
+        { "week", 604800, 0, { 0, 0, 1 }, false },
+
+        /*
+         * Frequency Units
+         */
+        // Hertz
+        { "Hz", 1, 0, { 0, 0, -1 }, true },
+
+        /*
+         * Speed Units
+         */
+        // Miles per hour
+        { "mph", 0.44704, 0, { 1, 0, -1 }, false },
+        // Knot
+        { "kn", 1852.0 / 3600, 0, { 1, 0, -1 }, false },
+
+        /*
+         * Force Units
+         */
+        // Newton
+        { "N", 1, 0, { 1, 1, -2 }, true },
+        // Pound-force
+        { "lbf", 4.4482216152605, 0, { 1, 1, -2 }, false },
+
+        /*
+         * Pressure Units
+         */
         // Pascal
-        { "Pa", 1, 0 },
+        { "Pa", 1, 0, { -1, 1, -2 }, true },
         // Bar
-        { "bar", 1e5, 0 },
-
+        { "bar", 1e5, 0, { -1, 1, -2 }, true },
         // Atmosphere
-        { "atm", 101325, 0 },
+        { "atm", 101325, 0, { -1, 1, -2 }, false },
         // Millimeter of Mercury
-        { "mmHg", 133.3224, 0 },
-        
+        { "mmHg", 133.3224, 0, { -1, 1, -2 }, false },
         // Pounds per Square Inch
-        { "psi", 6894.75729, 0 },
-    };
-    constexpr uint8_t UNIT_PRESSURE_LEN = sizeof(UNIT_PRESSURE) / sizeof(Unit);
-
-    /*
-     * Temperature Units
-     * Base Unit: C
-     * 
-     * Note that even though the Kelvin is the SI unit for temperature, for the ease of implementation Celsius is chosen.
-     */
-    const Unit UNIT_TEMPERATURE[] = {
-        // Celsis
-        { "C", 1, 0 },
-        // Kelvin
-        { "K", 1, 273.15 },
-        // Fahrenheit
-        { "F", 5.0f/9.0f, 32 },
-    };
-    constexpr uint8_t UNIT_TEMPERATURE_LEN = sizeof(UNIT_TEMPERATURE) / sizeof(Unit);
-
-    /*
-     * Time Units
-     * Base Unit: s
-     */
-    const Unit UNIT_TIME[] = {
-        // Week
-        { "week", 604800, 0 },
-        // Day
-        { "day", 86400, 0 },
-        // Hour
-        { "h", 3600, 0 },
-        // Minute
-        { "m", 60, 0 },
-        // Second
-        { "s", 1, 0 },
-        // Millisecond
-        { "ms", 1e-3, 0 },
-        // Microsecond
-        { LCD_STR_MU "s", 1e-6, 0 },
-        // Nanosecond
-        { "ns", 1e-9, 0 },
-    };
-    constexpr uint8_t UNIT_TIME_LEN = sizeof(UNIT_TIME) / sizeof(Unit);
+        { "psi", 6894.75729, 0, { -1, 1, -2 }, false },
 
-    /*
-     * Energy Units
-     * Base Unit: J
-     */
-    const Unit UNIT_ENERGY[] = {
-        // Megajoule
-        { "MJ", 1e6, 0 },
-        // Kilojoule
-        { "kJ", 1000, 0 },
+        /*
+         * Energy Units
+         */
         // Joule
-        { "J", 1, 0 },
+        { "J", 1, 0, { 2, 1, -2 }, true },
         // Gram calorie
-        { "cal", 4.184, 0 },
+        { "cal", 4.184, 0, { 2, 1, -2 }, true },
         // Kilocalorie (Food Calorie)
-        { "Cal", 4184, 0 },
-        { "kcal", 4184, 0 },
+        { "Cal", 4184, 0, { 2, 1, -2 }, false },
         // Watt hour
-        { "Wh", 3600, 0 },
-        // Kilowatt hour
-        { "kWh", 3600000, 0 },
-
+        { "Wh", 3600, 0, { 2, 1, -2 }, true },
         // Electron volt
-        { "eV", 1.602176634e-19, 0 },
-        // Kilo-electron volt
-        { "keV", 1.602176634e-16, 0 },
-        // Mega-electron volt
-        { "MeV", 1.602176634e-13, 0 },
-        // Giga-electron volt
-        { "GeV", 1.602176634e-10, 0 },
-
+        { "eV", 1.602176634e-19, 0, { 2, 1, -2 }, true },
         // British Thermal Unit
-        { "BTU", 1055.0558526, 0 },
+        { "BTU", 1055.0558526, 0, { 2, 1, -2 }, false },
         // US therm
-        { "thm", 105505585.26, 0 },
+        { "thm", 105505585.26, 0, { 2, 1, -2 }, false },
         // Foot-pound
-        { "ftlb", 1.355818, 0 },
-    };
-    constexpr uint8_t UNIT_ENERGY_LEN = sizeof(UNIT_ENERGY) / sizeof(Unit);
+        { "ftlb", 1.355818, 0, { 2, 1, -2 }, false },
 
-    /*
-     * Angle Units
-     * Base Unit: rad
-     */
-    const Unit UNIT_ANGLE[] = {
+        /*
+         * Power Units
+         */
+        // Watt
+        { "W", 1, 0, { 2, 1, -3 }, true },
+        // Horsepower (Mechanical)
+        { "hp", 745.69987158227, 0, { 2, 1, -3 }, false },
+
+        /*
+         * Electrical Units
+         */
+        // Ampere
+        { "A", 1, 0, { 0, 0, 0, 1 }, true },
+        // Volt
+        { "V", 1, 0, { 2, 1, -3, -1 }, true },
+        // Ampere hour
+        { "Ah", 3600, 0, { 0, 0, 1, 1 }, true },
+
+        /*
+         * Temperature Units
+         */
+        // Kelvin
+        { "K", 1, 273.15, { 0, 0, 0, 0, 1 }, false },
+        // Celsius
+        { "C", 1, 0, { 0, 0, 0, 0, 1 }, false },
+        // Fahrenheit
+        { "F", 5.0 / 9.0, 32, { 0, 0, 0, 0, 1 }, false },
+
+        /*
+         * Amount of Substance Units
+         */
+        // Mole
+        { "mol", 1, 0, { 0, 0, 0, 0, 0, 1 }, true },
+
+        /*
+         * Angle Units
+         * These are dimensionless
+         */
         // Radians
-        { "rad", 1, 0 },
+        { "rad", 1, 0, { 0 }, false },
         // Degrees
-        { "deg", 3.14159265358979323846 / 180, 0 },
+        { "deg", 3.14159265358979323846 / 180, 0, { 0 }, false },
         // Gradians
-        { "grad", 3.14159265358979323846 / 200, 0 },
-    };
-    constexpr uint8_t UNIT_ANGLE_LEN = sizeof(UNIT_ANGLE) / sizeof(Unit);
-
-    const Unit * const UNIT_TYPES[] = {
-        UNIT_DISTANCE,
-        UNIT_AREA,
-        UNIT_VOLUME,
-        UNIT_MASS,
-        UNIT_PRESSURE,
-        UNIT_TEMPERATURE,
-        UNIT_TIME,
-        UNIT_ENERGY,
-        UNIT_ANGLE,
+        { "grad", 3.14159265358979323846 / 200, 0, { 0 }, false },
     };
+    constexpr uint8_t UNITS_LEN = sizeof(UNITS) / sizeof(Unit);
+    constexpr lookup::PerfectHash<UNITS_LEN, 256, Unit> UNIT_TABLE(UNITS);
+    static_assert(UNIT_TABLE.isValid(), "No perfect hash found for the unit names");
 
-    const uint8_t UNIT_LENS[] = {
-        UNIT_DISTANCE_LEN,
-        UNIT_AREA_LEN,
-        UNIT_VOLUME_LEN,
-        UNIT_MASS_LEN,
-        UNIT_PRESSURE_LEN,
-        UNIT_TEMPERATURE_LEN,
-        UNIT_TIME_LEN,
-        UNIT_ENERGY_LEN,
-        UNIT_ANGLE_LEN,
+    struct Prefix {
+        char symbol;
+        double factor;
     };
+    const Prefix PREFIXES[] = {
+        { 'T', 1e12 },
+        { 'G', 1e9 },
+        { 'M', 1e6 },
+        { 'k', 1e3 },
+        { 'h', 1e2 },
+        { 'd', 1e-1 },
+        { 'c', 1e-2 },
+        { 'm', 1e-3 },
+        { LCD_CHAR_MU, 1e-6 },
+        { 'n', 1e-9 },
+        { 'p', 1e-12 },
+        { 'f', 1e-15 },
+    };
+    constexpr uint8_t PREFIXES_LEN = sizeof(PREFIXES) / sizeof(Prefix);
 
-    constexpr uint8_t UNIT_TYPES_LEN = sizeof(UNIT_TYPES) / sizeof(Unit*);
+    // Longest name of a single unit with its prefix
+    constexpr uint8_t MAX_UNIT_NAME_LEN = 7;
 
-    // Converts from a non-base unit to the base unit.
-    double convertUnitsHelper1(double n, const char *unit, const Unit UNIT_TYPE_ARR[], uint8_t UNIT_ARR_LEN) {
-        for(uint8_t i = 0; i < UNIT_ARR_LEN; i ++) {
-            if(strcmp(UNIT_TYPE_ARR[i].name, unit) == 0) {
-                return (n - UNIT_TYPE_ARR[i].bias) * UNIT_TYPE_ARR[i].conversion;
+    // Finds a unit with an optional prefix. The prefix factor is written to prefixFactor.
+    const Unit *findUnit(const char *name, double &prefixFactor) {
+        // Names with a prefix that are also units on their own, e.g. min, are the unit
+        int16_t index = UNIT_TABLE.find(name);
+        if (index >= 0) {
+            prefixFactor = 1;
+            return UNITS + index;
+        }
+        if (name[0] == '\0' || name[1] == '\0') {
+            return nullptr;
+        }
+        for (uint8_t i = 0; i < PREFIXES_LEN; i++) {
+            if (PREFIXES[i].symbol == name[0]) {
+                index = UNIT_TABLE.find(name + 1);
+                if (index >= 0 && UNITS[index].prefixable) {
+                    prefixFactor = PREFIXES[i].factor;
+                    return UNITS + index;
+                }
+                return nullptr;
             }
         }
-        return NAN;
+        return nullptr;
     }
-    // Converts from the base unit to a non-base unit.
-    double convertUnitsHelper2(double n, const char *unit, const Unit UNIT_TYPE_ARR[], uint8_t UNIT_ARR_LEN) {
-        for(uint8_t i = 0; i < UNIT_ARR_LEN; i ++) {
-            if(strcmp(UNIT_TYPE_ARR[i].name, unit) == 0) {
-                return n / UNIT_TYPE_ARR[i].conversion + UNIT_TYPE_ARR[i].bias;
+
+    bool isUnitMultiply(char ch) {
+        return ch == LCD_CHAR_MUL || ch == '*';
+    }
+    bool isUnitDivide(char ch) {
+        return ch == LCD_CHAR_DIV || ch == '/';
+    }
+
+    bool parseUnit(const char *str, CompoundUnit &unit) {
+        unit.conversion = 1;
+        unit.bias = 0;
+        for (uint8_t i = 0; i < BASE_QUANTITY_COUNT; i++) {
+            unit.dimension[i] = 0;
+        }
+
+        const Unit *single = nullptr;
+        uint8_t parts = 0;
+        int8_t sign = 1;
+        while (true) {
+            // Find the end of the name and of the power
+            const char *nameEnd = str;
+            while (*nameEnd != '\0' && !isUnitMultiply(*nameEnd) && !isUnitDivide(*nameEnd)
+                    && !(*nameEnd >= '0' && *nameEnd <= '9')) {
+                ++nameEnd;
+            }
+            const char *end = nameEnd;
+            int8_t power = 0;
+            while (*end >= '0' && *end <= '9') {
+                if (power > 10) {
+                    return false;
+                }
+                power = power * 10 + (*end++ - '0');
+            }
+            if (end == nameEnd) {
+                power = 1;
+            }
+            if (nameEnd == str || nameEnd - str > MAX_UNIT_NAME_LEN || power == 0
+                    || (*end != '\0' && !isUnitMultiply(*end) && !isUnitDivide(*end))) {
+                return false;
+            }
+
+            char name[MAX_UNIT_NAME_LEN + 1];
+            memcpy(name, str, nameEnd - str);
+            name[nameEnd - str] = '\0';
+            double prefixFactor;
+            const Unit *u = findUnit(name, prefixFactor);
+            if (!u) {
+                return false;
+            }
+
+            unit.conversion *= pow(prefixFactor * u->conversion, sign * power);
+            for (uint8_t i = 0; i < BASE_QUANTITY_COUNT; i++) {
+                unit.dimension[i] += sign * power * u->dimension[i];
+            }
+            single = power == 1 && prefixFactor == 1 ? u : nullptr;
+            ++parts;
+
+            if (*end == '\0') {
+                break;
+            }
+            // Everything after a division is in the denominator
+            if (isUnitDivide(*end)) {
+                if (sign < 0) {
+                    return false;
+                }
+                sign = -1;
+            }
+            str = end + 1;
+        }
+        // Only a unit on its own can have a bias
+        if (parts == 1 && single) {
+            unit.bias = single->bias;
+        }
+        return true;
+    }
+
+    /*
+     * Recently used conversions, so that evaluating the same expression again (e.g. when graphing or solving) doesn't
+     * need to parse the units again.
+     *
+     * A value in the destination unit is the value in the source unit times scale plus offset.
+     */
+    struct CachedConversion {
+        char srcUnit[16];
+        char destUnit[16];
+        double scale;
+        double offset;
+    };
+    constexpr uint8_t CONVERSION_CACHE_SIZE = 4;
+    CachedConversion conversionCache[CONVERSION_CACHE_SIZE];
+    // The entry to replace next
+    uint8_t conversionCacheNext = 0;
+
+    /*
+     * Names that used to mean another unit, from before units could be prefixed and combined.
+     * The old unit is only used when the current one doesn't match the other side of the conversion, e.g. m~s(90) is
+     * still 90 minutes in seconds, but m~km(5) is 5 metres.
+     */
+    struct LegacyUnit {
+        const char *name;
+        const char *unit;
+    };
+    constexpr LegacyUnit LEGACY_UNITS[] = {
+        // Minute, before metres were added
+        { "m", "min" },
+    };
+
+    // Parses the unit that name used to mean, if it matches the dimension of other
+    // unit is only changed if this returns true
+    bool parseLegacyUnit(const char *name, const CompoundUnit &other, CompoundUnit &unit) {
+        for (const auto &legacy : LEGACY_UNITS) {
+            CompoundUnit old;
+            if (strcmp(name, legacy.name) == 0 && parseUnit(legacy.unit, old)
+                    && memcmp(old.dimension, other.dimension, sizeof(old.dimension)) == 0) {
+                unit = old;
+                return true;
             }
         }
-        return NAN;
+        return false;
     }
 
     /*
@@ -311,17 +365,37 @@ namespace eval {
      * n - The input
      * srcUnit - The unit of the input
      * destUnit - The unit to convert to
-     * 
+     *
      * Returns NAN if units are not compatible.
      */
     double convertUnits(double n, const char *srcUnit, const char *destUnit) {
-        for(uint8_t i = 0; i < UNIT_TYPES_LEN; i ++) {
-            double d = convertUnitsHelper1(n, srcUnit, UNIT_TYPES[i], UNIT_LENS[i]);
-
-            if(!isnan(d)) {
-                return convertUnitsHelper2(d, destUnit, UNIT_TYPES[i], UNIT_LENS[i]);
+        for (const auto &c : conversionCache) {
+            if (c.srcUnit[0] != '\0' && strcmp(c.srcUnit, srcUnit) == 0 && strcmp(c.destUnit, destUnit) == 0) {
+                return n * c.scale + c.offset;
             }
         }
-        return NAN;
+
+        CompoundUnit src, dest;
+        if (!parseUnit(srcUnit, src) || !parseUnit(destUnit, dest)) {
+            return NAN;
+        }
+        if (memcmp(src.dimension, dest.dimension, sizeof(src.dimension)) != 0
+                && !parseLegacyUnit(srcUnit, dest, src) && !parseLegacyUnit(destUnit, src, dest)) {
+            return NAN;
+        }
+        // Same as converting to the base unit and then to the destination
+        const double scale = src.conversion / dest.conversion;
+        const double offset = dest.bias - src.bias * scale;
+
+        // Only cache the conversion if the names fit
+        if (strlen(srcUnit) < sizeof(CachedConversion::srcUnit) && strlen(destUnit) < sizeof(CachedConversion::destUnit)) {
+            CachedConversion &c = conversionCache[conversionCacheNext];
+            strcpy(c.srcUnit, srcUnit);
+            strcpy(c.destUnit, destUnit);
+            c.scale = scale;
+            c.offset = offset;
+            conversionCacheNext = (conversionCacheNext + 1) % CONVERSION_CACHE_SIZE;
+        }
+        return n * scale + offset;
     }
 }
@@ -0,0 +1,46 @@
+/*
+ * Host stand-in for the CMSIS Cortex-M3 core header, for building the math code in the native test environment.
+ *
+ * Only what the headers and the sources under test refer to is defined here.
+ */
+#ifndef __CORE_CM3_H__
+#define __CORE_CM3_H__
+
+#include <stdint.h>
+// glibc defines this as the width of size_t, which clashes with lcd::SIZE_WIDTH
+#undef SIZE_WIDTH
+
+#define __I volatile const
+#define __O volatile
+#define __IO volatile
+#define __NVIC_PRIO_BITS 4
+
+typedef struct {
+    __IO uint32_t ISER[8];
+} NVIC_Type;
+
+typedef struct {
+    __IO uint32_t CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+extern SysTick_Type *SysTick;
+#define SysTick_CTRL_ENABLE_Msk 1
+#define SysTick_CTRL_COUNTFLAG_Msk 0x10000
+
+// The stack check in eval::evaluate() compares this with the address of __stack_limit
+static inline uintptr_t __get_MSP(void) {
+    return (uintptr_t) __builtin_frame_address(0);
+}
+static inline uint32_t __get_PRIMASK(void) {
+    return 0;
+}
+static inline void __disable_irq(void) {
+}
+static inline void __enable_irq(void) {
+}
+static inline void NVIC_SystemReset(void) {
+}
+static inline uint32_t SysTick_Config(uint32_t ticks) {
+    return 0;
+}
+
+#endif
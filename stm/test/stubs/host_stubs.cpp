@@ -0,0 +1,23 @@
+/*
+ * Definitions the math code links against that are normally provided by the hardware, the linker script or
+ * sources that aren't built for the native test environment.
+ */
+#include "core_cm3.h"
+#include "lcd12864.hpp"
+
+SysTick_Type *SysTick = nullptr;
+
+// Exported by the startup code on the device
+// On the host it's a global, which is below the stack so the stack check in eval::evaluate() never triggers
+extern "C" {
+void *__stack_limit;
+}
+
+namespace lcd {
+    void LCD12864::drawImage(int16_t, int16_t, const Image &, bool) {
+    }
+    void LCD12864::drawLine(int16_t, int16_t, int16_t, int16_t, bool) {
+    }
+    void LCD12864::setPixel(int16_t, int16_t, bool) {
+    }
+} // namespace lcd
@@ -0,0 +1,160 @@
+/*
+ * Checks linReg against known fits, for model terms that are evaluated for all the data points at once and for ones
+ * that have to be evaluated for each data point separately, and the fit statistics from linRegStats.
+ */
+#include "eval.hpp"
+#include "neda.hpp"
+#include <initializer_list>
+#include <math.h>
+#include <unity.h>
+
+using eval::Matrix;
+
+util::DynamicArray<eval::Variable> vars;
+util::DynamicArray<eval::UserDefinedFunction> funcs;
+
+// Adds every character of a string to a container
+neda::Container *addChars(neda::Container *cont, const char *str) {
+    for (; *str; str++) {
+        if (*str == '(') {
+            cont->add(new neda::LeftBracket());
+        }
+        else if (*str == ')') {
+            cont->add(new neda::RightBracket());
+        }
+        else {
+            cont->add(new neda::Character(*str));
+        }
+    }
+    return cont;
+}
+
+neda::Container *chars(const char *str) {
+    return addChars(new neda::Container(), str);
+}
+
+// Makes a column vector variable
+void setVector(const char *name, std::initializer_list<int64_t> values) {
+    Matrix *mat = new Matrix(values.size(), 1);
+    uint16_t i = 0;
+    for (int64_t v : values) {
+        mat->set(i++, util::Numerical(v, 1));
+    }
+    vars.add(eval::Variable(name, mat));
+}
+
+// Evaluates str, an unfinished function call that returns a matrix, followed by last and a right bracket
+Matrix *call(const char *str, neda::NEDAObj *last = nullptr) {
+    neda::Container *expr = chars(str);
+    if (last) {
+        expr->add(last);
+    }
+    expr->add(new neda::RightBracket());
+    eval::Token *result = eval::evaluate(expr, vars, funcs);
+    delete expr;
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_UINT8(
+            static_cast<uint8_t>(eval::TokenType::MATRIX), static_cast<uint8_t>(result->getType()));
+    return static_cast<Matrix *>(result);
+}
+
+void assertExact(int64_t expected, const util::Numerical &actual) {
+    TEST_ASSERT_FALSE(actual.isNumber());
+    TEST_ASSERT_TRUE(actual.asFraction().num == expected);
+    TEST_ASSERT_TRUE(actual.asFraction().denom == 1);
+}
+
+void assertClose(double expected, const util::Numerical &actual) {
+    TEST_ASSERT_TRUE(fabs(expected - actual.asDouble()) <= 1e-9);
+}
+
+void setUp() {
+    setVector("X", {-2, -1, 1, 2, 3});
+    // |X| and max(X, 0)
+    setVector("Z", {2, 1, 1, 2, 3});
+    setVector("P", {0, 0, 1, 2, 3});
+    // 1 + 2|X|, 1 + 3max(X, 0) and 1 + X^2
+    setVector("A", {5, 3, 3, 5, 7});
+    setVector("R", {1, 1, 4, 7, 10});
+    setVector("S", {5, 2, 2, 5, 10});
+}
+
+void tearDown() {
+    for (auto &var : vars) {
+        delete var.value;
+    }
+    vars.empty();
+}
+
+void test_abs_term() {
+    // The absolute value of the whole vector would be its norm, so this has to be evaluated for each data point
+    Matrix *result = call("linReg(X,A,1,", new neda::Abs(chars("x")));
+    Matrix *expected = call("linReg(Z,A,1,x");
+    assertClose(1, (*result)[0]);
+    assertClose(2, (*result)[1]);
+    assertClose((*expected)[0].asDouble(), (*result)[0]);
+    assertClose((*expected)[1].asDouble(), (*result)[1]);
+    delete result;
+    delete expected;
+}
+
+void test_piecewise_term() {
+    // x if x > 0, otherwise 0
+    // The condition would be tested for the whole vector at once, so this has to be evaluated for each data point
+    neda::Piecewise *piecewise = new neda::Piecewise(2);
+    piecewise->setValue(0, chars("x"));
+    piecewise->setCondition(0, chars("x>0"));
+    piecewise->setValue(1, chars("0"));
+    piecewise->setCondition(1, chars("else"));
+    Matrix *result = call("linReg(X,R,1,", piecewise);
+    Matrix *expected = call("linReg(P,R,1,x");
+    assertClose(1, (*result)[0]);
+    assertClose(3, (*result)[1]);
+    assertClose((*expected)[0].asDouble(), (*result)[0]);
+    assertClose((*expected)[1].asDouble(), (*result)[1]);
+    delete result;
+    delete expected;
+}
+
+void test_elementwise_term() {
+    // 2x^2, which is evaluated for all the data points at once
+    Matrix *result = call("linReg(X,S,1,2x", new neda::Superscript(chars("2")));
+    assertClose(1, (*result)[0]);
+    assertClose(0.5, (*result)[1]);
+    delete result;
+}
+
+void test_exact_result() {
+    // Exact data gives exact coefficients, and nothing else
+    Matrix *result = call("linReg(Z,A,1,x");
+    TEST_ASSERT_EQUAL_UINT16(2, result->m);
+    TEST_ASSERT_EQUAL_UINT16(1, result->n);
+    assertExact(1, (*result)[0]);
+    assertExact(2, (*result)[1]);
+    delete result;
+}
+
+void test_stats() {
+    // Exact fit
+    Matrix *result = call("linRegStats(Z,A,1,x");
+    TEST_ASSERT_EQUAL_UINT16(2, result->m);
+    TEST_ASSERT_EQUAL_UINT16(1, result->n);
+    assertClose(0, (*result)[0]);
+    assertClose(1, (*result)[1]);
+    delete result;
+    // Fitting a constant leaves all of the variance: A has mean 23/5
+    result = call("linRegStats(Z,A,1");
+    assertClose(56.0 / 5, (*result)[0]);
+    assertClose(0, (*result)[1]);
+    delete result;
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_abs_term);
+    RUN_TEST(test_piecewise_term);
+    RUN_TEST(test_elementwise_term);
+    RUN_TEST(test_exact_result);
+    RUN_TEST(test_stats);
+    return UNITY_END();
+}
@@ -0,0 +1,302 @@
+/*
+ * Checks the fast paths for structured matrices (see eval::Matrix::Structure) against the dense path.
+ *
+ * The dense result is found from a copy of the operand marked as GENERAL, which makes every operation skip its
+ * structured path.
+ */
+#include "eval.hpp"
+#include <initializer_list>
+#include <math.h>
+#include <unity.h>
+
+using eval::LUDecomposition;
+using eval::Matrix;
+using Structure = eval::Matrix::Structure;
+
+constexpr uint16_t SIZE = 4;
+const Structure STRUCTURES[] = {
+    Structure::GENERAL,
+    Structure::ZERO,
+    Structure::IDENTITY,
+    Structure::DIAGONAL,
+    Structure::UPPER_TRIANGULAR,
+    Structure::LOWER_TRIANGULAR,
+    Structure::PERMUTATION,
+};
+// The column of the 1 in each row of the permutation matrix
+const uint16_t PERMUTATION[SIZE] = {2, 0, 3, 1};
+
+/*
+ * Creates a nonsingular (except for ZERO) SIZE x SIZE matrix with the given structure.
+ * The entries are integers, or floating-point numbers with a fractional part if floatingPoint is true.
+ */
+Matrix *makeMatrix(Structure s, bool floatingPoint) {
+    Matrix *mat = new Matrix(SIZE, SIZE, floatingPoint ? Matrix::Storage::DOUBLE : Matrix::Storage::FRACTION);
+    for (uint16_t i = 0; i < SIZE; i++) {
+        for (uint16_t j = 0; j < SIZE; j++) {
+            int64_t entry;
+            switch (s) {
+            case Structure::ZERO:
+                entry = 0;
+                break;
+            case Structure::IDENTITY:
+                entry = i == j;
+                break;
+            case Structure::PERMUTATION:
+                entry = PERMUTATION[i] == j;
+                break;
+            case Structure::DIAGONAL:
+                entry = i == j ? i + 2 : 0;
+                break;
+            case Structure::UPPER_TRIANGULAR:
+                entry = i == j ? i + 2 : i < j ? (i + j) % 3 + 1 : 0;
+                break;
+            case Structure::LOWER_TRIANGULAR:
+                entry = i == j ? i + 2 : i > j ? (i + j) % 3 + 1 : 0;
+                break;
+            default:
+                entry = (i * 7 + j * 3) % 5 + (i == j ? 6 : 1);
+                break;
+            }
+            // Only the entries that aren't 0 or 1 get a fractional part, so the structure stays the same
+            if (floatingPoint && entry > 1) {
+                mat->setEntry(i, j, entry + 0.25);
+            }
+            else if (floatingPoint) {
+                mat->setEntry(i, j, static_cast<double>(entry));
+            }
+            else {
+                mat->setEntry(i, j, util::Numerical(entry, 1));
+            }
+        }
+    }
+    return mat;
+}
+
+// A copy of the matrix that takes the dense path
+Matrix *dense(const Matrix &mat) {
+    Matrix *copy = new Matrix(mat);
+    copy->setStructure(Structure::GENERAL);
+    return copy;
+}
+
+void assertEntriesEqual(const util::Numerical &expected, const util::Numerical &actual) {
+    if (!expected.isNumber() && !actual.isNumber()) {
+        TEST_ASSERT_TRUE(expected == actual);
+    }
+    else {
+        const double e = expected.asDouble();
+        const double a = actual.asDouble();
+        TEST_ASSERT_TRUE(fabs(e - a) <= 1e-9 * fmax(1, fabs(e)));
+    }
+}
+
+void assertMatricesEqual(const Matrix *expected, const Matrix *actual) {
+    if (!expected || !actual) {
+        TEST_ASSERT_TRUE(expected == actual);
+        return;
+    }
+    TEST_ASSERT_EQUAL_UINT16(expected->m, actual->m);
+    TEST_ASSERT_EQUAL_UINT16(expected->n, actual->n);
+    for (uint32_t i = 0; i < expected->size(); i++) {
+        assertEntriesEqual((*expected)[i], (*actual)[i]);
+    }
+}
+
+// Whether the entries of the matrix really have the structure
+bool hasStructure(const Matrix &mat, Structure s) {
+    for (uint16_t i = 0; i < mat.m; i++) {
+        for (uint16_t j = 0; j < mat.n; j++) {
+            const util::Numerical entry = mat.getEntry(i, j);
+            bool valid;
+            switch (s) {
+            case Structure::ZERO:
+                valid = entry == 0;
+                break;
+            case Structure::IDENTITY:
+                valid = entry == (i == j ? 1 : 0);
+                break;
+            case Structure::DIAGONAL:
+                valid = i == j || entry == 0;
+                break;
+            case Structure::UPPER_TRIANGULAR:
+                valid = i <= j || entry == 0;
+                break;
+            case Structure::LOWER_TRIANGULAR:
+                valid = i >= j || entry == 0;
+                break;
+            case Structure::PERMUTATION:
+                valid = entry == 0 || entry == 1;
+                break;
+            default:
+                valid = true;
+                break;
+            }
+            if (!valid) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void setUp() {
+}
+
+void tearDown() {
+    LUDecomposition::clearCache();
+}
+
+void test_structure_detection() {
+    for (bool floatingPoint : {false, true}) {
+        for (Structure s : STRUCTURES) {
+            Matrix *mat = makeMatrix(s, floatingPoint);
+            TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(s), static_cast<uint8_t>(mat->getStructure()));
+            delete mat;
+        }
+    }
+}
+
+void test_multiply() {
+    for (bool floatingPoint : {false, true}) {
+        for (Structure sa : STRUCTURES) {
+            for (Structure sb : STRUCTURES) {
+                Matrix *a = makeMatrix(sa, floatingPoint);
+                Matrix *b = makeMatrix(sb, floatingPoint);
+                Matrix *denseA = dense(*a);
+                Matrix *denseB = dense(*b);
+
+                for (uint8_t trans = 0; trans < 4; trans++) {
+                    const bool transA = trans & 1;
+                    const bool transB = trans & 2;
+                    Matrix expected(SIZE, SIZE);
+                    Matrix actual(SIZE, SIZE);
+                    TEST_ASSERT_TRUE(Matrix::multiply(expected, *denseA, *denseB, 1, 0, transA, transB));
+                    TEST_ASSERT_TRUE(Matrix::multiply(actual, *a, *b, 1, 0, transA, transB));
+                    assertMatricesEqual(&expected, &actual);
+                    TEST_ASSERT_TRUE(hasStructure(actual, actual.getStructure()));
+
+                    // Scaled and accumulated into an existing matrix
+                    Matrix *expectedAcc = makeMatrix(Structure::GENERAL, floatingPoint);
+                    Matrix *actualAcc = makeMatrix(Structure::GENERAL, floatingPoint);
+                    TEST_ASSERT_TRUE(Matrix::multiply(*expectedAcc, *denseA, *denseB, 3, -2, transA, transB));
+                    TEST_ASSERT_TRUE(Matrix::multiply(*actualAcc, *a, *b, 3, -2, transA, transB));
+                    assertMatricesEqual(expectedAcc, actualAcc);
+                    delete expectedAcc;
+                    delete actualAcc;
+                }
+
+                delete a;
+                delete b;
+                delete denseA;
+                delete denseB;
+            }
+        }
+    }
+}
+
+void test_solve() {
+    for (bool floatingPoint : {false, true}) {
+        Matrix *b = makeMatrix(Structure::GENERAL, floatingPoint);
+        for (Structure s : STRUCTURES) {
+            Matrix *a = makeMatrix(s, floatingPoint);
+            Matrix *actual;
+            if (!Matrix::solveStructured(*a, *b, actual)) {
+                // Only matrices without a structure take the dense path
+                TEST_ASSERT_TRUE(s == Structure::GENERAL);
+                delete a;
+                continue;
+            }
+            Matrix *denseA = dense(*a);
+            Matrix *expected = LUDecomposition(*denseA).solve(*b);
+            assertMatricesEqual(expected, actual);
+
+            delete expected;
+            delete actual;
+            delete denseA;
+            delete a;
+        }
+        delete b;
+    }
+}
+
+void test_det() {
+    for (bool floatingPoint : {false, true}) {
+        for (Structure s : STRUCTURES) {
+            Matrix *a = makeMatrix(s, floatingPoint);
+            Matrix *denseA = dense(*a);
+            assertEntriesEqual(denseA->det(), a->det());
+            delete a;
+            delete denseA;
+        }
+    }
+    // Odd and even permutations
+    const uint16_t swaps[][SIZE] = {{1, 0, 2, 3}, {1, 0, 3, 2}, {1, 2, 3, 0}, {1, 2, 0, 3}};
+    for (const uint16_t *perm : swaps) {
+        Matrix a(SIZE, SIZE, Matrix::Storage::FRACTION);
+        for (uint16_t i = 0; i < SIZE; i++) {
+            a.setEntry(i, perm[i], util::Numerical(1, 1));
+        }
+        TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(Structure::PERMUTATION), static_cast<uint8_t>(a.getStructure()));
+        Matrix *denseA = dense(a);
+        assertEntriesEqual(denseA->det(), a.det());
+        delete denseA;
+    }
+}
+
+void test_inv() {
+    for (bool floatingPoint : {false, true}) {
+        for (Structure s : STRUCTURES) {
+            Matrix *a = makeMatrix(s, floatingPoint);
+            Matrix *denseA = dense(*a);
+            Matrix *expected = denseA->inv();
+            Matrix *actual = a->inv();
+            assertMatricesEqual(expected, actual);
+            if (actual) {
+                TEST_ASSERT_TRUE(hasStructure(*actual, actual->getStructure()));
+            }
+            delete expected;
+            delete actual;
+            delete a;
+            delete denseA;
+        }
+    }
+}
+
+void test_add_structure() {
+    for (bool floatingPoint : {false, true}) {
+        for (Structure sa : STRUCTURES) {
+            for (Structure sb : STRUCTURES) {
+                for (int8_t scalar : {1, -1}) {
+                    Matrix *sum = makeMatrix(sa, floatingPoint);
+                    Matrix *b = makeMatrix(sb, floatingPoint);
+                    sum->getStructure();
+                    b->getStructure();
+                    TEST_ASSERT_TRUE(sum->addInPlace(*b, scalar));
+                    // The structure kept from the operands must still hold for the entries
+                    TEST_ASSERT_TRUE(hasStructure(*sum, sum->getStructure()));
+                    delete sum;
+                    delete b;
+                }
+            }
+        }
+    }
+    // A general matrix minus itself is zero, which is only found if the structure isn't kept
+    Matrix *a = makeMatrix(Structure::GENERAL, false);
+    a->getStructure();
+    Matrix b(*a);
+    TEST_ASSERT_TRUE(a->addInPlace(b, -1));
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(Structure::ZERO), static_cast<uint8_t>(a->getStructure()));
+    delete a;
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_structure_detection);
+    RUN_TEST(test_multiply);
+    RUN_TEST(test_solve);
+    RUN_TEST(test_det);
+    RUN_TEST(test_inv);
+    RUN_TEST(test_add_structure);
+    return UNITY_END();
+}
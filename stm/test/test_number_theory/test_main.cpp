@@ -0,0 +1,89 @@
+/*
+ * Checks the integer functions at the edges of their range: zero arguments and -2^63, which has no positive int64.
+ */
+#include "eval.hpp"
+#include <math.h>
+#include <stdint.h>
+#include <unity.h>
+
+using eval::Function;
+
+// Calls a function with integer arguments and returns the result
+util::Numerical call(Function::Type type, int64_t a, int64_t b, int64_t c = 0) {
+    eval::Token *args[] = {
+        new eval::Numerical(util::Numerical(a, 1)),
+        new eval::Numerical(util::Numerical(b, 1)),
+        new eval::Numerical(util::Numerical(c, 1)),
+    };
+    Function func(type);
+    eval::Token *result = func(args, func.getNumArgs());
+    for (eval::Token *arg : args) {
+        delete arg;
+    }
+    TEST_ASSERT_NOT_NULL(result);
+    TEST_ASSERT_EQUAL_UINT8(static_cast<uint8_t>(eval::TokenType::NUMERICAL), static_cast<uint8_t>(result->getType()));
+    const util::Numerical value = static_cast<eval::Numerical *>(result)->value;
+    delete result;
+    return value;
+}
+
+void assertExact(int64_t expected, const util::Numerical &actual) {
+    TEST_ASSERT_FALSE(actual.isNumber());
+    TEST_ASSERT_TRUE(actual.asFraction().num == expected);
+    TEST_ASSERT_TRUE(actual.asFraction().denom == 1);
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_lcm_zero() {
+    assertExact(0, call(Function::Type::LCM, 5, 0));
+    assertExact(0, call(Function::Type::LCM, 0, 5));
+    assertExact(0, call(Function::Type::LCM, 0, 0));
+    assertExact(0, call(Function::Type::LCM, INT64_MIN, 0));
+    assertExact(0, call(Function::Type::LCM, 0, INT64_MIN));
+}
+
+void test_lcm() {
+    assertExact(12, call(Function::Type::LCM, 4, 6));
+    assertExact(12, call(Function::Type::LCM, -4, 6));
+    // Too big for int64
+    const util::Numerical big = call(Function::Type::LCM, INT64_MAX, INT64_MAX - 1);
+    TEST_ASSERT_TRUE(big.isNumber());
+    TEST_ASSERT_TRUE(big.asDouble() > 8e37);
+    const util::Numerical min = call(Function::Type::LCM, INT64_MIN, 3);
+    TEST_ASSERT_TRUE(min.isNumber());
+    TEST_ASSERT_TRUE(min.asDouble() == 3 * 9223372036854775808.0);
+}
+
+void test_gcd() {
+    assertExact(6, call(Function::Type::GCD, 12, -18));
+    assertExact(5, call(Function::Type::GCD, 0, 5));
+    assertExact(0, call(Function::Type::GCD, 0, 0));
+    assertExact(2, call(Function::Type::GCD, INT64_MIN, 6));
+    // 2^63 doesn't fit
+    const util::Numerical min = call(Function::Type::GCD, INT64_MIN, 0);
+    TEST_ASSERT_TRUE(min.isNumber());
+    TEST_ASSERT_TRUE(min.asDouble() == 9223372036854775808.0);
+}
+
+void test_powmod_negative_power() {
+    // 2 is its own inverse mod 3, and 2^2 = 1 mod 3
+    assertExact(1, call(Function::Type::POWMOD, 2, INT64_MIN, 3));
+    assertExact(2, call(Function::Type::POWMOD, 2, INT64_MIN + 1, 3));
+    // 3^-1 = 5 mod 7
+    assertExact(5, call(Function::Type::POWMOD, 3, -1, 7));
+    TEST_ASSERT_TRUE(isnan(call(Function::Type::POWMOD, 2, INT64_MIN, 4).asDouble()));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_lcm_zero);
+    RUN_TEST(test_lcm);
+    RUN_TEST(test_gcd);
+    RUN_TEST(test_powmod_negative_power);
+    return UNITY_END();
+}
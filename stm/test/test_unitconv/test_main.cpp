@@ -0,0 +1,52 @@
+/*
+ * Checks unit conversions that have to be exact, and the legacy unit names.
+ */
+#include "unitconv.hpp"
+#include <math.h>
+#include <unity.h>
+
+using eval::convertUnits;
+
+void assertClose(double expected, double actual) {
+    TEST_ASSERT_TRUE(fabs(expected - actual) <= 1e-12 * fmax(1, fabs(expected)));
+}
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+void test_temperature_exact() {
+    TEST_ASSERT_TRUE(convertUnits(32, "F", "C") == 0);
+    TEST_ASSERT_TRUE(convertUnits(0, "C", "F") == 32);
+    TEST_ASSERT_TRUE(convertUnits(212, "F", "C") == 100);
+    assertClose(212, convertUnits(100, "C", "F"));
+    TEST_ASSERT_TRUE(convertUnits(-40, "F", "C") == -40);
+    TEST_ASSERT_TRUE(convertUnits(273.15, "K", "C") == 0);
+    assertClose(273.15, convertUnits(32, "F", "K"));
+    // Temperature differences have no offset
+    assertClose(5, convertUnits(5, "J/kg*C", "J/kg*K"));
+}
+
+void test_legacy_minutes() {
+    // m on its own used to be minutes, which is kept when the other side is a unit of time
+    assertClose(60, convertUnits(1, "m", "s"));
+    assertClose(1.5, convertUnits(90, "s", "m"));
+    assertClose(120, convertUnits(2, "h", "m"));
+    // Otherwise m is metres
+    assertClose(0.005, convertUnits(5, "m", "km"));
+    assertClose(1000, convertUnits(1, "km", "m"));
+    assertClose(1, convertUnits(1, "m/s", "m/s"));
+    // Only the unit on its own is an alias
+    TEST_ASSERT_TRUE(isnan(convertUnits(1, "km", "s")));
+    TEST_ASSERT_TRUE(isnan(convertUnits(1, "m", "kg")));
+    TEST_ASSERT_TRUE(isnan(convertUnits(1, "m2", "s")));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_temperature_exact);
+    RUN_TEST(test_legacy_minutes);
+    return UNITY_END();
+}
@@ -22,6 +22,12 @@ def print_element(element, table2):
     print(f"\t\t\t{round(element['electronegativity_pauling'] * 100) if element['electronegativity_pauling'] != None else 0},")
     print("\t\t},")
 
+def print_index(name, locations):
+    print(f"\tconst ElementIndex {name}[] = {{")
+    for period, index, element in locations:
+        print(f"\t\t{{ {period}, {index} }}, // {element['symbol']}")
+    print("\t};\n")
+
 with open(argv[1], "r") as table_json, open(argv[2], "r") as table_json2:
     table = json.load(table_json)
     table2 = json.load(table_json2)
@@ -39,21 +45,33 @@ with open(argv[1], "r") as table_json, open(argv[2], "r") as table_json2:
         "actinide": "ACTINIDE",
     }
     
+    # (period, index in the period array, element) for every element, for generating the search indices
+    locations = []
+
     for i in range(1, 8):
         print(f"\tconst Element PERIOD_{i}_ELEMENTS[] = {{")
         for element in table["elements"]:
             if element["ypos"] == i and element["category"] != "lanthanide" and element["category"] != "actinide":
+                locations.append((i - 1, sum(1 for l in locations if l[0] == i - 1), element))
                 print_element(element, table2)
         print("\t};\n")
     
     print("\tconst Element LANTHANIDES[] = {")
     for element in table["elements"]:
         if element["category"] == "lanthanide":
+            locations.append((8, sum(1 for l in locations if l[0] == 8), element))
             print_element(element, table2)
     print("\t};\n")
 
     print("\tconst Element ACTINIDES[] = {")
     for element in table["elements"]:
         if element["category"] == "actinide":
+            locations.append((9, sum(1 for l in locations if l[0] == 9), element))
             print_element(element, table2)
     print("\t};\n")
+
+    # Search indices, sorted by atomic number and case-insensitively by symbol and name
+    print_index("ELEMENTS_BY_NUMBER", sorted(locations, key=lambda l: l[2]["number"]))
+    print_index("ELEMENTS_BY_SYMBOL", sorted(locations, key=lambda l: l[2]["symbol"].lower()))
+    print_index("ELEMENTS_BY_NAME", sorted(locations, key=lambda l: l[2]["name"].lower()))
+    print(f"\tconst uint8_t ELEMENT_COUNT = {len(locations)};")